@@ -0,0 +1,244 @@
+#include "BoltFlicker.h"
+
+// Options
+bool flickerEnabled = false;
+float flickerRate = 20.0f;			// flickers per second
+int flickerSubtrees = 4;			// subtrees re-displaced per flicker
+float flickerAngle = 4.0f;			// max rotation of a subtree about its root, degrees
+float flickerJitter = 0.15f;		// max joint displacement, relative to the segment's length
+float flickerTimer = 0;
+
+// Topology of the current bolt, in depth first order
+vector<int> segmentParents;			// -1 for segments starting the bolt
+vector<int> subtreeEnds;			// segment s's subtree is [s, subtreeEnds[s])
+vector<pair<vec3, vec3>> basePattern;	// generated positions, flickers displace from these
+
+// Stats
+int flickerSegments = 0;			// segments moved by the last flicker
+
+std::mt19937 flickerGen(std::random_device{}());
+
+// --------------------------------------------------
+// Private Functions --------------------------------
+vec3 RandomInSphere() {
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	vec3 p;
+	do {
+		p = vec3(unit(flickerGen), unit(flickerGen), unit(flickerGen));
+	} while (glm::dot(p, p) > 1.0f);
+	return p;
+}
+
+void DisplaceSubtree(vector<pair<vec3, vec3>>* patternPtr, int root) {
+	// rotates the subtree about its start, which stays on its parent's current end
+	vec3 basePivot = basePattern[root].first;
+	vec3 pivot = segmentParents[root] >= 0 ? (*patternPtr)[segmentParents[root]].second : basePivot;
+
+	std::uniform_real_distribution<float> angle(-flickerAngle, flickerAngle);
+	vec3 axis = RandomInSphere();
+	quat rotation = glm::length(axis) > 0 ?
+		glm::angleAxis(glm::radians(angle(flickerGen)), glm::normalize(axis)) : quat(1, 0, 0, 0);
+
+	// parents come before their children, so a segment's start is already moved
+	for (int s = root; s < subtreeEnds[root]; s++) {
+		vec3 start = s == root ? pivot : (*patternPtr)[segmentParents[s]].second;
+		vec3 end = pivot + rotation * (basePattern[s].second - basePivot);
+		float length = glm::length(basePattern[s].second - basePattern[s].first);
+		(*patternPtr)[s] = { start, end + RandomInSphere() * length * flickerJitter };
+	}
+}
+// --------------------------------------------------
+
+// Public Functions ---------------------------------
+vector<int> FindSegmentParents(const vector<pair<vec3, vec3>>& pattern) {
+	// segments continue from the segment that ends where they start
+	int numSegments = pattern.size();
+	std::map<std::tuple<float, float, float>, int> segmentEnding;
+	for (int s = 0; s < numSegments; s++) {
+		vec3 end = pattern[s].second;
+		segmentEnding.insert({ { end.x, end.y, end.z }, s });
+	}
+	vector<int> parents(numSegments, -1);
+	for (int s = 0; s < numSegments; s++) {
+		vec3 start = pattern[s].first;
+		auto parent = segmentEnding.find({ start.x, start.y, start.z });
+		if (parent != segmentEnding.end() && parent->second != s) {
+			parents[s] = parent->second;
+		}
+	}
+	return parents;
+}
+
+vector<int> FindBranchDepths(const vector<pair<vec3, vec3>>& pattern) {
+	int numSegments = pattern.size();
+	vector<int> parents = FindSegmentParents(pattern);
+	vector<vector<int>> children(numSegments);
+	vector<int> stack;
+	for (int s = 0; s < numSegments; s++) {
+		if (parents[s] >= 0) {
+			children[parents[s]].push_back(s);
+		}
+		else {
+			stack.push_back(s);
+		}
+	}
+
+	// parents before their children, segments in a cycle are left at depth 0
+	vector<int> order;
+	order.reserve(numSegments);
+	while (!stack.empty()) {
+		int s = stack.back();
+		stack.pop_back();
+		order.push_back(s);
+		stack.insert(stack.end(), children[s].begin(), children[s].end());
+	}
+	vector<int> subtreeSizes(numSegments, 1);
+	for (int i = order.size() - 1; i >= 0; i--) {
+		if (parents[order[i]] >= 0) {
+			subtreeSizes[parents[order[i]]] += subtreeSizes[order[i]];
+		}
+	}
+
+	vector<int> depths(numSegments, 0);
+	for (int s : order) {
+		int mainChild = -1;
+		for (int c : children[s]) {
+			if (mainChild < 0 || subtreeSizes[c] > subtreeSizes[mainChild]) {
+				mainChild = c;
+			}
+		}
+		for (int c : children[s]) {
+			depths[c] = depths[s] + (c == mainChild ? 0 : 1);
+		}
+	}
+	return depths;
+}
+
+void BuildBoltTopology(vector<pair<vec3, vec3>>* patternPtr, vector<int>* newIndexPtr) {
+	int numSegments = patternPtr->size();
+
+	vector<int> parents = FindSegmentParents(*patternPtr);
+	vector<vector<int>> children(numSegments);
+	vector<int> roots;
+	for (int s = 0; s < numSegments; s++) {
+		if (parents[s] >= 0) {
+			children[parents[s]].push_back(s);
+		}
+		else {
+			roots.push_back(s);
+		}
+	}
+
+	// depth first order, each subtree's segments end up contiguous
+	vector<int> order;
+	vector<int> newIndex(numSegments, -1);
+	segmentParents.assign(numSegments, -1);
+	subtreeEnds.assign(numSegments, 0);
+	vector<pair<int, bool>> stack;	// segment, children done
+	for (int root : roots) {
+		stack.push_back({ root, false });
+		while (!stack.empty()) {
+			pair<int, bool> top = stack.back();
+			stack.pop_back();
+			if (top.second) {
+				subtreeEnds[newIndex[top.first]] = order.size();
+				continue;
+			}
+			if (newIndex[top.first] >= 0) {
+				continue;	// only possible with a malformed (cyclic) pattern
+			}
+			newIndex[top.first] = order.size();
+			order.push_back(top.first);
+			stack.push_back({ top.first, true });
+			for (int c = children[top.first].size() - 1; c >= 0; c--) {
+				stack.push_back({ children[top.first][c], false });
+			}
+		}
+	}
+	// segments in a cycle were never reached from a root
+	for (int s = 0; s < numSegments; s++) {
+		if (newIndex[s] < 0) {
+			newIndex[s] = order.size();
+			order.push_back(s);
+			subtreeEnds[newIndex[s]] = order.size();
+		}
+	}
+
+	basePattern.resize(numSegments);
+	for (int i = 0; i < numSegments; i++) {
+		basePattern[i] = (*patternPtr)[order[i]];
+		for (int c : children[order[i]]) {
+			segmentParents[newIndex[c]] = i;
+		}
+	}
+	*patternPtr = basePattern;
+	flickerTimer = 0;
+	if (newIndexPtr) {
+		newIndexPtr->swap(newIndex);
+	}
+}
+
+bool FlickerDue(float deltaTime) {
+	if (!flickerEnabled || basePattern.empty()) {
+		return false;
+	}
+	flickerTimer += deltaTime;
+	if (flickerTimer < 1.0f / flickerRate) {
+		return false;
+	}
+	flickerTimer = 0;
+	return true;
+}
+
+void FlickerBolt(vector<pair<vec3, vec3>>* patternPtr, vector<pair<int, int>>* changedRanges) {
+	changedRanges->clear();
+	flickerSegments = 0;
+	if (patternPtr->size() != basePattern.size()) {
+		return;	// the pattern was replaced without building its topology
+	}
+
+	// pick subtrees that hang from another segment, so the bolt stays attached
+	std::uniform_int_distribution<int> segment(0, basePattern.size() - 1);
+	for (int i = 0; i < flickerSubtrees; i++) {
+		int root = segment(flickerGen);
+		if (segmentParents[root] < 0) {
+			continue;
+		}
+		changedRanges->push_back({ root, subtreeEnds[root] });
+	}
+
+	// subtrees are nested or disjoint, keep only the outermost of nested ones
+	std::sort(changedRanges->begin(), changedRanges->end());
+	vector<pair<int, int>> merged;
+	for (const pair<int, int>& range : *changedRanges) {
+		if (!merged.empty() && range.first < merged.back().second) {
+			continue;
+		}
+		merged.push_back(range);
+	}
+	changedRanges->swap(merged);
+
+	for (const pair<int, int>& range : *changedRanges) {
+		DisplaceSubtree(patternPtr, range.first);
+		flickerSegments += range.second - range.first;
+	}
+}
+
+bool GetFlickerEnabled() {
+	return flickerEnabled;
+}
+
+void FlickerGUI() {
+	ImGui::Checkbox("Flicker", &flickerEnabled);
+	if (flickerEnabled) {
+		ImGui::Text("Rate (per second)");
+		ImGui::SliderFloat("##flickerRate", &flickerRate, 1.0f, 60.0f);
+		ImGui::Text("Subtrees per Flicker");
+		ImGui::SliderInt("##flickerSubtrees", &flickerSubtrees, 1, 32);
+		ImGui::Text("Angle");
+		ImGui::SliderFloat("##flickerAngle", &flickerAngle, 0.0f, 30.0f);
+		ImGui::Text("Jitter");
+		ImGui::SliderFloat("##flickerJitter", &flickerJitter, 0.0f, 1.0f);
+		ImGui::Text("Last Flicker: %d / %d segments", flickerSegments, int(basePattern.size()));
+	}
+}
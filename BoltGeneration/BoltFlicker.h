@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <glm/glm/gtc/quaternion.hpp>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <random>
+#include <algorithm>
+#include <imgui/imgui.h>
+
+using glm::vec3;
+using glm::quat;
+using std::vector;
+using std::pair;
+
+// Flickering for dynamic bolts. The bolt's segments are put in depth first 
+// order when it's generated, so every subtree (a branch and everything that
+// grows from it) is a contiguous range of segments. A flicker re-displaces
+// a few random subtrees from their generated positions, and reports the
+// ranges that changed so only those are re-uploaded and only the lights on
+// them are moved.
+
+// Each segment's parent is the segment ending where it starts, -1 for none
+vector<int> FindSegmentParents(const vector<pair<vec3, vec3>>& pattern);
+// Number of branchings between each segment and its root. At each branching the
+// child with the largest subtree continues the parent's branch, the others are one deeper.
+vector<int> FindBranchDepths(const vector<pair<vec3, vec3>>& pattern);
+// Finds each segment's parent and reorders the pattern depth first. Call 
+// after every new dynamic bolt. newIndexPtr gets each old segment's new index.
+void BuildBoltTopology(vector<pair<vec3, vec3>>* patternPtr, vector<int>* newIndexPtr = nullptr);
+
+// true when the next flicker is due, deltaTime is in seconds
+bool FlickerDue(float deltaTime);
+// Re-displaces random subtrees, changedRanges gets the [first, end) segment 
+// ranges that moved, sorted and not overlapping.
+void FlickerBolt(vector<pair<vec3, vec3>>* patternPtr, vector<pair<int, int>>* changedRanges);
+
+bool GetFlickerEnabled();
+void FlickerGUI();
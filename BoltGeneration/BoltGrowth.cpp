@@ -0,0 +1,101 @@
+#include "BoltGrowth.h"
+
+// Options
+bool growthEnabled = false;
+float stepInterval = 0.05f;			// seconds between leader steps
+float stepLength = 6.0f;			// path length the leader advances each step
+float leaderBrightness = 0.35f;
+
+// Current growth
+bool growing = false;
+vector<float> arrivals;				// path length from the start to each segment's end, sorted
+float leaderReach = 0;
+float stepTimer = 0;
+int segmentsGrown = 0;
+int leaderSteps = 0;
+
+void StartBoltGrowth(vector<pair<vec3, vec3>>* patternPtr) {
+	int numSegments = patternPtr->size();
+
+	// a segment is reached after its parent, parents may come later in the pattern
+	vector<int> parents = FindSegmentParents(*patternPtr);
+	vector<float> arrival(numSegments, -1.0f);
+	vector<int> path;
+	for (int s = 0; s < numSegments; s++) {
+		int p = s;
+		while (p >= 0 && arrival[p] < 0 && int(path.size()) <= numSegments) {
+			path.push_back(p);
+			p = parents[p];
+		}
+		float length = p >= 0 && arrival[p] >= 0 ? arrival[p] : 0;
+		for (int i = path.size() - 1; i >= 0; i--) {
+			const pair<vec3, vec3>& segment = (*patternPtr)[path[i]];
+			length += glm::length(segment.second - segment.first);
+			arrival[path[i]] = length;
+		}
+		path.clear();
+	}
+
+	// parents are always reached first, so grown segments stay attached
+	vector<int> order(numSegments);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return arrival[a] < arrival[b]; });
+
+	vector<pair<vec3, vec3>> ordered(numSegments);
+	arrivals.resize(numSegments);
+	for (int i = 0; i < numSegments; i++) {
+		ordered[i] = (*patternPtr)[order[i]];
+		arrivals[i] = arrival[order[i]];
+	}
+	patternPtr->swap(ordered);
+
+	growing = numSegments > 0;
+	leaderReach = 0;
+	stepTimer = 0;
+	segmentsGrown = 0;
+	leaderSteps = 0;
+}
+
+int GrowBolt(float deltaTime) {
+	if (!growing) {
+		return segmentsGrown;
+	}
+	stepTimer += deltaTime;
+	while (stepTimer >= stepInterval) {
+		stepTimer -= stepInterval;
+		leaderReach += stepLength;
+		leaderSteps++;
+	}
+	segmentsGrown = std::upper_bound(arrivals.begin(), arrivals.end(), leaderReach) - arrivals.begin();
+
+	// the leader has reached the end, the return stroke follows straight away
+	if (segmentsGrown == int(arrivals.size())) {
+		growing = false;
+	}
+	return segmentsGrown;
+}
+
+bool BoltGrowing() {
+	return growing;
+}
+
+float GetGrowthBrightness() {
+	return growing ? leaderBrightness : 1.0f;
+}
+
+bool GetGrowthEnabled() {
+	return growthEnabled;
+}
+
+void GrowthGUI() {
+	ImGui::Checkbox("Stepped Leader", &growthEnabled);
+	if (growthEnabled) {
+		ImGui::Text("Step Interval (s)");
+		ImGui::SliderFloat("##stepInterval", &stepInterval, 0.005f, 0.5f);
+		ImGui::Text("Step Length");
+		ImGui::SliderFloat("##stepLength", &stepLength, 0.5f, 30.0f);
+		ImGui::Text("Leader Brightness");
+		ImGui::SliderFloat("##leaderBrightness", &leaderBrightness, 0.0f, 1.0f);
+		ImGui::Text("Grown: %d / %d segments in %d steps", segmentsGrown, int(arrivals.size()), leaderSteps);
+	}
+}
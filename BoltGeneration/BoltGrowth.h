@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <imgui/imgui.h>
+
+#include "BoltFlicker.h"
+
+using glm::vec3;
+using std::vector;
+using std::pair;
+
+// Stepped leader growth for dynamic bolts. Instead of appearing in one frame,
+// the bolt grows from its start: the leader advances a step at a time,
+// revealing every segment whose path from the start is within its reach.
+// When it's fully grown the return stroke lights the whole channel.
+// The pattern is put in the order its segments are reached, so each step's
+// segments (and the lights on them) are appended after the last step's.
+
+// Orders the pattern by when it's reached and starts growing it
+void StartBoltGrowth(vector<pair<vec3, vec3>>* patternPtr);
+// Advances the growth by deltaTime seconds, returns the number of segments grown
+int GrowBolt(float deltaTime);
+// true from StartBoltGrowth until the return stroke
+bool BoltGrowing();
+// bolt brightness, dimmer while the leader is descending
+float GetGrowthBrightness();
+
+bool GetGrowthEnabled();
+void GrowthGUI();
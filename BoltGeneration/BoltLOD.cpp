@@ -0,0 +1,159 @@
+#include "BoltLOD.h"
+
+// Options
+bool lodEnabled = false;
+float lodPixelError = 2.0f;			// target screen space error, in pixels
+const int MAX_MERGED_SEGMENTS = 64;	// longest chain merged into one segment
+
+// View
+vec3 lodCameraPos = vec3(0.0f);
+float lodPixelScale = 1.0f;
+const float LOD_NEAR = 0.1f;		// distances are clamped to the near plane
+
+// Stats
+int lodSegmentsKept = 0;
+int lodSegmentsFull = 0;
+
+// Private Functions --------------------------------
+float PixelsAt(vec3 p) {
+	return lodPixelScale / glm::max(glm::length(p - lodCameraPos), LOD_NEAR);
+}
+
+// pixels between p and the segment a->b
+float ProjectedDeviation(vec3 p, vec3 a, vec3 b) {
+	vec3 ab = b - a;
+	float t = glm::clamp(glm::dot(p - a, ab) / glm::max(glm::dot(ab, ab), 1e-12f), 0.0f, 1.0f);
+	return glm::length(p - (a + t * ab)) * PixelsAt(p);
+}
+// --------------------------------------------------
+
+// Public Functions ---------------------------------
+void SetBoltLODView(vec3 cameraPos, float pixelScale) {
+	lodCameraPos = cameraPos;
+	lodPixelScale = pixelScale;
+}
+
+float ProjectedLength(vec3 a, vec3 b) {
+	return glm::length(b - a) * PixelsAt(0.5f * (a + b));
+}
+
+bool BelowBoltLODError(vec3 a, vec3 b) {
+	return lodEnabled && ProjectedLength(a, b) < lodPixelError;
+}
+
+void SimplifyBoltPattern(vector<pair<vec3, vec3>>* patternPtr) {
+	int numSegments = patternPtr->size();
+	lodSegmentsFull = numSegments;
+	lodSegmentsKept = numSegments;
+	if (!lodEnabled || numSegments == 0) {
+		return;
+	}
+
+	vector<int> parents = FindSegmentParents(*patternPtr);
+	vector<vector<int>> children(numSegments);
+	vector<int> roots;
+	for (int s = 0; s < numSegments; s++) {
+		if (parents[s] >= 0) {
+			children[parents[s]].push_back(s);
+		}
+		else {
+			roots.push_back(s);
+		}
+	}
+
+	// projected length of each subtree, children before parents
+	vector<int> order;
+	order.reserve(numSegments);
+	vector<int> stack = roots;
+	while (!stack.empty()) {
+		int s = stack.back();
+		stack.pop_back();
+		order.push_back(s);
+		stack.insert(stack.end(), children[s].begin(), children[s].end());
+	}
+	vector<float> subtreePixels(numSegments, 0.0f);
+	for (int i = order.size() - 1; i >= 0; i--) {
+		int s = order[i];
+		subtreePixels[s] += ProjectedLength((*patternPtr)[s].first, (*patternPtr)[s].second);
+		if (parents[s] >= 0) {
+			subtreePixels[parents[s]] += subtreePixels[s];
+		}
+	}
+
+	// Each chain of segments is merged into one for as long as it has a single
+	// branch worth keeping and the points skipped stay within the error.
+	// Merged segments start at their first segment's start, so children still
+	// start where their parent ends.
+	vector<pair<vec3, vec3>> simplified;
+	vector<vec3> skipped;
+	vector<int> kept;
+	stack = roots;
+	while (!stack.empty()) {
+		int s = stack.back();
+		stack.pop_back();
+		vec3 start = (*patternPtr)[s].first;
+		skipped.clear();
+		while (true) {
+			kept.clear();
+			for (int c : children[s]) {
+				if (subtreePixels[c] >= lodPixelError) {
+					kept.push_back(c);
+				}
+			}
+			if (kept.size() != 1 || skipped.size() >= MAX_MERGED_SEGMENTS) {
+				break;
+			}
+			vec3 end = (*patternPtr)[kept[0]].second;
+			skipped.push_back((*patternPtr)[s].second);
+			bool withinError = true;
+			for (vec3 p : skipped) {
+				if (ProjectedDeviation(p, start, end) >= lodPixelError) {
+					withinError = false;
+					break;
+				}
+			}
+			if (!withinError) {
+				skipped.pop_back();
+				break;
+			}
+			s = kept[0];
+		}
+		simplified.push_back({ start, (*patternPtr)[s].second });
+		stack.insert(stack.end(), kept.begin(), kept.end());
+	}
+
+	patternPtr->swap(simplified);
+	lodSegmentsKept = patternPtr->size();
+}
+
+void RecordBoltLOD(int segmentsKept, int segmentsFull) {
+	lodSegmentsKept = segmentsKept;
+	lodSegmentsFull = segmentsFull;
+}
+
+float GetBoltLODDetail() {
+	if (!lodEnabled || lodSegmentsFull == 0) {
+		return 1.0f;
+	}
+	return glm::min(float(lodSegmentsKept) / float(lodSegmentsFull), 1.0f);
+}
+
+bool GetBoltLODEnabled() {
+	return lodEnabled;
+}
+
+void SetBoltLODOptions(bool enabled, float pixelError) {
+	lodEnabled = enabled;
+	lodPixelError = pixelError;
+}
+
+void BoltLODGUI() {
+	ImGui::Checkbox("Level of Detail", &lodEnabled);
+	if (lodEnabled) {
+		ImGui::Text("Screen Space Error (pixels)");
+		ImGui::SliderFloat("##lodPixelError", &lodPixelError, 0.25f, 16.0f);
+		ImGui::Text("Kept: %d / %d segments (%.0f%%)", lodSegmentsKept, lodSegmentsFull,
+			GetBoltLODDetail() * 100.0f);
+	}
+}
+// --------------------------------------------------
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <imgui/imgui.h>
+
+#include "BoltFlicker.h"
+
+using glm::vec3;
+using std::vector;
+using std::pair;
+
+// Distance based level of detail for dynamic bolts. Detail that would be smaller
+// than the target screen space error (in pixels) from the camera isn't generated:
+// the L-System stops subdividing segments and doesn't start branches shorter
+// than it, the other generators merge chains of segments that stay within it of
+// a straight line and drop branches smaller than it. The light budget is scaled
+// by the fraction of the full detail that was kept.
+
+// Camera the next bolts are generated for, pixelScale is pixels per world unit
+// at a distance of 1 (half the screen height over tan(fov / 2))
+void SetBoltLODView(vec3 cameraPos, float pixelScale);
+// Projected length in pixels of the segment a->b, measured at its midpoint
+float ProjectedLength(vec3 a, vec3 b);
+// true if LOD is on and the segment is below the target error
+bool BelowBoltLODError(vec3 a, vec3 b);
+
+// For generators that don't subdivide: merges and prunes the pattern's segments
+// down to the target error, keeping every branching point and the topology.
+void SimplifyBoltPattern(vector<pair<vec3, vec3>>* patternPtr);
+// For the L-System: the segments kept, and the segments full detail would have had
+void RecordBoltLOD(int segmentsKept, int segmentsFull);
+// fraction of the full detail kept by the last bolt, 1 without LOD
+float GetBoltLODDetail();
+
+bool GetBoltLODEnabled();
+void SetBoltLODOptions(bool enabled, float pixelError);
+void BoltLODGUI();
@@ -0,0 +1,92 @@
+#include "BoltMesh.h"
+
+BoltMesh::BoltMesh() {
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glGenVertexArrays(1, &ribbonVAO);
+	glGenBuffers(1, &depthBuffer);
+}
+
+void BoltMesh::Upload(const vector<pair<vec3, vec3>>& pattern) {
+	numSegments = pattern.size();
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	if (numSegments > capacity) {
+		// leave room for the next bolt to be a bit bigger
+		capacity = numSegments + numSegments / 2;
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(pair<vec3, vec3>), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, numSegments * sizeof(pair<vec3, vec3>), pattern.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	bytesUploaded += numSegments * sizeof(pair<vec3, vec3>);
+}
+
+void BoltMesh::UpdateRange(const vector<pair<vec3, vec3>>& pattern, int first, int count) {
+	if (first < 0 || count <= 0 || first + count > numSegments) {
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(pair<vec3, vec3>), count * sizeof(pair<vec3, vec3>),
+		&pattern[first]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	bytesUploaded += count * sizeof(pair<vec3, vec3>);
+}
+
+void BoltMesh::Reserve(int _numSegments) {
+	numSegments = 0;
+	if (_numSegments > capacity) {
+		capacity = _numSegments + _numSegments / 2;
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(pair<vec3, vec3>), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+void BoltMesh::Append(const vector<pair<vec3, vec3>>& pattern, int count) {
+	count = std::min(count, std::min(capacity, (int)pattern.size()) - numSegments);
+	if (count <= 0) {
+		return;
+	}
+	numSegments += count;
+	UpdateRange(pattern, numSegments - count, count);
+}
+
+void BoltMesh::Draw() {
+	glBindVertexArray(VAO);
+	glDrawArrays(GL_LINES, 0, numSegments * 2);
+}
+
+void BoltMesh::UploadBranchDepths(const vector<int>& depths) {
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, depthBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(depths.size(), size_t(1)) * sizeof(int),
+		depths.empty() ? NULL : depths.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	bytesUploaded += depths.size() * sizeof(int);
+}
+
+void BoltMesh::DrawRibbons() {
+	glBindVertexArray(ribbonVAO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOLT_SEGMENT_BINDING, VBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOLT_BRANCH_DEPTH_BINDING, depthBuffer);
+	glDrawArrays(GL_TRIANGLES, 0, numSegments * 6);
+}
+
+void BoltMesh::BindSegments(unsigned int binding) {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, VBO);
+}
+
+int BoltMesh::NumSegments() const {
+	return numSegments;
+}
+
+size_t BoltMesh::TakeBytesUploaded() {
+	size_t bytes = bytesUploaded;
+	bytesUploaded = 0;
+	return bytes;
+}
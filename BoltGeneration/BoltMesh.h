@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+
+using glm::vec3;
+using std::vector;
+using std::pair;
+
+// binding points of the segments and their branch depths when read as SSBOs,
+// must match bolt_ribbon.vert and glow_bin.comp
+const unsigned int BOLT_SEGMENT_BINDING = 5;
+const unsigned int BOLT_BRANCH_DEPTH_BINDING = 9;
+
+// All of a dynamic bolt's segments in one vertex buffer, drawn with a single
+// call. The pattern's segments are uploaded as they are stored (two vec3s
+// each), so a range of segments can be re-uploaded on its own.
+// They can also be drawn as ribbons: bolt_ribbon.vert reads the segments and
+// their branch depths from storage buffers and expands each into a quad, with
+// no vertex attributes.
+
+class BoltMesh {
+public:
+	BoltMesh();
+	// Uploads the whole pattern, growing the buffer if needed
+	void Upload(const vector<pair<vec3, vec3>>& pattern);
+	// Re-uploads the segments [first, first + count)
+	void UpdateRange(const vector<pair<vec3, vec3>>& pattern, int first, int count);
+	// Empties the mesh, with room for a pattern of numSegments to be appended
+	void Reserve(int numSegments);
+	// Uploads the pattern's next count segments after the ones already in the mesh
+	void Append(const vector<pair<vec3, vec3>>& pattern, int count);
+	void Draw();
+	// Each segment's branch depth, for the ribbons' widths. Only changes with the topology.
+	void UploadBranchDepths(const vector<int>& depths);
+	// 6 vertices per segment, with the ribbon shader in use
+	void DrawRibbons();
+	// Binds the vertex buffer as a shader storage buffer, read as 6 floats per segment
+	void BindSegments(unsigned int binding);
+
+	int NumSegments() const;
+	// bytes uploaded since the last call
+	size_t TakeBytesUploaded();
+
+private:
+	unsigned int VAO, VBO;
+	unsigned int ribbonVAO;			// empty, the ribbons' vertices are pulled from the buffers
+	unsigned int depthBuffer;
+	int numSegments = 0;
+	int capacity = 0;			// in segments
+	size_t bytesUploaded = 0;
+};
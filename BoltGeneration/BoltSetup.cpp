@@ -17,8 +17,8 @@ The STATIC option is the default, to use the DYNAMIC option, set the DYNAMIC_BOL
 
 // -------------------
 // Bolt Generation Method choices
-enum Method { Random, Particle, LSystem };
-Method methods[3] = { Random, Particle, LSystem };
+enum Method { Random, Particle, LSystem, DBM, Colonization };
+Method methods[5] = { Random, Particle, LSystem, DBM, Colonization };
 int currentMethod = 0;
 
 // Number of Lights variables
@@ -26,6 +26,13 @@ int numLights = 50;	// controls the (max) number of lights
 float lightPerSeg = 1;
 int numActiveLights;
 int numActiveSegments;
+// DYNAMIC: the segment each light is on and how far along it, sorted by segment
+struct LightSegment {
+	int segment;
+	float t;
+	int light;
+};
+vector<LightSegment> lightSegments;
 // --------------------
 
 // BoltSegment Setup
@@ -40,21 +47,18 @@ void DefineBoltLines(LineBoltSegment* lboltPtr,
 }
 
 // DYNAMIC BOLT
-void DefineBoltLines(vector<LineBoltSegment>* lboltPtr, 
+// all the segments go in one buffer, a growing bolt's are appended as it grows.
+// The branch depths are uploaded for the whole pattern either way.
+void DefineBoltLines(BoltMesh* boltMeshPtr, 
 	vector<pair<vec3, vec3>>* patternPtr) {
 
-	lboltPtr->clear();
-	//lboltPtr->reserve(patternPtr->size());
-
-	for (int i = 0; i < patternPtr->size(); i++) {
-		lboltPtr->push_back(LineBoltSegment(patternPtr->at(i).first, 
-			patternPtr->at(i).second));
+	if (BoltGrowing()) {
+		boltMeshPtr->Reserve(patternPtr->size());
 	}
-	/*
-	for (int i = 0; i < patternPtr->size(); i++) {
-		lboltPtr->emplace_back(patternPtr->at(i).first, patternPtr->at(i).second);
+	else {
+		boltMeshPtr->Upload(*patternPtr);
 	}
-	*/
+	boltMeshPtr->UploadBranchDepths(FindBranchDepths(*patternPtr));
 }
 // -----------
 
@@ -101,10 +105,13 @@ void PositionBoltPointLights(vector<vec3>* lightPositionsPtr,
 	vector<pair<vec3, vec3>>* patternPtr) {
 	// remove old light positions
 	lightPositionsPtr->clear();
+	lightSegments.clear();
 	numActiveLights = 0;
 
-	// scale lightsPerSeg based on number of segments
-	lightPerSeg = (float)numLights / (float)patternPtr->size();
+	// scale lightsPerSeg based on number of segments, with LOD the light budget
+	// is scaled like the segments were
+	int lightBudget = glm::max(1, int(numLights * GetBoltLODDetail() + 0.5f));
+	lightPerSeg = (float)lightBudget / (float)patternPtr->size();
 
 	float count = 0;
 
@@ -121,6 +128,7 @@ void PositionBoltPointLights(vector<vec3>* lightPositionsPtr,
 
 			for (float i = 0; i < lightCount; i++) {
 				lightPositionsPtr->push_back(patternPtr->at(seg).first + (step * (i+1)));
+				lightSegments.push_back({ seg, (i + 1) / float(lightCount + 1), int(lightSegments.size()) });
 			}
 
 			numActiveLights += lightCount;
@@ -128,13 +136,99 @@ void PositionBoltPointLights(vector<vec3>* lightPositionsPtr,
 		};
 	}
 }
+
+// DYNAMIC BOLT
+// Moves the lights on the segments [firstSegment, endSegment) along with them.
+// Lights are stored in segment order, so only the lights in the range are visited.
+void RepositionBoltPointLights(vector<vec3>* lightPositionsPtr,
+	vector<pair<vec3, vec3>>* patternPtr, int firstSegment, int endSegment, vector<int>* movedLights) {
+
+	auto first = std::lower_bound(lightSegments.begin(), lightSegments.end(), firstSegment,
+		[](const LightSegment& light, int segment) { return light.segment < segment; });
+	for (auto light = first; light != lightSegments.end() && light->segment < endSegment; light++) {
+		const pair<vec3, vec3>& segment = patternPtr->at(light->segment);
+		(*lightPositionsPtr)[light->light] = glm::mix(segment.first, segment.second, light->t);
+		movedLights->push_back(light->light);
+	}
+}
+
+// DYNAMIC BOLT
+// Line lights: the bolt as at most maxLines straight lights. Each follows a chain of
+// segments (a segment then its first child) up to segmentsPerLine long, so every
+// branch gets its own lines. If there are still too many the shortest are dropped.
+// With LOD there are fewer lines, like the point lights.
+void PositionBoltLineLights(vector<pair<vec3, vec3>>* linesPtr,
+	vector<pair<vec3, vec3>>* patternPtr, int maxLines) {
+
+	linesPtr->clear();
+	int numSegments = patternPtr->size();
+	if (numSegments == 0 || maxLines <= 0) {
+		return;
+	}
+	vector<int> parents = FindSegmentParents(*patternPtr);
+	vector<int> firstChild(numSegments, -1);
+	for (int s = numSegments - 1; s >= 0; s--) {
+		if (parents[s] >= 0) {
+			firstChild[parents[s]] = s;
+		}
+	}
+
+	maxLines = glm::max(1, int(maxLines * GetBoltLODDetail() + 0.5f));
+	int segmentsPerLine = (numSegments + maxLines - 1) / maxLines;
+	for (int s = 0; s < numSegments; s++) {
+		// chains start at roots and at every child but the first
+		if (parents[s] >= 0 && firstChild[parents[s]] == s) {
+			continue;
+		}
+		int segment = s;
+		for (int steps = 0; segment >= 0 && steps < numSegments;) {
+			vec3 start = (*patternPtr)[segment].first;
+			vec3 end = start;
+			for (int n = 0; n < segmentsPerLine && segment >= 0 && steps < numSegments; n++, steps++) {
+				end = (*patternPtr)[segment].second;
+				segment = firstChild[segment];
+			}
+			linesPtr->push_back(std::make_pair(start, end));
+		}
+	}
+
+	if (int(linesPtr->size()) > maxLines) {
+		std::stable_sort(linesPtr->begin(), linesPtr->end(),
+			[](const pair<vec3, vec3>& a, const pair<vec3, vec3>& b) {
+				return glm::length(a.second - a.first) > glm::length(b.second - b.first);
+			});
+		linesPtr->resize(maxLines);
+	}
+}
+
+// DYNAMIC BOLT
+// Number of lights on the segments before endSegment. Lights are numbered in
+// segment order until the pattern is reordered by FinishBoltGrowth.
+int CountBoltPointLights(int endSegment) {
+	return std::lower_bound(lightSegments.begin(), lightSegments.end(), endSegment,
+		[](const LightSegment& light, int segment) { return light.segment < segment; }) - lightSegments.begin();
+}
+
+// DYNAMIC BOLT
+// Once a growing bolt has fully grown it's put in depth first order so it can 
+// flicker, its lights stay where they are.
+void FinishBoltGrowth(BoltMesh* boltMeshPtr, vector<pair<vec3, vec3>>* patternPtr) {
+	vector<int> newIndex;
+	BuildBoltTopology(patternPtr, &newIndex);
+	for (LightSegment& light : lightSegments) {
+		light.segment = newIndex[light.segment];
+	}
+	std::stable_sort(lightSegments.begin(), lightSegments.end(),
+		[](const LightSegment& a, const LightSegment& b) { return a.segment < b.segment; });
+	boltMeshPtr->Upload(*patternPtr);
+	boltMeshPtr->UploadBranchDepths(FindBranchDepths(*patternPtr));
+}
 // ----------
 
 // Generate a New Bolt and set line and light positions
 // ----------
 // DYNAMIC BOLT
-void NewBolt(vector<LineBoltSegment>* segmentsPtr, vector<vec3>* lightsPtr,
-	vector<pair<vec3, vec3>>* patternPtr) {
+void NewBolt(vector<pair<vec3, vec3>>* patternPtr) {
 
 	// Generate New Bolt Pattern
 	switch (methods[currentMethod]) {
@@ -147,10 +241,24 @@ void NewBolt(vector<LineBoltSegment>* segmentsPtr, vector<vec3>* lightsPtr,
 	case LSystem:
 		GenerateLSystemPattern(patternPtr, true);
 		break;
+	case DBM:
+		GenerateDBMPattern(patternPtr);
+		break;
+	case Colonization:
+		GenerateColonizationPattern(patternPtr);
+		break;
 	default:
 		std::cout << "ERROR::BOLT_SETUP::NEW_BOLT::Bolt Method Not Set" << std::endl;
 		break;
 	}
+	// depth first, so the bolt's branches can flicker independently, 
+	// a growing bolt is ordered by when it's reached until it's grown
+	if (GetGrowthEnabled()) {
+		StartBoltGrowth(patternPtr);
+	}
+	else {
+		BuildBoltTopology(patternPtr);
+	}
 }
 
 // STATIC BOLT
@@ -169,6 +277,12 @@ void NewBolt(LineBoltSegment* segmentsPtr, vec3* lightsPtr,
 	case LSystem:
 		numActiveSegments = GenerateLSystemPattern( patternPtr);
 		break;
+	case DBM:
+		numActiveSegments = GenerateDBMPattern(patternPtr);
+		break;
+	case Colonization:
+		numActiveSegments = GenerateColonizationPattern(patternPtr);
+		break;
 	default:
 		std::cout << "ERROR::BOLT_SETUP::NEW_BOLT::Bolt Method Not Set" << std::endl;
 		break;
@@ -204,4 +318,4 @@ void SetNumLights(int num) {
 
 void SetMethod(int m) {
 	currentMethod = m;
-}
\ No newline at end of file
+}
\ No newline at end of file
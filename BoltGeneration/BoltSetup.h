@@ -2,24 +2,37 @@
 
 #include <memory>
 #include <vector>
+#include <algorithm>
 
 #include "LineBoltSegment.h"
+#include "BoltMesh.h"
+#include "BoltFlicker.h"
+#include "BoltGrowth.h"
 #include "LightningPatterns.h"
 
 // Functions
 void DefineBoltLines(LineBoltSegment* lboltPtr, 
 	std::shared_ptr<glm::vec3[numSegmentsInPattern]> patternPtr);
-void DefineBoltLines(vector<LineBoltSegment>* lboltPtr, 
+void DefineBoltLines(BoltMesh* boltMeshPtr, 
 	vector<pair<vec3, vec3>>* patternPtr);
 
 void PositionBoltPointLights(vec3* lightPositionsPtr,
 	std::shared_ptr<glm::vec3[numSegmentsInPattern]> patternPtr);
 void PositionBoltPointLights(vector<vec3>* lightPositionsPtr,
 	vector<pair<vec3, vec3>>* patternPtr);
+// DYNAMIC, after a flicker: movedLights gets the indices of the lights that moved
+void RepositionBoltPointLights(vector<vec3>* lightPositionsPtr,
+	vector<pair<vec3, vec3>>* patternPtr, int firstSegment, int endSegment, vector<int>* movedLights);
+// DYNAMIC: the bolt as at most maxLines line lights, start and end points
+void PositionBoltLineLights(vector<pair<vec3, vec3>>* linesPtr,
+	vector<pair<vec3, vec3>>* patternPtr, int maxLines);
+// DYNAMIC, while growing: number of lights on the segments before endSegment
+int CountBoltPointLights(int endSegment);
+// DYNAMIC, once grown: reorders the bolt for flickering and re-uploads it
+void FinishBoltGrowth(BoltMesh* boltMeshPtr, vector<pair<vec3, vec3>>* patternPtr);
 
 // DYNAMIC
-void NewBolt(vector<LineBoltSegment>* segmentsPtr, vector<vec3>* lightsPtr, 
-	vector<pair<vec3, vec3>>* patternPtr);
+void NewBolt(vector<pair<vec3, vec3>>* patternPtr);
 // STATIC
 void NewBolt(LineBoltSegment* segmentsPtr, vec3* lightsPtr,
 	std::shared_ptr<vec3[numSegmentsInPattern]> patternPtr);
@@ -33,4 +46,4 @@ int GetNumLights();
 
 void SetNumLights(int num);
 void SetParticleSystemSeedSegment(vec3 seed);
-void SetMethod(int m);
\ No newline at end of file
+void SetMethod(int m);
\ No newline at end of file
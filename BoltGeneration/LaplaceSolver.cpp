@@ -0,0 +1,140 @@
+#include "LaplaceSolver.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+
+void LaplaceSolver::Init(int _size, int _numThreads) {
+	size = (glm::max(_size, 8) + 7) / 8 * 8;
+	numThreads = glm::clamp(_numThreads, 1, size);
+	halfRow = (size + 2) / 2;
+	// optimal SOR factor for the model problem
+	omega = 2.0f / (1.0f + glm::sin(3.14159265f / float(size + 1)));
+
+	for (int color = 0; color < 2; color++) {
+		potential[color].assign(halfRow * (size + 2) * (size + 2), 0.0f);
+		freeCells[color].assign(halfRow * (size + 2) * (size + 2), 0.0f);
+	}
+	for (int z = 0; z < size + 2; z++) {
+		for (int y = 0; y < size + 2; y++) {
+			// linear background field, the ghost cells keep it as the boundary
+			float background = 1.0f - float(y) / float(size + 1);
+			for (int x = 0; x < size + 2; x++) {
+				ivec3 cell = ivec3(x, y, z);
+				bool interior = x > 0 && x <= size && y > 0 && y <= size && z > 0 && z <= size;
+				potential[Color(cell)][Index(cell)] = background;
+				freeCells[Color(cell)][Index(cell)] = interior ? 1.0f : 0.0f;
+			}
+		}
+	}
+}
+
+void LaplaceSolver::SetFixed(ivec3 cell, float value) {
+	potential[Color(cell)][Index(cell)] = value;
+	freeCells[Color(cell)][Index(cell)] = 0.0f;
+}
+
+int LaplaceSolver::Solve(int maxIterations, float tolerance) {
+	if (maxIterations <= 0) {
+		return 0;
+	}
+
+	// largest change of each thread in the current iteration
+	vector<float> threadChange(numThreads, 0.0f);
+	ThreadBarrier barrier(numThreads);
+	int iterations = 0;
+	bool converged = false;
+
+	auto Worker = [&](int thread) {
+		int zBegin = 1 + size * thread / numThreads;
+		int zEnd = 1 + size * (thread + 1) / numThreads;
+
+		for (int iteration = 0; iteration < maxIterations; iteration++) {
+			// red cells only read black cells and vice versa, so the slabs can
+			// be swept at the same time
+			float change = SweepSlab(0, zBegin, zEnd);
+			barrier.Wait();
+			change = glm::max(change, SweepSlab(1, zBegin, zEnd));
+			threadChange[thread] = change;
+			barrier.Wait();
+
+			if (thread == 0) {
+				iterations = iteration + 1;
+				converged = *std::max_element(threadChange.begin(), threadChange.end()) <= tolerance;
+			}
+			barrier.Wait();
+			if (converged) {
+				break;
+			}
+		}
+	};
+
+	workers.Run(numThreads, Worker);
+	return iterations;
+}
+
+// Updates the cells of one color in z slices [zBegin, zEnd), 
+// returns the largest change.
+float LaplaceSolver::SweepSlab(int color, int zBegin, int zEnd) {
+	const __m128 sixth = _mm_set1_ps(1.0f / 6.0f);
+	const __m128 omega4 = _mm_set1_ps(omega);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 maxChange = _mm_setzero_ps();
+
+	float* cells = potential[color].data();
+	const float* cellsFree = freeCells[color].data();
+	// all the neighbours are the other color
+	const float* neighbours = potential[1 - color].data();
+	const int strideY = halfRow;
+	const int strideZ = halfRow * (size + 2);
+
+	for (int z = zBegin; z < zEnd; z++) {
+		for (int y = 1; y <= size; y++) {
+			// this color's cells in the row have even x when (y + z) has the color's parity,
+			// x = 2k has its x neighbours at k - 1 and k, x = 2k + 1 at k and k + 1
+			bool evenX = ((y + z) & 1) == color;
+			int first = evenX ? 1 : 0;
+			int left = evenX ? -1 : 0;
+			int row = y * strideY + z * strideZ;
+
+			for (int k = row + first; k < row + first + size / 2; k += 4) {
+				const float* n = neighbours + k;
+				__m128 sum = _mm_add_ps(_mm_loadu_ps(n + left), _mm_loadu_ps(n + left + 1));
+				sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(n - strideY), _mm_loadu_ps(n + strideY)));
+				sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(n - strideZ), _mm_loadu_ps(n + strideZ)));
+
+				__m128 old = _mm_loadu_ps(cells + k);
+				__m128 delta = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sum, sixth), old), omega4);
+				// fixed cells don't change
+				delta = _mm_mul_ps(delta, _mm_loadu_ps(cellsFree + k));
+				_mm_storeu_ps(cells + k, _mm_add_ps(old, delta));
+
+				maxChange = _mm_max_ps(maxChange, _mm_and_ps(delta, absMask));
+			}
+		}
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, maxChange);
+	return glm::max(glm::max(lanes[0], lanes[1]), glm::max(lanes[2], lanes[3]));
+}
+
+float LaplaceSolver::Potential(ivec3 cell) const {
+	return potential[Color(cell)][Index(cell)];
+}
+
+bool LaplaceSolver::IsFixed(ivec3 cell) const {
+	return freeCells[Color(cell)][Index(cell)] == 0.0f;
+}
+
+int LaplaceSolver::Size() const {
+	return size;
+}
+
+int LaplaceSolver::Color(ivec3 cell) const {
+	return (cell.x + cell.y + cell.z) & 1;
+}
+
+// index in the cell's color array
+int LaplaceSolver::Index(ivec3 cell) const {
+	return cell.x / 2 + (cell.y + cell.z * (size + 2)) * halfRow;
+}
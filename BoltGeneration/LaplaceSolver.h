@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+#include "../Threading.h"
+
+using glm::ivec3;
+using std::vector;
+
+// Solves Laplace's equation on a cubic grid with red-black successive 
+// over-relaxation, used for the potential field of the DBM bolt generator.
+// Each color is stored in its own array (half rows of x), so a sweep reads one 
+// array and writes the other: rows are updated 4 cells at a time with SSE, and 
+// the sweep is split into z slabs across threads, which are kept between
+// solves. Solves are incremental, the current potential is the initial guess
+// for the next Solve.
+class LaplaceSolver {
+public:
+	// size is rounded up to a multiple of 8. The potential starts as the 
+	// background field: 1 at the bottom (ground) to 0 at the top.
+	void Init(int size, int numThreads);
+	// fixes the potential of an interior cell, 1 <= x, y, z <= size
+	void SetFixed(ivec3 cell, float value);
+	// Runs up to maxIterations red-black iterations, stopping early once no cell
+	// changes by more than tolerance. Returns the number of iterations run.
+	int Solve(int maxIterations, float tolerance);
+
+	float Potential(ivec3 cell) const;
+	bool IsFixed(ivec3 cell) const;
+	int Size() const;
+
+private:
+	int size = 0;
+	int halfRow = 0;	// cells of one color in a row, the grid has a one cell ghost border
+	int numThreads = 1;
+	float omega = 1.0f;
+	// per color, a cell (x, y, z) is in color (x + y + z) % 2
+	vector<float> potential[2];
+	vector<float> freeCells[2];	// 1 for free cells, 0 for fixed and ghost cells
+	WorkerPool workers;
+
+	int Color(ivec3 cell) const;
+	int Index(ivec3 cell) const;
+	float SweepSlab(int color, int zBegin, int zEnd);
+};
@@ -29,6 +29,45 @@ vec3 boltEndPos;
 float startingMaxDisplacement = 12;
 int LSystemDetail = 6;
 
+// DBM
+int dbmGridSize = 48;			// cells along each side, rounded up to a multiple of 8
+float dbmEta = 3.0f;			// higher eta gives straighter, less branched channels
+int dbmIterationsPerStep = 6;	// solver iterations after each growth step
+int dbmNumSegments = 0;
+int dbmSteps = 0;
+float dbmSolveTime = 0;			// ms spent in the solver for the last strike
+LaplaceSolver dbmSolver;
+// the sparse grid only solves a narrow band around the channel, so much larger grids are usable
+bool dbmSparse = false;
+int dbmBandRadius = 1;			// in blocks of 8 cells
+SparseGrid dbmSparseGrid;
+vec3 dbmOrigin;					// world position of the grid's min corner
+float dbmCellSize;
+
+// Space Colonization
+// the leader grows towards attractor points scattered in a cone below the start point
+int colNumAttractors = 4000;
+float colSpread = 12.0f;			// radius of the attractor cone at the ground
+float colInfluenceRadius = 4.0f;	// attractors only pull nodes within this distance
+float colKillDistance = 1.0f;		// attractors are consumed by nodes this close
+float colStepLength = 0.6f;
+float colDownwardBias = 0.3f;		// added to each growth direction
+int colMaxNodes = 20000;
+int colNumNodes = 0;
+int colNumSegments = 0;
+float colGrowTime = 0;				// ms for the last strike
+// attractors are hashed, each keeps its nearest node, updated as nodes are added
+SpatialHash colAttractorHash;
+
+// Scene
+// channels bend towards nearby geometry and end where they reach it
+const SceneSDF* sceneSDF = nullptr;
+const TriangleBVH* sceneBVH = nullptr;	// exact hits, the SDF's are within a cell
+bool sceneAware = true;
+float attractRadius = 6.0f;
+float attractStrength = 0.5f;	// fraction of a step's length turned towards the surface
+int sceneStrikes = 0;			// channels that ended on the scene in the last bolt
+
 // Branching
 bool branching = true;
 int minBranchLength = 5;
@@ -72,6 +111,43 @@ int RandomFlux() {
 	return 1 - (rand() % 2) * 2;
 }
 
+// Scene:
+bool UseScene() {
+	return sceneAware && sceneSDF != nullptr && sceneSDF->IsBaked();
+}
+vec3 SceneStep(vec3 start, vec3 end, bool* struck) {
+	// Bends the step start->end towards geometry within the attraction radius,
+	// and cuts it short where it reaches the scene, setting struck.
+	*struck = false;
+	if (!UseScene()) {
+		return end;
+	}
+	float d = sceneSDF->Distance(end);
+	if (d < attractRadius) {
+		float length = glm::length(end - start);
+		float pull = (1.0f - glm::max(d, 0.0f) / attractRadius) * attractStrength;
+		end -= sceneSDF->Gradient(end) * length * pull;
+	}
+	if (sceneBVH != nullptr) {
+		vec3 dir = end - start;
+		float length = glm::length(dir);
+		BVHHit hit;
+		if (length > 0 && sceneBVH->Intersect(start, dir / length, length, &hit)) {
+			*struck = true;
+			sceneStrikes++;
+			return start + dir * (hit.t / length);
+		}
+		return end;
+	}
+	vec3 hit;
+	if (sceneSDF->Raymarch(start, end, 0.0f, &hit)) {
+		*struck = true;
+		sceneStrikes++;
+		return hit;
+	}
+	return end;
+}
+
 // Random Positions:
 glm::vec3 NextPoint(glm::vec3 point) {
 	int vVariationDiff = vVariationMax - vVariationMin;
@@ -271,8 +347,9 @@ void LSystemSubDivide(vec3 start, vec3 end, int startIndex, int endIndex, int de
 void RandomPositionsBranch(vec3 start, int size, vector<pair<vec3, vec3>>* patternPtr) {
 
 	vec3 end;
-	for (int i = 0; i < size; i++) {
-		end = NextPoint(start);
+	bool struck = false;
+	for (int i = 0; i < size && !struck; i++) {
+		end = SceneStep(start, NextPoint(start), &struck);
 		patternPtr->push_back({ ConvertWorldToScreen(start), ConvertWorldToScreen(end) });
 		start = end;
 	}
@@ -288,12 +365,16 @@ void ParticleSystemBranch(vec3 start, vec3 seed, int size, vector<pair<vec3, vec
 	// get the axis to rotate around
 	pair<vec3, vec3> seedPerpAxis = GetRotationAxis(seed);
 
+	bool struck = false;
 	vec3 prevEnd = start;
-	vec3 newPoint = start + seed * length(gen) * lengthMultiplyer;
+	vec3 newPoint = SceneStep(start, start + seed * length(gen) * lengthMultiplyer, &struck);
 
 	for (int i = 0; i < size; i++) {
 		// add the new segment to the pattern
 		patternPtr->push_back({ ConvertWorldToScreen(prevEnd), ConvertWorldToScreen(newPoint) });
+		if (struck) {
+			break;
+		}
 
 		prevEnd = newPoint;
 
@@ -301,7 +382,7 @@ void ParticleSystemBranch(vec3 start, vec3 seed, int size, vector<pair<vec3, vec
 		vec3 newPointMove = seed * length(gen) * lengthMultiplyer;
 		// rotate with respect to the seed
 		newPointMove = RotatePointAboutSeed(newPointMove, seedPerpAxis);
-		newPoint = prevEnd + newPointMove;
+		newPoint = SceneStep(prevEnd, prevEnd + newPointMove, &struck);
 	}
 }
 vec3 LSystemBranch(vec3 dir) {
@@ -317,6 +398,273 @@ vec3 LSystemBranch(vec3 dir) {
 
 	return vec3(0);
 }
+
+// DBM:
+vec3 DBMCellCenter(ivec3 cell) {
+	// interior cells start at 1, 0 is the ghost border
+	return dbmOrigin + (vec3(cell) - 0.5f) * dbmCellSize;
+}
+void SetupDBMGrid() {
+	// a cube from the ground (the end point's height) up to at least the start point,
+	// centred horizontally between the start and end points
+	float height = glm::max(boltStartPos.y - boltEndPos.y, 1.0f);
+	float width = glm::max(glm::abs(boltStartPos.x - boltEndPos.x), glm::abs(boltStartPos.z - boltEndPos.z));
+	float side = glm::max(height, width * 2.0f);
+
+	int numThreads = glm::max(int(std::thread::hardware_concurrency()), 1);
+	int size;
+	if (dbmSparse) {
+		dbmSparseGrid.Init(dbmGridSize, numThreads);
+		dbmSparseGrid.SetBandRadius(dbmBandRadius);
+		size = dbmSparseGrid.Size();
+	}
+	else {
+		dbmSolver.Init(dbmGridSize, numThreads);
+		size = dbmSolver.Size();
+	}
+	dbmCellSize = side / float(size);
+	dbmOrigin = vec3((boltStartPos.x + boltEndPos.x - side) * 0.5f, boltEndPos.y,
+		(boltStartPos.z + boltEndPos.z - side) * 0.5f);
+
+	// cells inside geometry are held at the ground's potential, so the field pulls
+	// the channel towards tall geometry. Not done for the sparse grid, as it would
+	// activate every block the geometry passes through, there the channel only
+	// stops when it reaches the geometry.
+	if (UseScene() && !dbmSparse) {
+		for (int z = 1; z <= size; z++) {
+			for (int y = 1; y <= size; y++) {
+				for (int x = 1; x <= size; x++) {
+					if (sceneSDF->Distance(DBMCellCenter(ivec3(x, y, z))) < 0) {
+						dbmSolver.SetFixed(ivec3(x, y, z), 1.0f);
+					}
+				}
+			}
+		}
+	}
+}
+// Solver is a LaplaceSolver or a SparseGrid
+template <class Solver>
+int DBMGrowChannel(Solver* solver, vector<ivec3>* cells, vector<int>* parents) {
+	// Grows the channel from the start cell until it reaches the bottom row (the ground).
+	// Each cell's parent is the channel cell it grew from, -1 for the start cell.
+	// Returns the index of the last cell added.
+	int n = solver->Size();
+	auto GridIndex = [n](ivec3 c) { return (long long)(c.x - 1) + (long long)(c.y - 1) * n + (long long)(c.z - 1) * n * n; };
+
+	// only the channel and its neighbours are stored, so large grids don't need dense arrays.
+	// candidates map to the channel cell they were found from.
+	std::unordered_map<long long, int> candidateParent;
+	std::unordered_set<long long> channel;
+	vector<ivec3> candidates;
+	vector<float> weights;
+
+	auto AddToChannel = [&](ivec3 cell, int parent) {
+		int channelIndex = cells->size();
+		cells->push_back(cell);
+		parents->push_back(parent);
+		channel.insert(GridIndex(cell));
+		solver->SetFixed(cell, 0.0f);
+
+		// the 26 neighbours become growth candidates
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					ivec3 neighbour = cell + ivec3(dx, dy, dz);
+					if (glm::any(glm::lessThan(neighbour, ivec3(1))) || glm::any(glm::greaterThan(neighbour, ivec3(n)))) {
+						continue;
+					}
+					long long i = GridIndex(neighbour);
+					if (!channel.count(i) && !candidateParent.count(i)) {
+						candidateParent[i] = channelIndex;
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+		}
+	};
+
+	ivec3 startCell = glm::clamp(ivec3(glm::floor((boltStartPos - dbmOrigin) / dbmCellSize)) + 1, ivec3(1), ivec3(n));
+	AddToChannel(startCell, -1);
+	// the first solve converges from the background field, later ones start from the previous field
+	solver->Solve(4 * n, 1e-4f);
+
+	std::uniform_real_distribution<float> roll(0.0f, 1.0f);
+	const int maxSteps = 20 * n;
+	for (dbmSteps = 0; dbmSteps < maxSteps && !candidates.empty(); dbmSteps++) {
+		// pick a candidate with probability proportional to potential^eta
+		weights.resize(candidates.size());
+		float totalWeight = 0;
+		for (unsigned int c = 0; c < candidates.size(); c++) {
+			weights[c] = glm::pow(glm::max(solver->Potential(candidates[c]), 0.0f), dbmEta);
+			totalWeight += weights[c];
+		}
+		float target = roll(gen) * totalWeight;
+		unsigned int chosen = 0;
+		for (; chosen < candidates.size() - 1; chosen++) {
+			target -= weights[chosen];
+			if (target <= 0) {
+				break;
+			}
+		}
+
+		ivec3 cell = candidates[chosen];
+		candidates[chosen] = candidates.back();
+		candidates.pop_back();
+		AddToChannel(cell, candidateParent[GridIndex(cell)]);
+		candidateParent.erase(GridIndex(cell));
+
+		if (cell.y == 1) {
+			break;	// reached the ground
+		}
+		if (UseScene() && sceneSDF->Distance(DBMCellCenter(cell)) < dbmCellSize * 0.5f) {
+			sceneStrikes++;
+			break;	// reached the scene
+		}
+		solver->Solve(dbmIterationsPerStep, 1e-4f);
+	}
+	return cells->size() - 1;
+}
+int DBMGrowChannel(vector<ivec3>* cells, vector<int>* parents) {
+	if (dbmSparse) {
+		return DBMGrowChannel(&dbmSparseGrid, cells, parents);
+	}
+	return DBMGrowChannel(&dbmSolver, cells, parents);
+}
+vector<vec3> DBMMainChannel(const vector<ivec3>& cells, const vector<int>& parents, int last) {
+	// Returns the points from the start cell down to the last cell, then to the ground
+	vector<vec3> points;
+	for (int c = last; c >= 0; c = parents[c]) {
+		points.push_back(DBMCellCenter(cells[c]));
+	}
+	std::reverse(points.begin(), points.end());
+	if (cells[last].y == 1) {
+		vec3 ground = points.back();
+		ground.y = dbmOrigin.y;
+		points.push_back(ground);
+	}
+	return points;
+}
+
+// Space Colonization:
+int ColonizationGrow(vector<vec3>* nodes, vector<int>* parents) {
+	// Grows the tree from the start point until a node reaches the ground (the end 
+	// point's height) or the scene. Each node's parent is the node it grew from,
+	// -1 for the start node. Returns the node that struck, or the lowest node.
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	float ground = boltEndPos.y;
+
+	// scatter the attractors, the cone widens from the start point down to the ground
+	vector<vec3> attractors(colNumAttractors);
+	vector<int> nearestNode(colNumAttractors, -1);
+	vector<float> nearestDistanceSq(colNumAttractors, colInfluenceRadius * colInfluenceRadius);
+	vector<bool> alive(colNumAttractors, true);
+	colAttractorHash.Init(colInfluenceRadius);
+	for (int a = 0; a < colNumAttractors; a++) {
+		float t = unit(gen);
+		float radius = colSpread * glm::sqrt(unit(gen)) * (0.2f + 0.8f * t);
+		float angle = unit(gen) * 6.2831853f;
+		vec3 axis = glm::mix(boltStartPos, vec3(boltEndPos.x, ground, boltEndPos.z), t);
+		attractors[a] = axis + vec3(glm::cos(angle) * radius, 0, glm::sin(angle) * radius);
+		colAttractorHash.Insert(a, attractors[a]);
+	}
+
+	// new nodes only change the nearest node of the attractors around them, 
+	// and consume the attractors within the kill distance
+	vector<int> nearby;
+	float killDistanceSq = colKillDistance * colKillDistance;
+	auto AddNode = [&](vec3 p, int parent) {
+		int node = nodes->size();
+		nodes->push_back(p);
+		parents->push_back(parent);
+
+		nearby.clear();
+		colAttractorHash.Query(p, colInfluenceRadius, &nearby);
+		for (int a : nearby) {
+			vec3 offset = attractors[a] - p;
+			float distanceSq = glm::dot(offset, offset);
+			if (distanceSq < killDistanceSq) {
+				alive[a] = false;
+				colAttractorHash.Remove(a, attractors[a]);
+			}
+			else if (distanceSq < nearestDistanceSq[a]) {
+				nearestDistanceSq[a] = distanceSq;
+				nearestNode[a] = node;
+			}
+		}
+		return node;
+	};
+
+	AddNode(boltStartPos, -1);
+	int lowest = 0;
+	vector<int> activeAttractors(colNumAttractors);
+	for (int a = 0; a < colNumAttractors; a++) {
+		activeAttractors[a] = a;
+	}
+	vector<vec3> growth;
+	vector<int> growing;
+	std::normal_distribution<float> jitter(0.0f, 0.15f);
+
+	while (int(nodes->size()) < colMaxNodes) {
+		// sum the directions to each node's attractors, dropping consumed attractors
+		growth.resize(nodes->size(), vec3(0.0f));
+		growing.clear();
+		unsigned int kept = 0;
+		for (int a : activeAttractors) {
+			if (!alive[a]) {
+				continue;
+			}
+			activeAttractors[kept++] = a;
+			int node = nearestNode[a];
+			if (node < 0) {
+				continue;
+			}
+			if (growth[node] == vec3(0.0f)) {
+				growing.push_back(node);
+			}
+			growth[node] += glm::normalize(attractors[a] - (*nodes)[node]);
+		}
+		activeAttractors.resize(kept);
+
+		// nothing in reach, the leader steps from its lowest node towards the ground
+		if (growing.empty()) {
+			vec3 toGround = vec3(boltEndPos.x, ground, boltEndPos.z) - (*nodes)[lowest];
+			growth[lowest] = glm::length(toGround) > 0 ? glm::normalize(toGround) : vec3(0, -1, 0);
+			growing.push_back(lowest);
+		}
+
+		for (int node : growing) {
+			vec3 dir = growth[node];
+			growth[node] = vec3(0.0f);
+			float length = glm::length(dir);
+			dir = (length > 0 ? dir / length : vec3(0.0f)) + vec3(jitter(gen), jitter(gen) - colDownwardBias, jitter(gen));
+			dir = glm::length(dir) > 0 ? glm::normalize(dir) : vec3(0, -1, 0);
+			vec3 start = (*nodes)[node];
+			bool struck;
+			vec3 end = SceneStep(start, start + dir * colStepLength, &struck);
+			if (end.y <= ground) {
+				end.y = ground;
+				struck = true;
+			}
+			int child = AddNode(end, node);
+			if (struck) {
+				return child;
+			}
+			if (end.y < (*nodes)[lowest].y) {
+				lowest = child;
+			}
+		}
+	}
+	return lowest;
+}
+vector<vec3> ColonizationMainChannel(const vector<vec3>& nodes, const vector<int>& parents, int last) {
+	// Returns the points from the start node down to the last node
+	vector<vec3> points;
+	for (int n = last; n >= 0; n = parents[n]) {
+		points.push_back(nodes[n]);
+	}
+	std::reverse(points.begin(), points.end());
+	return points;
+}
 // --------------------------------------------------
 
 // Public Functions ---------------------------------
@@ -327,13 +675,17 @@ int GenerateRandomPositionsPattern(
 	std::shared_ptr<vec3[numSegmentsInPattern]> patternPtr) {
 	
 	vec3 start = boltStartPos;
+	sceneStrikes = 0;
 
 	patternPtr.get()[0] = ConvertWorldToScreen(start);
+	bool struck = false;
 	for (int i = 1; i < numSegmentsInPattern; i++) {
-		start = NextPoint(start);
+		start = SceneStep(start, NextPoint(start), &struck);
 		patternPtr.get()[i] = ConvertWorldToScreen(start);
+		if (struck) {
+			return i + 1;
+		}
 	}
-	// will always have the same size
 	return numSegmentsInPattern;
 }
 //DYNAMIC BOLT
@@ -344,17 +696,20 @@ vector<pair<vec3, vec3>>* GenerateRandomPositionsPattern(
 
 	vec3 end;
 	vec3 start = boltStartPos;
-	for (int i = 0; i < rNumSegments; i++) {
-		end = NextPoint(start);
+	sceneStrikes = 0;
+	bool struck = false;
+	for (int i = 0; i < rNumSegments && !struck; i++) {
+		end = SceneStep(start, NextPoint(start), &struck);
 		patternPtr->push_back({ ConvertWorldToScreen(start), ConvertWorldToScreen(end) });
 
 		// Branch
-		if (branching && RollBranchChance(randomPositionsBranchChance)) {
+		if (branching && !struck && RollBranchChance(randomPositionsBranchChance)) {
 			RandomPositionsBranch(end, BranchLength(), patternPtr);
 		}
 
 		start = end;
 	}
+	SimplifyBoltPattern(patternPtr);
 
 	return patternPtr;
 }
@@ -372,14 +727,19 @@ int GenerateParticleSystemPattern(
 	// get the axis to rotate around
 	pair<vec3, vec3> seedPerpAxis = GetRotationAxis(seed);
 
+	sceneStrikes = 0;
+	bool struck = false;
 	vec3 prevEnd = boltStartPos;
-	vec3 newPoint = prevEnd + seed * length(gen) * lengthMultiplyer;
+	vec3 newPoint = SceneStep(prevEnd, prevEnd + seed * length(gen) * lengthMultiplyer, &struck);
 
 	// add the first segment to the pattern
 	patternPtr.get()[0] = ConvertWorldToScreen(prevEnd);
 	for (int i = 1; i < numSegmentsInPattern; i++) {
 		// add the new segment to the pattern
 		patternPtr.get()[i] = ConvertWorldToScreen(newPoint);
+		if (struck) {
+			return i + 1;
+		}
 
 		prevEnd = newPoint;
 
@@ -388,9 +748,8 @@ int GenerateParticleSystemPattern(
 		vec3 newPointMove = seed * length(gen) * lengthMultiplyer;
 		// rotate the point with respect to seed's perpendicular axis
 		newPointMove = RotatePointAboutSeed(newPointMove, seedPerpAxis);
-		newPoint = prevEnd + newPointMove;
+		newPoint = SceneStep(prevEnd, prevEnd + newPointMove, &struck);
 	}
-	// will always have the same size
 	return numSegmentsInPattern;
 
 }
@@ -408,12 +767,14 @@ vector<pair<vec3, vec3>>* GenerateParticleSystemPattern(
 	// get the axis to rotate around
 	pair<vec3, vec3> seedPerpAxis = GetRotationAxis(seed);
 
+	sceneStrikes = 0;
+	bool struck = false;
 	vec3 prevEnd = boltStartPos;
-	vec3 newPoint = prevEnd + seed * length(gen) * lengthMultiplyer;
+	vec3 newPoint = SceneStep(prevEnd, prevEnd + seed * length(gen) * lengthMultiplyer, &struck);
 	// add first segment to the pattern
 	patternPtr->push_back({ ConvertWorldToScreen(prevEnd), ConvertWorldToScreen(newPoint) });
 
-	for (int i = 0; i < pNumSegments; i++) {
+	for (int i = 0; i < pNumSegments && !struck; i++) {
 
 		// Branch
 		if (branching && RollBranchChance(particleSystemBranchChance)) {
@@ -429,12 +790,13 @@ vector<pair<vec3, vec3>>* GenerateParticleSystemPattern(
 
 		// roate with respect to the seed
 		newPointMove = RotatePointAboutSeed(newPointMove, seedPerpAxis);
-		newPoint = prevEnd + newPointMove;
+		newPoint = SceneStep(prevEnd, prevEnd + newPointMove, &struck);
 
 		// add the new segment to the pattern
 		patternPtr->push_back({ ConvertWorldToScreen(prevEnd), ConvertWorldToScreen(newPoint) });
 
 	}
+	SimplifyBoltPattern(patternPtr);
 
 	return patternPtr;
 }
@@ -509,6 +871,10 @@ vector<pair<vec3, vec3>>* GenerateLSystemPattern(vector<pair<vec3, vec3>>* patte
 
 	float maxDisplacement = startingMaxDisplacement;
 
+	// LOD: segments below the screen space error aren't subdivided any further
+	vector<pair<vec3, vec3>> finished;
+	int segmentsSkipped = 0;	// that full detail would have subdivided them into
+
 	for (int d = LSystemDetail; d > 0; d--) {
 
 		int numSegments = segmentsRead->size();
@@ -520,6 +886,12 @@ vector<pair<vec3, vec3>>* GenerateLSystemPattern(vector<pair<vec3, vec3>>* patte
 			pair<vec3, vec3> currentSeg = segmentsRead->back();
 			segmentsRead->pop_back();
 
+			if (BelowBoltLODError(currentSeg.first, currentSeg.second)) {
+				finished.push_back(currentSeg);
+				segmentsSkipped += (1 << glm::min(d, 20)) - 1;
+				continue;
+			}
+
 			// calculate mid point
 			vec3 mid = GetMidPnt(currentSeg.first, currentSeg.second, maxDisplacement);
 
@@ -538,7 +910,10 @@ vector<pair<vec3, vec3>>* GenerateLSystemPattern(vector<pair<vec3, vec3>>* patte
 
 				vec3 branchEnd = mid + (dir * LSystemBranchScaler);
 
-				segmentsWrite->push_back({ mid, branchEnd });
+				// branches too small to see aren't started
+				if (!BelowBoltLODError(mid, branchEnd)) {
+					segmentsWrite->push_back({ mid, branchEnd });
+				}
 			}
 		}
 
@@ -555,14 +930,134 @@ vector<pair<vec3, vec3>>* GenerateLSystemPattern(vector<pair<vec3, vec3>>* patte
 	for (int i = 0; i < segmentsRead->size(); i++) {
 		patternPtr->push_back({ segmentsRead->at(i).first, segmentsRead->at(i).second });
 	}
-	lNumSegments = segmentsRead->size();
+	patternPtr->insert(patternPtr->end(), finished.begin(), finished.end());
+	lNumSegments = patternPtr->size();
+	RecordBoltLOD(lNumSegments, lNumSegments + segmentsSkipped);
 
 	return patternPtr;
 }
 // --------------------------
 
+// DBM ----------------------
+//STATIC BOLT
+// Only the main channel, resampled to fit the pattern
+int GenerateDBMPattern(std::shared_ptr<vec3[numSegmentsInPattern]> patternPtr) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	sceneStrikes = 0;
+	SetupDBMGrid();
+	vector<ivec3> cells;
+	vector<int> parents;
+	int last = DBMGrowChannel(&cells, &parents);
+	vector<vec3> points = DBMMainChannel(cells, parents, last);
+
+	int size = glm::min(int(points.size()), numSegmentsInPattern);
+	for (int i = 0; i < size; i++) {
+		int point = size > 1 ? i * (int(points.size()) - 1) / (size - 1) : 0;
+		patternPtr[i] = ConvertWorldToScreen(points[point]);
+	}
+
+	auto t2 = std::chrono::high_resolution_clock::now();
+	dbmSolveTime = std::chrono::duration<float, std::milli>(t2 - t1).count();
+	return size;
+}
+//DYNAMIC BOLT
+// Every channel cell is a segment from its parent, in growth order. 
+// Without branching only the main channel is kept.
+vector<pair<vec3, vec3>>* GenerateDBMPattern(vector<pair<vec3, vec3>>* patternPtr) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	patternPtr->clear();
+	sceneStrikes = 0;
+	SetupDBMGrid();
+	vector<ivec3> cells;
+	vector<int> parents;
+	int last = DBMGrowChannel(&cells, &parents);
+
+	if (branching) {
+		for (unsigned int c = 1; c < cells.size(); c++) {
+			patternPtr->push_back({ ConvertWorldToScreen(DBMCellCenter(cells[parents[c]])),
+				ConvertWorldToScreen(DBMCellCenter(cells[c])) });
+		}
+		if (cells[last].y == 1) {
+			vec3 end = DBMCellCenter(cells[last]);
+			patternPtr->push_back({ ConvertWorldToScreen(end), 
+				ConvertWorldToScreen(vec3(end.x, dbmOrigin.y, end.z)) });
+		}
+	}
+	else {
+		vector<vec3> points = DBMMainChannel(cells, parents, last);
+		for (unsigned int i = 0; i + 1 < points.size(); i++) {
+			patternPtr->push_back({ ConvertWorldToScreen(points[i]), ConvertWorldToScreen(points[i + 1]) });
+		}
+	}
+	SimplifyBoltPattern(patternPtr);
+	dbmNumSegments = patternPtr->size();
+
+	auto t2 = std::chrono::high_resolution_clock::now();
+	dbmSolveTime = std::chrono::duration<float, std::milli>(t2 - t1).count();
+	return patternPtr;
+}
+// --------------------------
+
+// Space Colonization -------
+//STATIC BOLT
+// Only the main channel, resampled to fit the pattern
+int GenerateColonizationPattern(std::shared_ptr<vec3[numSegmentsInPattern]> patternPtr) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	sceneStrikes = 0;
+	vector<vec3> nodes;
+	vector<int> parents;
+	int last = ColonizationGrow(&nodes, &parents);
+	vector<vec3> points = ColonizationMainChannel(nodes, parents, last);
+	colNumNodes = nodes.size();
+
+	int size = glm::min(int(points.size()), numSegmentsInPattern);
+	for (int i = 0; i < size; i++) {
+		int point = size > 1 ? i * (int(points.size()) - 1) / (size - 1) : 0;
+		patternPtr[i] = ConvertWorldToScreen(points[point]);
+	}
+
+	auto t2 = std::chrono::high_resolution_clock::now();
+	colGrowTime = std::chrono::duration<float, std::milli>(t2 - t1).count();
+	return size;
+}
+//DYNAMIC BOLT
+// Every node is a segment from its parent, in growth order. 
+// Without branching only the main channel is kept.
+vector<pair<vec3, vec3>>* GenerateColonizationPattern(vector<pair<vec3, vec3>>* patternPtr) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	patternPtr->clear();
+	sceneStrikes = 0;
+	vector<vec3> nodes;
+	vector<int> parents;
+	int last = ColonizationGrow(&nodes, &parents);
+	colNumNodes = nodes.size();
+
+	if (branching) {
+		for (unsigned int n = 1; n < nodes.size(); n++) {
+			patternPtr->push_back({ ConvertWorldToScreen(nodes[parents[n]]), ConvertWorldToScreen(nodes[n]) });
+		}
+	}
+	else {
+		vector<vec3> points = ColonizationMainChannel(nodes, parents, last);
+		for (unsigned int i = 0; i + 1 < points.size(); i++) {
+			patternPtr->push_back({ ConvertWorldToScreen(points[i]), ConvertWorldToScreen(points[i + 1]) });
+		}
+	}
+	SimplifyBoltPattern(patternPtr);
+	colNumSegments = patternPtr->size();
+
+	auto t2 = std::chrono::high_resolution_clock::now();
+	colGrowTime = std::chrono::duration<float, std::milli>(t2 - t1).count();
+	return patternPtr;
+}
+// --------------------------
+
 // GUI ----------------------
-// method: 0 - Random, 1 - Particle, 2 - L-System
+// method: 0 - Random, 1 - Particle, 2 - L-System, 3 - DBM, 4 - Space Colonization
 void BoltGenerationGUI(int method) {
 	ImGui::SetNextWindowPos(ImVec2(5, 383), ImGuiCond_Once);
 
@@ -611,6 +1106,48 @@ void BoltGenerationGUI(int method) {
 		if (ImGui::RadioButton("Matrix", particleRotation == 1)) 
 			{ particleRotation = 1; };
 		break;
+	case 3:
+		ImGui::Text("Dielectric Breakdown");
+		ImGui::Separator();
+		ImGui::Text("Grid Size");
+		ImGui::InputInt("##dbmGrid", &dbmGridSize, 8, 32);
+		dbmGridSize = glm::clamp(dbmGridSize, 8, dbmSparse ? 1024 : 256);
+		ImGui::Checkbox("Sparse Grid", &dbmSparse);
+		if (dbmSparse) {
+			ImGui::Text("Band Radius (blocks)");
+			ImGui::SliderInt("##dbmBand", &dbmBandRadius, 0, 4);
+			ImGui::Text("Active Blocks: %d (%.1f MB)", dbmSparseGrid.NumActiveBlocks(), 
+				float(dbmSparseGrid.MemoryBytes()) / (1024 * 1024));
+		}
+		ImGui::Text("Eta");
+		ImGui::SliderFloat("##dbmEta", &dbmEta, 0.5f, 8.0f);
+		ImGui::Text("Solver Iterations per Step");
+		ImGui::SliderInt("##dbmIterations", &dbmIterationsPerStep, 1, 32);
+		ImGui::Separator();
+		ImGui::Text("Last Strike: %d steps, %.1f ms", dbmSteps, dbmSolveTime);
+		break;
+	case 4:
+		ImGui::Text("Space Colonization");
+		ImGui::Separator();
+		ImGui::Text("Attractors");
+		ImGui::InputInt("##colAttractors", &colNumAttractors, 500, 5000);
+		colNumAttractors = glm::clamp(colNumAttractors, 0, 200000);
+		ImGui::Text("Spread");
+		ImGui::SliderFloat("##colSpread", &colSpread, 1.0f, 50.0f);
+		ImGui::Text("Influence Radius");
+		ImGui::SliderFloat("##colInfluence", &colInfluenceRadius, 0.5f, 16.0f);
+		ImGui::Text("Kill Distance");
+		ImGui::SliderFloat("##colKill", &colKillDistance, 0.1f, colInfluenceRadius);
+		ImGui::Text("Step Length");
+		ImGui::SliderFloat("##colStep", &colStepLength, 0.1f, 4.0f);
+		ImGui::Text("Downward Bias");
+		ImGui::SliderFloat("##colBias", &colDownwardBias, 0.0f, 2.0f);
+		ImGui::Text("Max Nodes");
+		ImGui::InputInt("##colMaxNodes", &colMaxNodes, 1000, 10000);
+		colMaxNodes = glm::clamp(colMaxNodes, 1, 200000);
+		ImGui::Separator();
+		ImGui::Text("Last Strike: %d nodes, %.1f ms", colNumNodes, colGrowTime);
+		break;
 	}
 
 	ImGui::Separator();
@@ -625,8 +1162,29 @@ void BoltGenerationGUI(int method) {
 	case 2:
 		ImGui::Text("%d", lNumSegments);
 		break;
+	case 3:
+		ImGui::Text("%d", dbmNumSegments);
+		break;
+	case 4:
+		ImGui::Text("%d", colNumSegments);
+		break;
 	}
 	
+	if (sceneSDF != nullptr && method != 2) {
+		ImGui::Separator();
+		ImGui::Checkbox("Strike Scene", &sceneAware);
+		if (sceneAware) {
+			// DBM is attracted through the potential field instead
+			if (method != 3) {
+				ImGui::Text("Attraction Radius");
+				ImGui::SliderFloat("##attractRadius", &attractRadius, 0.5f, sceneSDF->MaxDistance());
+				ImGui::Text("Attraction Strength");
+				ImGui::SliderFloat("##attractStrength", &attractStrength, 0.0f, 1.0f);
+			}
+			ImGui::Text("Scene Strikes: %d", sceneStrikes);
+		}
+	}
+
 	ImGui::Checkbox("Branching", &branching);
 	if (branching) {
 		ImGui::Separator();
@@ -643,6 +1201,12 @@ void BoltGenerationGUI(int method) {
 		case 2:
 			ImGui::InputFloat("##lsChance", &LSystemBranchChance, 0.1, 1, "%.1f");
 			break;
+		case 3:
+			ImGui::Text("Set by Eta");
+			break;
+		case 4:
+			ImGui::Text("Set by the Attractors");
+			break;
 		}
 	}
 
@@ -673,11 +1237,27 @@ void SetParticleOptions(vec3 seed) {
 	particleSeed = normalize(seed);
 }
 
+void SetDBMOptions(int gridSize, float eta, bool sparse) {
+	dbmGridSize = gridSize;
+	dbmEta = eta;
+	dbmSparse = sparse;
+}
+
+void SetColonizationOptions(int numAttractors, float spread) {
+	colNumAttractors = numAttractors;
+	colSpread = spread;
+}
+
 void SetNumSegments(int num) {
 	rNumSegments = num;
 	pNumSegments = num;
 	// can't set the number of segments for L-System
 }
+
+void SetScene(const SceneSDF* sdf, const TriangleBVH* bvh) {
+	sceneSDF = sdf;
+	sceneBVH = bvh;
+}
 // --------------------------
 
-// --------------------------------------------------
\ No newline at end of file
+// --------------------------------------------------
\ No newline at end of file
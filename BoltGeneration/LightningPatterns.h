@@ -9,11 +9,22 @@
 #include <iostream>
 #include <cmath>
 #include <imgui/imgui.h>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "../FunctionLibrary.h"
+#include "LaplaceSolver.h"
+#include "SparseGrid.h"
+#include "SpatialHash.h"
+#include "BoltLOD.h"
+#include "../Scene/SceneSDF.h"
 
 using glm::vec3;
 using glm::mat4;
+using glm::ivec3;
 using glm::quat;
 using std::vector;
 using std::pair;
@@ -38,6 +49,16 @@ vector<pair<vec3, vec3>>* GenerateLSystemPattern(vector<pair<vec3, vec3>>* patte
 vector<pair<vec3, vec3>>* GenerateLSystemPattern(vector<pair<vec3, vec3>>* patternPtr, bool x);
 // ----------------------
 
+// DBM ------------------
+int GenerateDBMPattern(std::shared_ptr<vec3[numSegmentsInPattern]> patternPtr);
+vector<pair<vec3, vec3>>* GenerateDBMPattern(vector<pair<vec3, vec3>>* patternPtr);
+// ----------------------
+
+// Space Colonization ---
+int GenerateColonizationPattern(std::shared_ptr<vec3[numSegmentsInPattern]> patternPtr);
+vector<pair<vec3, vec3>>* GenerateColonizationPattern(vector<pair<vec3, vec3>>* patternPtr);
+// ----------------------
+
 // GUI
 void BoltGenerationGUI(int method);
 
@@ -47,4 +68,9 @@ void SetEndPos(vec3 end);
 void SetLSystemOptions(vec3 end, int detail, float maxDisplacement);
 void SetRandomOptions(bool _scale);
 void SetParticleOptions(vec3 seed);
-void SetNumSegments(int num);
\ No newline at end of file
+void SetDBMOptions(int gridSize, float eta, bool sparse = false);
+void SetColonizationOptions(int numAttractors, float spread);
+void SetNumSegments(int num);
+// scene the generators attract to and terminate at, nullptr to ignore the scene.
+// Without a bvh, hits are found by sphere tracing the sdf.
+void SetScene(const SceneSDF* sdf, const TriangleBVH* bvh = nullptr);
\ No newline at end of file
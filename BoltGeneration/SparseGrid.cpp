@@ -0,0 +1,256 @@
+#include "SparseGrid.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+
+void SparseGrid::Init(int _size, int _numThreads) {
+	size = (glm::max(_size, GRID_BLOCK_SIZE) + GRID_BLOCK_SIZE - 1) / GRID_BLOCK_SIZE * GRID_BLOCK_SIZE;
+	blocksPerSide = size / GRID_BLOCK_SIZE;
+	numThreads = glm::max(_numThreads, 1);
+	// optimal SOR factor for the model problem
+	omega = 2.0f / (1.0f + glm::sin(3.14159265f / float(size + 1)));
+
+	blocks.clear();
+	blockLookup.clear();
+	backgroundRows.resize((size + 2) * 4);
+	for (int y = 0; y < size + 2; y++) {
+		for (int i = 0; i < 4; i++) {
+			backgroundRows[y * 4 + i] = Background(y);
+		}
+	}
+}
+
+void SparseGrid::SetFixed(ivec3 cell, float value) {
+	ivec3 coord = (cell - 1) / GRID_BLOCK_SIZE;
+
+	// narrow band around the cell, and the ground below it
+	for (int z = coord.z - bandRadius; z <= coord.z + bandRadius; z++) {
+		for (int x = coord.x - bandRadius; x <= coord.x + bandRadius; x++) {
+			for (int y = coord.y - bandRadius; y <= coord.y + bandRadius; y++) {
+				ActivateBlock(ivec3(x, y, z));
+			}
+			ActivateBlock(ivec3(x, 0, z));
+		}
+	}
+
+	GridBlock& block = blocks[FindBlock(coord)];
+	ivec3 local = cell - 1 - coord * GRID_BLOCK_SIZE;
+	int color = (local.x + local.y + local.z) & 1;
+	block.potential[color][local.z][local.y][local.x / 2] = value;
+	block.freeCells[color][local.z][local.y][local.x / 2] = 0.0f;
+}
+
+int SparseGrid::Solve(int maxIterations, float tolerance) {
+	if (maxIterations <= 0 || blocks.empty()) {
+		return 0;
+	}
+
+	int threads = glm::min(numThreads, int(blocks.size()));
+	vector<float> threadChange(threads, 0.0f);
+	ThreadBarrier barrier(threads);
+	int iterations = 0;
+	bool converged = false;
+
+	auto Worker = [&](int thread) {
+		int begin = int(blocks.size()) * thread / threads;
+		int end = int(blocks.size()) * (thread + 1) / threads;
+
+		for (int iteration = 0; iteration < maxIterations; iteration++) {
+			// red cells only read black cells and vice versa. Block coordinates are
+			// off by one from the grid's, so color 1 here is LaplaceSolver's color 0,
+			// swept first so both solvers do the same updates.
+			float change = SweepBlocks(1, begin, end);
+			barrier.Wait();
+			change = glm::max(change, SweepBlocks(0, begin, end));
+			threadChange[thread] = change;
+			barrier.Wait();
+
+			if (thread == 0) {
+				iterations = iteration + 1;
+				converged = *std::max_element(threadChange.begin(), threadChange.end()) <= tolerance;
+			}
+			barrier.Wait();
+			if (converged) {
+				break;
+			}
+		}
+	};
+
+	workers.Run(threads, Worker);
+	return iterations;
+}
+
+// Updates one color of blocks [begin, end), returns the largest change
+float SparseGrid::SweepBlocks(int color, int begin, int end) {
+	const __m128 sixth = _mm_set1_ps(1.0f / 6.0f);
+	const __m128 omega4 = _mm_set1_ps(omega);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 maxChange = _mm_setzero_ps();
+
+	for (int b = begin; b < end; b++) {
+		GridBlock& block = blocks[b];
+		for (int z = 0; z < GRID_BLOCK_SIZE; z++) {
+			for (int y = 0; y < GRID_BLOCK_SIZE; y++) {
+				StencilRows stencil = GetStencil(b, color, y, z);
+
+				// this color's cells have even x when (y + z) has the color's parity,
+				// x = 2k has its x neighbours at k - 1 and k, x = 2k + 1 at k and k + 1
+				const float* r = stencil.row;
+				__m128 row = _mm_loadu_ps(r);
+				__m128 left, right;
+				if (((y + z) & 1) == color) {
+					left = _mm_setr_ps(stencil.left, r[0], r[1], r[2]);
+					right = row;
+				}
+				else {
+					left = row;
+					right = _mm_setr_ps(r[1], r[2], r[3], stencil.right);
+				}
+
+				__m128 sum = _mm_add_ps(left, right);
+				sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(stencil.below), _mm_loadu_ps(stencil.above)));
+				sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(stencil.back), _mm_loadu_ps(stencil.front)));
+
+				float* cells = block.potential[color][z][y];
+				__m128 old = _mm_loadu_ps(cells);
+				__m128 delta = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sum, sixth), old), omega4);
+				// fixed cells don't change
+				delta = _mm_mul_ps(delta, _mm_loadu_ps(block.freeCells[color][z][y]));
+				_mm_storeu_ps(cells, _mm_add_ps(old, delta));
+
+				maxChange = _mm_max_ps(maxChange, _mm_and_ps(delta, absMask));
+			}
+		}
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, maxChange);
+	return glm::max(glm::max(lanes[0], lanes[1]), glm::max(lanes[2], lanes[3]));
+}
+
+StencilRows SparseGrid::GetStencil(int b, int color, int y, int z) const {
+	const GridBlock& block = blocks[b];
+	// all the neighbours are the other color
+	int other = 1 - color;
+	int globalY = 1 + block.coord.y * GRID_BLOCK_SIZE + y;
+	const int last = GRID_BLOCK_SIZE - 1;
+
+	StencilRows stencil;
+	stencil.row = block.potential[other][z][y];
+	stencil.below = y > 0 ? block.potential[other][z][y - 1] : BlockRow(block.neighbours[2], other, last, z, globalY - 1);
+	stencil.above = y < last ? block.potential[other][z][y + 1] : BlockRow(block.neighbours[3], other, 0, z, globalY + 1);
+	stencil.back = z > 0 ? block.potential[other][z - 1][y] : BlockRow(block.neighbours[4], other, y, last, globalY);
+	stencil.front = z < last ? block.potential[other][z + 1][y] : BlockRow(block.neighbours[5], other, y, 0, globalY);
+	stencil.left = BlockRow(block.neighbours[0], other, y, z, globalY)[GRID_BLOCK_SIZE / 2 - 1];
+	stencil.right = BlockRow(block.neighbours[1], other, y, z, globalY)[0];
+	return stencil;
+}
+
+float SparseGrid::Potential(ivec3 cell) const {
+	ivec3 coord = (cell - 1) / GRID_BLOCK_SIZE;
+	int b = FindBlock(coord);
+	if (b < 0) {
+		return Background(cell.y);
+	}
+	ivec3 local = cell - 1 - coord * GRID_BLOCK_SIZE;
+	int color = (local.x + local.y + local.z) & 1;
+	return blocks[b].potential[color][local.z][local.y][local.x / 2];
+}
+
+bool SparseGrid::IsFixed(ivec3 cell) const {
+	ivec3 coord = (cell - 1) / GRID_BLOCK_SIZE;
+	int b = FindBlock(coord);
+	if (b < 0) {
+		return false;
+	}
+	ivec3 local = cell - 1 - coord * GRID_BLOCK_SIZE;
+	int color = (local.x + local.y + local.z) & 1;
+	return blocks[b].freeCells[color][local.z][local.y][local.x / 2] == 0.0f;
+}
+
+int SparseGrid::Size() const {
+	return size;
+}
+
+void SparseGrid::SetBandRadius(int radius) {
+	bandRadius = glm::max(radius, 0);
+}
+
+int SparseGrid::NumActiveBlocks() const {
+	return blocks.size();
+}
+
+size_t SparseGrid::MemoryBytes() const {
+	return blocks.size() * sizeof(GridBlock);
+}
+
+// PRIVATE
+// linear background field, 1 at the ground to 0 at the top
+float SparseGrid::Background(int y) const {
+	return 1.0f - float(y) / float(size + 1);
+}
+
+long long SparseGrid::BlockKey(ivec3 coord) const {
+	return (long long)coord.x + (long long)coord.y * blocksPerSide + (long long)coord.z * blocksPerSide * blocksPerSide;
+}
+
+// index of the block, -1 if it isn't active or is outside the grid
+int SparseGrid::FindBlock(ivec3 coord) const {
+	if (glm::any(glm::lessThan(coord, ivec3(0))) || glm::any(glm::greaterThanEqual(coord, ivec3(blocksPerSide)))) {
+		return -1;
+	}
+	auto found = blockLookup.find(BlockKey(coord));
+	return found == blockLookup.end() ? -1 : found->second;
+}
+
+// Activates the block if it's inside the grid and not active yet, 
+// returns its index or -1 if it's outside.
+int SparseGrid::ActivateBlock(ivec3 coord) {
+	if (glm::any(glm::lessThan(coord, ivec3(0))) || glm::any(glm::greaterThanEqual(coord, ivec3(blocksPerSide)))) {
+		return -1;
+	}
+	int existing = FindBlock(coord);
+	if (existing >= 0) {
+		return existing;
+	}
+
+	int index = blocks.size();
+	blocks.emplace_back();
+	GridBlock& block = blocks.back();
+	block.coord = coord;
+	// starts as the background field
+	for (int color = 0; color < 2; color++) {
+		for (int z = 0; z < GRID_BLOCK_SIZE; z++) {
+			for (int y = 0; y < GRID_BLOCK_SIZE; y++) {
+				float background = Background(1 + coord.y * GRID_BLOCK_SIZE + y);
+				for (int k = 0; k < GRID_BLOCK_SIZE / 2; k++) {
+					block.potential[color][z][y][k] = background;
+					block.freeCells[color][z][y][k] = 1.0f;
+				}
+			}
+		}
+	}
+
+	// link to the active neighbours, both ways
+	const ivec3 directions[6] = { ivec3(-1, 0, 0), ivec3(1, 0, 0), ivec3(0, -1, 0),
+		ivec3(0, 1, 0), ivec3(0, 0, -1), ivec3(0, 0, 1) };
+	for (int d = 0; d < 6; d++) {
+		int neighbour = FindBlock(coord + directions[d]);
+		block.neighbours[d] = neighbour;
+		if (neighbour >= 0) {
+			// the opposite direction is d ^ 1
+			blocks[neighbour].neighbours[d ^ 1] = index;
+		}
+	}
+	blockLookup[BlockKey(coord)] = index;
+	return index;
+}
+
+// the given color's row (y, z) of a block, or the background row at 
+// globalY if the block isn't active
+const float* SparseGrid::BlockRow(int block, int color, int y, int z, int globalY) const {
+	if (block < 0) {
+		return &backgroundRows[globalY * 4];
+	}
+	return blocks[block].potential[color][z][y];
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+
+#include "LaplaceSolver.h"
+
+using glm::ivec3;
+using std::vector;
+
+// Sparse, block structured potential grid (VDB style leaves). Only 8x8x8 
+// blocks in a narrow band around the fixed cells (the bolt's channel) and the 
+// ground below them are stored and solved; every other cell reads the 
+// background field. Memory and solve time scale with the channel, not with 
+// the volume, so the grid can cover a storm sized volume.
+// Has the same interface as LaplaceSolver and solves with the same red-black
+// SOR: each block row of 8 cells holds 4 cells per color, one SSE vector.
+
+const int GRID_BLOCK_SIZE = 8;
+
+struct GridBlock {
+	ivec3 coord;			// covers the cells 1 + 8 * coord to 8 + 8 * coord
+	int neighbours[6];		// -x, +x, -y, +y, -z, +z block indices, -1 if not active
+	// [color][z][y][x / 2], a local cell (x, y, z) is in color (x + y + z) % 2
+	float potential[2][GRID_BLOCK_SIZE][GRID_BLOCK_SIZE][GRID_BLOCK_SIZE / 2];
+	float freeCells[2][GRID_BLOCK_SIZE][GRID_BLOCK_SIZE][GRID_BLOCK_SIZE / 2];
+};
+
+// The 6 neighbour rows of a block row, for stencil updates. Rows of inactive 
+// blocks point at the background field.
+struct StencilRows {
+	const float* below;
+	const float* above;
+	const float* back;
+	const float* front;
+	const float* row;		// the other color's cells in the same row
+	float left;				// the x neighbour before the row's first cell
+	float right;			// the x neighbour after the row's last cell
+};
+
+class SparseGrid {
+public:
+	// size is rounded up to a multiple of 8. The background field goes from 1 
+	// at the bottom (ground) to 0 at the top.
+	void Init(int size, int numThreads);
+	// Fixes the potential of a cell, 1 <= x, y, z <= size, and activates the 
+	// blocks within bandRadius blocks of it plus the ground blocks below them.
+	void SetFixed(ivec3 cell, float value);
+	// Runs up to maxIterations red-black iterations over the active blocks, stopping
+	// early once no cell changes by more than tolerance. Returns the iterations run.
+	int Solve(int maxIterations, float tolerance);
+
+	float Potential(ivec3 cell) const;
+	bool IsFixed(ivec3 cell) const;
+	int Size() const;
+
+	// the neighbour rows of row (y, z) in the given color's half of a block
+	StencilRows GetStencil(int block, int color, int y, int z) const;
+
+	void SetBandRadius(int radius);
+	int NumActiveBlocks() const;
+	size_t MemoryBytes() const;
+
+private:
+	int size = 0;
+	int blocksPerSide = 0;
+	int bandRadius = 1;
+	int numThreads = 1;
+	float omega = 1.0f;
+	vector<GridBlock> blocks;
+	std::unordered_map<long long, int> blockLookup;
+	vector<float> backgroundRows;	// 4 copies of the background potential for each y
+	WorkerPool workers;				// kept between solves
+
+	float Background(int y) const;
+	long long BlockKey(ivec3 coord) const;
+	int FindBlock(ivec3 coord) const;
+	int ActivateBlock(ivec3 coord);
+	const float* BlockRow(int block, int color, int y, int z, int globalY) const;
+	float SweepBlocks(int color, int begin, int end);
+};
@@ -0,0 +1,59 @@
+#include "SpatialHash.h"
+
+#include <algorithm>
+
+void SpatialHash::Init(float _cellSize) {
+	cellSize = _cellSize;
+	count = 0;
+	cells.clear();
+}
+
+void SpatialHash::Insert(int id, vec3 p) {
+	cells[Key(Cell(p))].push_back(id);
+	count++;
+}
+
+void SpatialHash::Remove(int id, vec3 p) {
+	auto cell = cells.find(Key(Cell(p)));
+	if (cell == cells.end()) {
+		return;
+	}
+	vector<int>& ids = cell->second;
+	auto it = std::find(ids.begin(), ids.end(), id);
+	if (it != ids.end()) {
+		*it = ids.back();
+		ids.pop_back();
+		count--;
+	}
+}
+
+void SpatialHash::Query(vec3 center, float radius, vector<int>* ids) const {
+	ivec3 first = Cell(center - radius);
+	ivec3 last = Cell(center + radius);
+	for (int z = first.z; z <= last.z; z++) {
+		for (int y = first.y; y <= last.y; y++) {
+			for (int x = first.x; x <= last.x; x++) {
+				auto cell = cells.find(Key(ivec3(x, y, z)));
+				if (cell != cells.end()) {
+					ids->insert(ids->end(), cell->second.begin(), cell->second.end());
+				}
+			}
+		}
+	}
+}
+
+int SpatialHash::Size() const {
+	return count;
+}
+
+// PRIVATE
+ivec3 SpatialHash::Cell(vec3 p) const {
+	return ivec3(glm::floor(p / cellSize));
+}
+
+long long SpatialHash::Key(ivec3 cell) const {
+	// 21 bits per axis, offset so negative cells stay positive
+	const long long offset = 1 << 20;
+	return ((cell.x + offset) & 0x1FFFFF) | (((cell.y + offset) & 0x1FFFFF) << 21) |
+		(((cell.z + offset) & 0x1FFFFF) << 42);
+}
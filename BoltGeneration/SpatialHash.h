@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+
+using glm::vec3;
+using glm::ivec3;
+using std::vector;
+
+// Uniform hash grid of points, for radius queries while the point set changes.
+// Points can be inserted and removed at any time, a query only visits the
+// cells overlapping its sphere, so the cell size should be about the usual
+// query radius.
+
+class SpatialHash {
+public:
+	void Init(float cellSize);
+	void Insert(int id, vec3 p);
+	void Remove(int id, vec3 p);
+	// Appends the ids in the cells overlapping the sphere, the caller tests the exact distance
+	void Query(vec3 center, float radius, vector<int>* ids) const;
+	int Size() const;
+
+private:
+	float cellSize = 1.0f;
+	int count = 0;
+	std::unordered_map<long long, vector<int>> cells;
+
+	ivec3 Cell(vec3 p) const;
+	long long Key(ivec3 cell) const;
+};
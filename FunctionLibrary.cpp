@@ -12,6 +12,7 @@ std::string projectBase = "";
 std::string vertexDir = ProjectBasePath() + "\\Shader\\VertexShaders";
 std::string fragmentDir = ProjectBasePath() + "\\Shader\\FragmentShaders";
 std::string geometryDir = ProjectBasePath() + "\\Shader\\GeometryShaders";
+std::string computeDir = ProjectBasePath() + "\\Shader\\ComputeShaders";
 
 Shader LoadShader(const char* vertex, const char* fragment, const char* geometry) {
 	std::string vertexPath = vertexDir + "\\" + vertex;
@@ -25,6 +26,11 @@ Shader LoadShader(const char* vertex, const char* fragment, const char* geometry
 	}
 }
 
+Shader LoadComputeShader(const char* compute) {
+	std::string computePath = computeDir + "\\" + compute;
+	return Shader(computePath.c_str());
+}
+
 // Returns the path to the project base folder
 std::string ProjectBasePath() {
 	if (projectBase == "") {
@@ -124,4 +130,4 @@ void OutputMat4(mat4 mat) {
 		}
 		std::cout << std::endl;
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -20,6 +20,7 @@ using glm::mat4;
 // Shaders
 Shader LoadShader(const char* vertex, const char* fragment,
 	const char* geometry = nullptr);
+Shader LoadComputeShader(const char* compute);
 
 // Paths
 std::string ProjectBasePath();
@@ -35,4 +36,4 @@ void SetWidthAndHeight(unsigned int width, unsigned int height);
 
 // General Outputs
 void OutputVec3(vec3 vec);
-void OutputMat4(mat4 mat);
\ No newline at end of file
+void OutputMat4(mat4 mat);
\ No newline at end of file
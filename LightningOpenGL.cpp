@@ -33,6 +33,9 @@ ImGui is used for the GUI which allows editting of various variables used to gen
 #include "BoltGeneration/LineBoltSegment.h"
 #include "BoltGeneration/LightningPatterns.h"
 #include "BoltGeneration/BoltSetup.h"
+#include "BoltGeneration/BoltMesh.h"
+#include "BoltGeneration/BoltFlicker.h"
+#include "BoltGeneration/BoltGrowth.h"
 #include "Shader/Shader.h"
 #include "Shader/ShaderSetup.h"
 #include "Managers/LightManager.h"
@@ -53,6 +56,10 @@ using glm::lookAt;
 // lightning options
 float boltAlpha = 1.0f;
 vec3 boltColor = vec3(1.0f, 1.0f, 1.0f);	// Yellow
+// dynamic bolts can be drawn as ribbons instead of 1 pixel lines
+bool boltRibbons = true;
+float boltWidth = 0.12f;					// world space width of the main channel
+float boltTaper = 0.6f;						// fraction of the width kept at each branching
 vec3 cubeLightColor = vec3(1);				// White
 
 // toggles
@@ -62,7 +69,7 @@ bool shadowsEnabled = true;
 bool DYNAMIC_BOLT = true;
 
 // Method Choice
-int methodChoice = 2; // 0 = random, 1 = particle system, 2 = l-system
+int methodChoice = 2; // 0 = random, 1 = particle system, 2 = l-system, 3 = dbm, 4 = space colonization
 
 // function prototypes
 // MVP Setters
@@ -70,7 +77,6 @@ void SetMVPMatricies(Shader shader, mat4 model, mat4 view, mat4 porjection);
 void SetVPMatricies(Shader shader, mat4 view, mat4 projection);
 // Drawing
 void DrawLineBolt(LineBoltSegment* lboltPtr);
-void DrawLineBolt(vector<LineBoltSegment>* lboltPtr);
 void DrawLightBoxes(Shader shader, vector<vec3>* lightPositions);
 void DrawLightBoxes(Shader shader, vec3* lightPositions);
 // Input
@@ -83,7 +89,7 @@ void InitImGui(GLFWwindow* window);
 // GUI
 void RenderImGui(LightManager* lm, PerformanceManager* pm, FboManager* fm, bool* newBolt);
 void BoltControlGUI(PerformanceManager* pm, bool* newBolt);
-void SceneGUI();
+void SceneGUI(LightManager* lm);
 
 
 
@@ -109,6 +115,8 @@ int main() {
 	// Load
 	// -------------------------
 	LoadModels();
+	// bolts attract to and stop at the static scene
+	SetScene(&GetSceneSDF(), &GetSceneBVH());
 	// -------------------------
 
 	// Input
@@ -142,13 +150,14 @@ int main() {
 	// DYNAMIC
 	// Uses a vector of dyanmic size. Required for branching.
 
-	// Segments
-	vector<LineBoltSegment> dynamicSegments;
-	vector<LineBoltSegment>* dynamicSegmentsPtr = &dynamicSegments;
+	// Segments, all in one buffer
+	BoltMesh boltMesh;
 	// Point Lights
 	vector<vec3> dynamicPointLights;
 	vector<vec3>* dynamicPointLightsPtr;
 	dynamicPointLightsPtr = &dynamicPointLights;
+	// Line Lights, used instead when enabled in the Lighting window
+	vector<pair<vec3, vec3>> lineLights;
 	// Bolt Pattern
 	vector<pair<vec3, vec3>> dynamicBolt;
 	vector<pair<vec3, vec3>>* dynamicBoltPtr = &dynamicBolt;
@@ -160,22 +169,45 @@ int main() {
 	// Post Processing
 	Shader blurShader = LoadShader("blur.vert", "blur.frag");
 	Shader screenShader = LoadShader("screen.vert", "screen.frag");
+	Shader glowBinShader = LoadComputeShader("glow_bin.comp");
+	Shader glowScanShader = LoadComputeShader("glow_scan.comp");
+	Shader glowShader = LoadComputeShader("glow.comp");
 	// Deferred Shadring
 	Shader geometryPassShader = LoadShader("g_buffer.vert", "g_buffer.frag");
 	Shader lightingPassShader = LoadShader("lighting_pass.vert", "lighting_pass.frag");
+	Shader upsampleShader = LoadShader("lighting_pass.vert", "upsample.frag");
+	Shader tiledLightingShader = LoadComputeShader("tiled_lighting.comp");
 	// Shadow Mapping
 	Shader depthShader = LoadShader("depth.vert", "depth.frag", "depth_multiple_cubemap.geom");
+	Shader paraboloidDepthShader = LoadShader("depth.vert", "depth.frag", "depth_dual_paraboloid.geom");
 	// Light Cube (forward shading)
 	Shader lightCubeShader = LoadShader("light.vert", "light.frag");
 	// Bolt (forward shading)
 	Shader boltShader = LoadShader("bolt.vert", "bolt.frag");
+	Shader boltRibbonShader = LoadShader("bolt_ribbon.vert", "bolt.frag");
 
 	// Shader Setup
+	// the fragment and compute lighting passes read the same textures
+	for (Shader* shader : { &lightingPassShader, &tiledLightingShader }) {
+		shader->Use();
+		shader->SetInt("gPosition", 0);
+		shader->SetInt("gNormal", 1);
+		shader->SetInt("gAlbedoSpec", 2);
+		for (int tier = 0; tier < NUM_SHADOW_TIERS; tier++) {
+			shader->SetInt("depthMapTiers[" + std::to_string(tier) + "]", 3 + tier);
+			shader->SetInt("paraboloidTiers[" + std::to_string(tier) + "]", 3 + NUM_SHADOW_TIERS + tier);
+		}
+	}
 	lightingPassShader.Use();
-	lightingPassShader.SetInt("gPosition", 0);
-	lightingPassShader.SetInt("gNormal", 1);
-	lightingPassShader.SetInt("gAlbedoSpec", 2);
-	lightingPassShader.SetInt("depthMapArray", 3);
+	lightingPassShader.SetInt("lightHistory", LIGHT_HISTORY_UNIT);
+
+	upsampleShader.Use();
+	upsampleShader.SetInt("gPosition", 0);
+	upsampleShader.SetInt("gNormal", 1);
+	upsampleShader.SetInt("lowResLighting", LOW_RES_LIGHTING_UNIT);
+
+	glowBinShader.Use();
+	glowBinShader.SetInt("gPosition", 0);
 
 	blurShader.Use();
 	blurShader.SetInt("image", 3);
@@ -188,14 +220,12 @@ int main() {
 	screenShader.SetInt("bloomTexture", 1);
 
 	geometryPassShader.Use();
-	geometryPassShader.SetInt("texture1_diffuse", 0);
-	geometryPassShader.SetInt("texture2_diffuse", 1);
-	geometryPassShader.SetVec3("color", vec3(0.5f));
+	geometryPassShader.SetInt("materialTextures", MATERIAL_TEXTURE_UNIT);
 	// -------------------------
 
 	// Light Manager Setup -----
 	LightManager lightManager;
-	lightManager.Init(&depthShader);
+	lightManager.Init(&depthShader, &paraboloidDepthShader);
 	// -------------------------
 
 	// Performance Manager Setup
@@ -232,6 +262,9 @@ int main() {
 
 	// FBO ------------
 	FboManager fboManager(SCR_WIDTH, SCR_HEIGHT);
+	// last frame's camera, for reprojecting the lighting history
+	mat4 prevViewProjection = mat4(1.0f);
+	vec3 prevViewPos = vec3(0.0f);
 	// ----------------
 
 	// Speed Testing --
@@ -302,17 +335,28 @@ int main() {
 
 			// Dynamic Bolt
 			if (DYNAMIC_BOLT) {
-				NewBolt(dynamicSegmentsPtr, dynamicPointLightsPtr,
-					dynamicBoltPtr);
+				// LOD is measured from where the camera is now
+				SetBoltLODView(GetCameraPos(), 0.5f * SCR_HEIGHT / glm::tan(glm::radians(GetFOV()) * 0.5f));
+				NewBolt(dynamicBoltPtr);
 
 				performanceManager.Update(NEW_BOLT, t1, std::chrono::high_resolution_clock::now());
 
 				// Set the LineSegment's Positions based on generated pattern
-				DefineBoltLines(dynamicSegmentsPtr, dynamicBoltPtr);
+				DefineBoltLines(&boltMesh, dynamicBoltPtr);
 				// Set the PointLight's Positions based on generated pattern
 				PositionBoltPointLights(dynamicPointLightsPtr, dynamicBoltPtr);
 				// Set the LightManager's Light Positions
-				lightManager.SetLightPositions(dynamicPointLightsPtr);
+				if (lightManager.GetLineLightsEnabled()) {
+					PositionBoltLineLights(&lineLights, dynamicBoltPtr, lightManager.GetMaxLineLights());
+					lightManager.SetLineLights(lineLights);
+				}
+				else {
+					lightManager.SetLightPositions(dynamicPointLightsPtr);
+					// a growing bolt's lights are activated as it reaches them
+					if (BoltGrowing()) {
+						lightManager.ActivateLights(0);
+					}
+				}
 			}
 			// Static Bolt
 			else {
@@ -331,6 +375,44 @@ int main() {
 			count++;
 			*/
 		}
+		// Stepped Leader: append the segments grown this frame and activate the lights 
+		// on them, only their shadow maps are rendered this frame
+		else if (DYNAMIC_BOLT && BoltGrowing()) {
+			int segmentsGrown = GrowBolt(GetDeltaTime());
+			if (segmentsGrown > boltMesh.NumSegments()) {
+				boltMesh.Append(*dynamicBoltPtr, segmentsGrown - boltMesh.NumSegments());
+				// line lights span many segments, they're all lit from the start
+				if (!lightManager.UsingLineLights()) {
+					lightManager.ActivateLights(CountBoltPointLights(segmentsGrown));
+				}
+			}
+			// return stroke: fully grown, reorder it so it can flicker
+			if (!BoltGrowing()) {
+				FinishBoltGrowth(&boltMesh, dynamicBoltPtr);
+				if (!lightManager.UsingLineLights()) {
+					lightManager.ActivateLights(GetNumActiveLights());
+				}
+			}
+		}
+		// Flicker: re-displace a few of the dynamic bolt's branches, only
+		// re-uploading their segments and moving the lights on them
+		else if (DYNAMIC_BOLT && GetFlickerEnabled() && FlickerDue(GetDeltaTime())) {
+			vector<pair<int, int>> changedRanges;
+			vector<int> movedLights;
+			FlickerBolt(dynamicBoltPtr, &changedRanges);
+			for (const pair<int, int>& range : changedRanges) {
+				boltMesh.UpdateRange(*dynamicBoltPtr, range.first, range.second - range.first);
+				RepositionBoltPointLights(dynamicPointLightsPtr, dynamicBoltPtr,
+					range.first, range.second, &movedLights);
+			}
+			if (lightManager.UsingLineLights()) {
+				PositionBoltLineLights(&lineLights, dynamicBoltPtr, lightManager.GetMaxLineLights());
+				lightManager.UpdateLineLights(lineLights);
+			}
+			else {
+				lightManager.UpdateLightPositions(dynamicPointLightsPtr, movedLights);
+			}
+		}
 		// -----------------------
 
 		// Rendering
@@ -348,7 +430,7 @@ int main() {
 		auto t1 = std::chrono::high_resolution_clock::now();
 
 		gBuffer.Bind();
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		gBuffer.Clear();
 
 		geometryPassShader.Use();
 		SetVPMatricies(geometryPassShader, view, projection);
@@ -361,11 +443,14 @@ int main() {
 
 		// 1.5. Shadow Maps: render depth maps for each light source
 		// -----------------
+		t1 = std::chrono::high_resolution_clock::now();
 		if (newBolt) {
-			t1 = std::chrono::high_resolution_clock::now();
-			lightManager.RenderDepthMaps();
-			performanceManager.Update(SHADOW_MAPS, t1, std::chrono::high_resolution_clock::now());
+			lightManager.ClearDepthMaps();
 		}
+		// lights that are new, moved by a flicker or reached by a growing bolt,
+		// spread over frames by the light manager's budget
+		lightManager.RenderDirtyDepthMaps(projection * view, GetCameraPos());
+		performanceManager.Update(SHADOW_MAPS, t1, std::chrono::high_resolution_clock::now());
 
 		// 2. Lighting Pass: calculate lighting by iterating over a screen filled quad 
 		//					 pixel-by-pixel using the g-buffer's content.
@@ -374,19 +459,45 @@ int main() {
 		t1 = std::chrono::high_resolution_clock::now();
 
 		glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-		fboManager.Bind();
+		// the tiled compute pass only shades point lights, the fragment pass does the rest
+		bool tiledLighting = fboManager.GetTiledLightingEnabled() &&
+			!lightManager.UsingLineLights() && !lightManager.UsingStochasticLights();
+		Shader* lightingShader = tiledLighting ? &tiledLightingShader : &lightingPassShader;
+		if (tiledLighting) {
+			fboManager.BeginTiledLightingPass();
+		}
+		else {
+			fboManager.BeginLightingPass(lightManager.UsingTemporalAccumulation());
+		}
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		lightingPassShader.Use();
+		lightingShader->Use();
 
 		gBuffer.BindTextures();
-		lightManager.BindCubeMapArray();
+		lightManager.BindShadowMaps();
 
-		lightManager.SetLightingPassUniforms(&lightingPassShader);
-		lightingPassShader.SetVec3("viewPos", GetCameraPos());
-		lightingPassShader.SetBool("shadows", shadowsEnabled);
-		lightingPassShader.SetBool("blurEnabled", fboManager.GetGlowEnabled());
+		lightManager.SetLightingPassUniforms(lightingShader);
+		lightingShader->SetVec3("viewPos", GetCameraPos());
+		lightingShader->SetBool("shadows", shadowsEnabled);
+		lightingShader->SetBool("bloomEnabled", fboManager.GetGlowEnabled());
 
-		RenderQuad();
+		if (tiledLighting) {
+			tiledLightingShader.SetFloat("lightRadius", lightManager.GetLightRadius());
+			fboManager.DispatchTiledLighting(&tiledLightingShader);
+		}
+		else {
+			// stochastic lighting reprojects the last frame's, not valid for a new bolt
+			lightingPassShader.SetMat4("prevViewProjection", prevViewProjection);
+			lightingPassShader.SetVec3("prevViewPos", prevViewPos);
+			lightingPassShader.SetBool("historyValid", !newBolt && fboManager.GetLightHistoryValid());
+
+			RenderQuad();
+			// upsampled to full resolution if it was evaluated at a lower one
+			upsampleShader.Use();
+			upsampleShader.SetVec3("viewPos", GetCameraPos());
+			fboManager.EndLightingPass(&upsampleShader);
+		}
+		prevViewProjection = projection * view;
+		prevViewPos = GetCameraPos();
 
 		performanceManager.Update(LIGHTING_PASS, t1, std::chrono::high_resolution_clock::now());
 
@@ -407,12 +518,34 @@ int main() {
 
 		boltShader.Use();
 		boltShader.SetVec3("color", boltColor);
-		boltShader.SetFloat("alpha", boltAlpha);
+		boltShader.SetFloat("alpha", DYNAMIC_BOLT ? boltAlpha * GetGrowthBrightness() : boltAlpha);
 		SetVPMatricies(boltShader, view, projection);
 
 		if (DYNAMIC_BOLT) {
 			// Dynamic Bolt
-			DrawLineBolt(dynamicSegmentsPtr);
+			if (boltRibbons) {
+				// The anti-aliased edges are blended, and overlapping ends mustn't hide each other.
+				// Max blending keeps the brightest of the overlapping ribbons, so the round
+				// ends at the joints aren't added twice and don't show as beads.
+				boltRibbonShader.Use();
+				boltRibbonShader.SetVec3("color", boltColor);
+				boltRibbonShader.SetFloat("alpha", boltAlpha * GetGrowthBrightness());
+				boltRibbonShader.SetBool("premultiplied", true);
+				boltRibbonShader.SetVec2("screenSize", glm::vec2(SCR_WIDTH, SCR_HEIGHT));
+				boltRibbonShader.SetFloat("width", boltWidth);
+				boltRibbonShader.SetFloat("taper", boltTaper);
+				SetVPMatricies(boltRibbonShader, view, projection);
+				glEnable(GL_BLEND);
+				glBlendEquation(GL_MAX);
+				glDepthMask(GL_FALSE);
+				boltMesh.DrawRibbons();
+				glDepthMask(GL_TRUE);
+				glBlendEquation(GL_FUNC_ADD);
+				glDisable(GL_BLEND);
+			}
+			else {
+				boltMesh.Draw();
+			}
 
 			if (lightManager.GetLightBoxesEnabled()) {
 				// Draw Point Light boxes
@@ -438,7 +571,15 @@ int main() {
 		// 4. Glow
 		// -----------------
 		t1 = std::chrono::high_resolution_clock::now();
-		fboManager.ApplyGlow(blurShader);
+		// the analytic glow needs the bolt's segments, the static bolt is always blurred
+		if (DYNAMIC_BOLT && fboManager.GetAnalyticGlowEnabled()) {
+			gBuffer.BindTextures();
+			fboManager.ApplyAnalyticGlow(&glowBinShader, &glowScanShader, &glowShader, &boltMesh, projection * view,
+				GetCameraPos(), boltColor, boltAlpha * GetGrowthBrightness());
+		}
+		else {
+			fboManager.ApplyGlow(blurShader);
+		}
 		performanceManager.Update(GLOW, t1, std::chrono::high_resolution_clock::now());
 
 		// 5. Blend Scene and Blurred Bolt to default framebuffer
@@ -485,12 +626,6 @@ void DrawLineBolt(LineBoltSegment* lboltPtr) {
 		lboltPtr[i].Draw();
 	}
 }
-// DYNAMIC
-void DrawLineBolt(vector<LineBoltSegment>* lboltPtr) {
-	for (int i = 0; i < lboltPtr->size(); i++) {
-		lboltPtr->at(i).Draw();
-	}
-}
 
 // Light Boxes
 // VECTOR
@@ -581,8 +716,9 @@ void ProcessLightningControlInput(GLFWwindow* window, bool* newBolt) {
 // initialize and configure glfw
 void ConfigureWindow() {
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	// 4.6: the scene's draw data is stored in an SSBO and indexed with gl_BaseInstance
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // REMOVE IF ISSUE WITH MACS
 
@@ -650,7 +786,7 @@ void RenderImGui(LightManager *lm, PerformanceManager *pm, FboManager *fm, bool*
 		RenderGUI();
 
 	if (toggleSceneWindow)
-		SceneGUI();
+		SceneGUI(lm);
 
 	// Performance
 	pm->PerformanceGUI();
@@ -660,7 +796,7 @@ void RenderImGui(LightManager *lm, PerformanceManager *pm, FboManager *fm, bool*
 }
 
 void BoltControlGUI(PerformanceManager* pm, bool* newBolt) {
-	static const char* methodNames[3] = { "Random Positions", "Particle System", "L-System" };
+	static const char* methodNames[5] = { "Random Positions", "Particle System", "L-System", "DBM", "Space Colonization" };
 
 	const ImVec2 startPos = ImVec2(5, 183);
 	ImGui::SetNextWindowPos(startPos, ImGuiCond_Once);
@@ -668,7 +804,7 @@ void BoltControlGUI(PerformanceManager* pm, bool* newBolt) {
 	ImGui::Begin("Bolt Method", NULL, ImGuiWindowFlags_AlwaysAutoResize);
 
 	ImGui::Text("Methods:");
-	if (ImGui::Combo("##", &methodChoice, methodNames, 3)) {
+	if (ImGui::Combo("##", &methodChoice, methodNames, 5)) {
 		SetMethod(methodChoice);
 	}
 
@@ -680,6 +816,16 @@ void BoltControlGUI(PerformanceManager* pm, bool* newBolt) {
 	ImGui::Text("Pattern Info:");
 	if (DYNAMIC_BOLT) {
 		pm->DynamicPatternGUI();
+		ImGui::Checkbox("Ribbons", &boltRibbons);
+		if (boltRibbons) {
+			ImGui::Text("Width");
+			ImGui::SliderFloat("##boltWidth", &boltWidth, 0.01f, 1.0f);
+			ImGui::Text("Taper");
+			ImGui::SliderFloat("##boltTaper", &boltTaper, 0.1f, 1.0f);
+		}
+		BoltLODGUI();
+		GrowthGUI();
+		FlickerGUI();
 	}
 	else {
 		pm->StaticPatternGUI();
@@ -688,17 +834,19 @@ void BoltControlGUI(PerformanceManager* pm, bool* newBolt) {
 	ImGui::End();
 }
 
-void SceneGUI() {
+void SceneGUI(LightManager* lm) {
 	ImGui::Begin("Scenes");
 
 	if (ImGui::BeginListBox("Scenes")) {
 		if (ImGui::Selectable("Empty")) {
 			SetScene(0);
+			lm->MarkShadowsDirty();
 			SetStartPos(vec3(20, 60, 0));
 			SetEndPos(vec3(10, 0, 0));
 		}
 		if (ImGui::Selectable("Default")) {
 			SetScene(1);
+			lm->MarkShadowsDirty();
 			SetStartPos(vec3(20, 60, 0));
 			SetEndPos(vec3(10, 0, 0));
 		}
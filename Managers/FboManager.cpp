@@ -1,159 +1,464 @@
-#include "FboManager.h"
-
-// constructor
-FboManager::FboManager(unsigned int SCR_WIDTH, unsigned int SCR_HEIGHT) {
-	// FBO
-	// stores the scene in tcbo[0] and the bloom in tcbo[1], they are blended together in 4.5.
-	glGenFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-	// TCBO[2]
-	// genereate and attach to framebuffer object (fbo)
-	glGenTextures(2, tcbo);
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindTexture(GL_TEXTURE_2D, tcbo[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, tcbo[i], 0);
-	}
-
-	// RBO
-	// depth and stencil buffer object
-	glGenRenderbuffers(1, &rbo);
-	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-	// allocate storage and unbind
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
-	// attach to the framebuffer object (fbo)
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-	// tell opengl which color attachments to use for rendering (of this framebuffer, fbo)
-	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-	glDrawBuffers(2, attachments);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// PINGPONG FBOs & BUFFERS
-	glGenFramebuffers(2, pingpongFBO);
-	glGenTextures(2, pingpongBuffer);
-
-	for (unsigned int i = 0; i < 2; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-		glBindTexture(GL_TEXTURE_2D, pingpongBuffer[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongBuffer[i], 0);
-	}
-}
-
-// PUBLIC
-void FboManager::ApplyGlow(Shader shader) {
-	shader.Use();
-	shader.SetInt("weightType", weightType);
-	horizontal = true;
-	bool firstIteration = true;
-
-	for (int i = 0; i < glow; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-		shader.SetInt("horizontal", horizontal);
-		// bind texutre of other framebuffer, or the texture to blur if first iteration
-		glBindTexture(GL_TEXTURE_2D, firstIteration ?
-			tcbo[1] : pingpongBuffer[!horizontal]);
-		// render quad
-		RenderQuad();
-		// swap buffers
-		horizontal = !horizontal;
-		if (firstIteration)
-			firstIteration = false;
-	}
-}
-
-void FboManager::PostProcessingGUI() {
-	static const char* weightNames[2] = { "Gaussian", "Custom" };
-
-	const ImVec2 startPos = ImVec2(575, 119);
-	ImGui::SetNextWindowPos(startPos, ImGuiCond_Once);
-	ImGui::Begin("Post Processing", NULL, ImGuiWindowFlags_AlwaysAutoResize);
-
-	ImGui::Separator();
-	ImGui::Text("Glow");
-	ImGui::Checkbox("##glowEnabled", &glowEnabled);
-	if (glowEnabled) {
-		ImGui::SliderInt("##glow", &glow, 1, 20);
-		ImGui::Text("Weight Type");
-		ImGui::Combo("", &weightType, weightNames, 2);
-	}
-
-	ImGui::Separator();
-	ImGui::Text("Gamma Correction");
-	ImGui::Checkbox("##gammaEnabled", &gammaCorrectionEnabled);
-	if (gammaCorrectionEnabled) {
-		ImGui::SliderFloat("##gamma", &gamma, 0.1f, 5.0f, "%.1f");
-	}
-
-	ImGui::Separator();
-	ImGui::Text("Exposure");
-	ImGui::Checkbox("###exposureEnabled", &exposureEnabled);
-	if (exposureEnabled) {
-		ImGui::SliderFloat("##exposure", &exposure, 0.1f, 30, "%.1f");
-	}
-
-	ImGui::End();
-}
-
-bool FboManager::GetGlowEnabled() {
-	return glowEnabled;
-}
-
-unsigned int FboManager::GetFbo() {
-	return fbo;
-}
-
-void FboManager::Bind() {
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-}
-
-void FboManager::BindDraw() {
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
-}
-
-void FboManager::PrepareScreenShader(Shader* shader) {
-	BindSceneAndGlow();
-	SetScreenShaderUniforms(shader);
-}
-
-void FboManager::OutputBuffers() {
-	std::cout << "fbo: " << fbo << std::endl;
-	std::cout << "tcbo[0]: " << tcbo[0] << std::endl;
-	std::cout << "tcbo[1]: " << tcbo[1] << std::endl;
-	std::cout << "rbo: " << rbo << std::endl;
-	std::cout << "pingpongFBO[0]: " << pingpongFBO[0] << std::endl;
-	std::cout << "pingpongFBO[1]: " << pingpongFBO[1] << std::endl;
-	std::cout << "pingpongBuffer[0]: " << pingpongBuffer[0] << std::endl;
-	std::cout << "pingpongBuffer[1]: " << pingpongBuffer[1] << std::endl;
-}
-
-// PRIVATE
-void FboManager::SetScreenShaderUniforms(Shader* shader) {
-
-	shader->SetBool("bloomEnabled", glowEnabled);
-
-	shader->SetBool("gammaEnabled", gammaCorrectionEnabled);
-	shader->SetFloat("gamma", gamma);
-	shader->SetBool("exposureEnabled", exposureEnabled);
-	shader->SetFloat("exposure", exposure);
-
-}
-
-void FboManager::BindSceneAndGlow() {
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tcbo[0]);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, pingpongBuffer[!horizontal]);
-}
-
+#include "FboManager.h"
+
+// constructor
+FboManager::FboManager(unsigned int SCR_WIDTH, unsigned int SCR_HEIGHT) {
+	// FBO
+	// stores the scene in tcbo[0] and the bloom in tcbo[1], they are blended together in 4.5.
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	// TCBO[2]
+	// genereate and attach to framebuffer object (fbo)
+	glGenTextures(2, tcbo);
+	for (unsigned int i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D, tcbo[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, tcbo[i], 0);
+	}
+
+	// RBO
+	// depth and stencil buffer object
+	glGenRenderbuffers(1, &rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+	// allocate storage and unbind
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	// attach to the framebuffer object (fbo)
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+	// tell opengl which color attachments to use for rendering (of this framebuffer, fbo)
+	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// PINGPONG FBOs & BUFFERS
+	glGenFramebuffers(2, pingpongFBO);
+	glGenTextures(2, pingpongBuffer);
+
+	for (unsigned int i = 0; i < 2; i++) {
+		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
+		glBindTexture(GL_TEXTURE_2D, pingpongBuffer[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongBuffer[i], 0);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// LIGHTING TARGETS
+	width = SCR_WIDTH;
+	height = SCR_HEIGHT;
+	glGenTextures(2, historyBuffer);
+	glGenTextures(1, &lowResLighting);
+	glGenFramebuffers(1, &lowResFBO);
+	AllocateLightingTargets();
+
+	// ANALYTIC GLOW BINS
+	// the segments' buffer grows with the bolt
+	numBinsX = (width + GLOW_BIN_SIZE - 1) / GLOW_BIN_SIZE;
+	numBinsY = (height + GLOW_BIN_SIZE - 1) / GLOW_BIN_SIZE;
+	glGenBuffers(1, &glowSegmentBuffer);
+	glGenBuffers(1, &binCountBuffer);
+	glGenBuffers(1, &binCursorBuffer);
+	glGenBuffers(1, &binTotalBuffer);
+	glGenBuffers(1, &binReadbackBuffer);
+	glGenBuffers(1, &binSegmentBuffer);
+	for (unsigned int buffer : { binCountBuffer, binCursorBuffer }) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, numBinsX * numBinsY * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, binTotalBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, binReadbackBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int), NULL, GL_STREAM_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	// room for 64 segments in every bin to start with
+	binCapacity = numBinsX * numBinsY * 64;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, binSegmentBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, binCapacity * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// PUBLIC
+void FboManager::ApplyGlow(Shader shader) {
+	if (!glowTimer.Pending()) {
+		glowTimer.Begin();
+		timedGlow = 0;
+	}
+	shader.Use();
+	shader.SetInt("weightType", weightType);
+	horizontal = true;
+	bool firstIteration = true;
+
+	for (int i = 0; i < glow; i++) {
+		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+		shader.SetInt("horizontal", horizontal);
+		// bind texutre of other framebuffer, or the texture to blur if first iteration
+		glBindTexture(GL_TEXTURE_2D, firstIteration ?
+			tcbo[1] : pingpongBuffer[!horizontal]);
+		// render quad
+		RenderQuad();
+		// swap buffers
+		horizontal = !horizontal;
+		if (firstIteration)
+			firstIteration = false;
+	}
+
+	glowTimer.End();
+	double ms;
+	if (glowTimer.Poll(&ms)) {
+		glowMs[timedGlow] = ms;
+	}
+}
+
+bool FboManager::GetAnalyticGlowEnabled() {
+	return glowEnabled && glowTypeChoice == 1;
+}
+
+// the glow is written to pingpongBuffer[0], which the blend reads when horizontal is set
+void FboManager::ApplyAnalyticGlow(Shader* binShader, Shader* scanShader, Shader* glowShader, BoltMesh* mesh,
+	mat4 viewProjection, vec3 viewPos, vec3 color, float alpha) {
+	if (!glowTimer.Pending()) {
+		glowTimer.Begin();
+		timedGlow = 1;
+	}
+	int numSegments = mesh->NumSegments();
+	horizontal = true;
+	if (numSegments == 0) {
+		glClearTexImage(pingpongBuffer[0], 0, GL_RGBA, GL_FLOAT, NULL);
+	}
+	else {
+		if (numSegments > glowSegmentCapacity) {
+			glowSegmentCapacity = numSegments + numSegments / 2;
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, glowSegmentBuffer);
+			// vec4 ends and float weight, padded to 32 bytes by std430
+			glBufferData(GL_SHADER_STORAGE_BUFFER, glowSegmentCapacity * 32, NULL, GL_DYNAMIC_DRAW);
+		}
+		// an earlier frame's total once the GPU has written it, the lists grow if it
+		// didn't fit. Until then they keep their size.
+		GLenum fenceStatus = binTotalFence ? glClientWaitSync(binTotalFence, 0, 0) : GL_TIMEOUT_EXPIRED;
+		if (fenceStatus == GL_ALREADY_SIGNALED || fenceStatus == GL_CONDITION_SATISFIED) {
+			glDeleteSync(binTotalFence);
+			binTotalFence = 0;
+			unsigned int total = 0;
+			glBindBuffer(GL_COPY_READ_BUFFER, binReadbackBuffer);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(unsigned int), &total);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			binnedSegments = total;
+			if (binnedSegments > binCapacity) {
+				binOverflows++;
+				binCapacity = binnedSegments + binnedSegments / 2;
+				glBindBuffer(GL_SHADER_STORAGE_BUFFER, binSegmentBuffer);
+				glBufferData(GL_SHADER_STORAGE_BUFFER, binCapacity * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+			}
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, binCountBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		mesh->BindSegments(BOLT_SEGMENT_BINDING);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLOW_SEGMENT_BINDING, glowSegmentBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLOW_BIN_COUNT_BINDING, binCountBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLOW_BIN_SEGMENT_BINDING, binSegmentBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLOW_BIN_CURSOR_BINDING, binCursorBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLOW_BIN_TOTAL_BINDING, binTotalBuffer);
+		float radius = glowRadius * height;
+
+		// 1. count each bin's segments
+		binShader->Use();
+		binShader->SetMat4("viewProjection", viewProjection);
+		binShader->SetVec3("viewPos", viewPos);
+		binShader->SetInt("numSegments", numSegments);
+		binShader->SetIVec2("screenSize", width, height);
+		binShader->SetIVec2("numBins", numBinsX, numBinsY);
+		binShader->SetFloat("glowRadius", radius);
+		binShader->SetInt("binCapacity", binCapacity);
+		binShader->SetBool("fill", false);
+		glDispatchCompute((numSegments + 63) / 64, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		// 2. where each bin's list starts
+		scanShader->Use();
+		scanShader->SetInt("numBinsTotal", numBinsX * numBinsY);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		// the copy isn't written again until it's been read, so reading it never waits
+		if (!binTotalFence) {
+			glBindBuffer(GL_COPY_READ_BUFFER, binTotalBuffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, binReadbackBuffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(unsigned int));
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			binTotalFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+
+		// 3. fill the lists
+		binShader->Use();
+		binShader->SetBool("fill", true);
+		glDispatchCompute((numSegments + 63) / 64, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		// 4. glow of each pixel from its bin
+		glowShader->Use();
+		glowShader->SetInt("binCapacity", binCapacity);
+		glowShader->SetIVec2("screenSize", width, height);
+		glowShader->SetIVec2("numBins", numBinsX, numBinsY);
+		glowShader->SetFloat("glowRadius", radius);
+		glowShader->SetFloat("glowStrength", glowStrength);
+		glowShader->SetVec3("color", color);
+		glowShader->SetFloat("alpha", alpha);
+		glBindImageTexture(0, pingpongBuffer[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+
+	glowTimer.End();
+	double ms;
+	if (glowTimer.Poll(&ms)) {
+		glowMs[timedGlow] = ms;
+	}
+}
+
+void FboManager::PostProcessingGUI() {
+	static const char* weightNames[2] = { "Gaussian", "Custom" };
+
+	const ImVec2 startPos = ImVec2(575, 119);
+	ImGui::SetNextWindowPos(startPos, ImGuiCond_Once);
+	ImGui::Begin("Post Processing", NULL, ImGuiWindowFlags_AlwaysAutoResize);
+
+	ImGui::Separator();
+	ImGui::Text("Glow");
+	ImGui::Checkbox("##glowEnabled", &glowEnabled);
+	if (glowEnabled) {
+		static const char* glowTypeNames[2] = { "Blur", "Analytic" };
+		ImGui::Combo("##glowType", &glowTypeChoice, glowTypeNames, 2);
+		if (glowTypeChoice == 0) {
+			ImGui::SliderInt("##glow", &glow, 1, 20);
+			ImGui::Text("Weight Type");
+			ImGui::Combo("", &weightType, weightNames, 2);
+		}
+		else {
+			ImGui::Text("Radius");
+			ImGui::SliderFloat("##glowRadius", &glowRadius, 0.001f, 0.05f, "%.3f");
+			ImGui::Text("Strength");
+			ImGui::SliderFloat("##glowStrength", &glowStrength, 0.1f, 10.0f, "%.1f");
+		}
+		// measured on the GPU
+		ImGui::Text("Blur: %.3f ms  Analytic: %.3f ms", float(glowMs[0]), float(glowMs[1]));
+		if (glowTypeChoice == 1) {
+			ImGui::Text("Binned: %d / %d segments, %d overflows", binnedSegments, binCapacity, binOverflows);
+		}
+	}
+
+	ImGui::Separator();
+	static const char* scaleNames[3] = { "Full", "Half", "Quarter" };
+	ImGui::Text("Lighting Resolution");
+	if (ImGui::Combo("##lightingScale", &lightingScaleChoice, scaleNames, 3)) {
+		AllocateLightingTargets();
+	}
+	ImGui::Checkbox("Tiled Compute Lighting", &tiledLightingEnabled);
+	// measured on the GPU, with the upsampling
+	for (int i = 0; i < 3; i++) {
+		ImGui::Text("%s: %.3f ms", scaleNames[i], float(lightingMs[i]));
+	}
+	ImGui::Text("Tiled Compute: %.3f ms", float(lightingMs[3]));
+
+	ImGui::Separator();
+	ImGui::Text("Gamma Correction");
+	ImGui::Checkbox("##gammaEnabled", &gammaCorrectionEnabled);
+	if (gammaCorrectionEnabled) {
+		ImGui::SliderFloat("##gamma", &gamma, 0.1f, 5.0f, "%.1f");
+	}
+
+	ImGui::Separator();
+	ImGui::Text("Exposure");
+	ImGui::Checkbox("###exposureEnabled", &exposureEnabled);
+	if (exposureEnabled) {
+		ImGui::SliderFloat("##exposure", &exposure, 0.1f, 30, "%.1f");
+	}
+
+	ImGui::End();
+}
+
+bool FboManager::GetGlowEnabled() {
+	return glowEnabled;
+}
+
+unsigned int FboManager::GetFbo() {
+	return fbo;
+}
+
+void FboManager::Bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void FboManager::BindDraw() {
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+}
+
+// Without writeHistory the history isn't a draw buffer, so it's neither cleared
+// nor written, and isn't valid for the next frame.
+void FboManager::BeginLightingPass(bool writeHistory) {
+	if (!lightingTimer.Pending()) {
+		lightingTimer.Begin();
+		timedPath = lightingScaleChoice;
+	}
+
+	historyWritten = writeHistory;
+	unsigned int history = writeHistory ? GL_COLOR_ATTACHMENT2 : GL_NONE;
+	int scale = lightingScales[lightingScaleChoice];
+	if (scale == 1) {
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, historyBuffer[historyIndex], 0);
+		unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, history };
+		glDrawBuffers(3, attachments);
+	}
+	else {
+		// the bloom is taken from the upsampled lighting
+		glBindFramebuffer(GL_FRAMEBUFFER, lowResFBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, historyBuffer[historyIndex], 0);
+		unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_NONE, history };
+		glDrawBuffers(3, attachments);
+		glViewport(0, 0, width / scale, height / scale);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + LIGHT_HISTORY_UNIT);
+	glBindTexture(GL_TEXTURE_2D, historyBuffer[!historyIndex]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// the bolt is drawn to the scene and bloom only
+void FboManager::EndLightingPass(Shader* upsampleShader) {
+	int scale = lightingScales[lightingScaleChoice];
+	if (scale > 1) {
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, width, height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		upsampleShader->Use();
+		upsampleShader->SetBool("bloomEnabled", glowEnabled);
+		glActiveTexture(GL_TEXTURE0 + LOW_RES_LIGHTING_UNIT);
+		glBindTexture(GL_TEXTURE_2D, lowResLighting);
+		glActiveTexture(GL_TEXTURE0);
+		RenderQuad();
+	}
+	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
+	if (historyWritten) {
+		historyIndex = !historyIndex;
+	}
+	historyValid = historyWritten;
+
+	lightingTimer.End();
+	double ms;
+	if (lightingTimer.Poll(&ms)) {
+		lightingMs[timedPath] = ms;
+	}
+}
+
+bool FboManager::GetTiledLightingEnabled() {
+	return tiledLightingEnabled && lightingScales[lightingScaleChoice] == 1;
+}
+
+// only the scene and bloom are cleared, the history isn't written
+void FboManager::BeginTiledLightingPass() {
+	if (!lightingTimer.Pending()) {
+		lightingTimer.Begin();
+		timedPath = 3;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
+}
+
+void FboManager::DispatchTiledLighting(Shader* computeShader) {
+	computeShader->SetBool("bloomEnabled", glowEnabled);
+	glBindImageTexture(0, tcbo[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, tcbo[1], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute((width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE, 1);
+	// the bolt is drawn over the scene, and both are read by the glow and blend
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	historyValid = false;
+
+	lightingTimer.End();
+	double ms;
+	if (lightingTimer.Poll(&ms)) {
+		lightingMs[timedPath] = ms;
+	}
+}
+
+bool FboManager::GetLightHistoryValid() {
+	return historyValid;
+}
+
+// History at the lighting resolution, and the low resolution target it's drawn to.
+// Cleared so the first frame's history is empty.
+void FboManager::AllocateLightingTargets() {
+	int scale = lightingScales[lightingScaleChoice];
+	unsigned int lightingWidth = width / scale;
+	unsigned int lightingHeight = height / scale;
+	for (unsigned int i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D, historyBuffer[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, lightingWidth, lightingHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glClearTexImage(historyBuffer[i], 0, GL_RGBA, GL_FLOAT, NULL);
+	}
+	historyValid = false;
+
+	// upsampling reads individual texels, no filtering
+	glBindTexture(GL_TEXTURE_2D, lowResLighting);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, lightingWidth, lightingHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindFramebuffer(GL_FRAMEBUFFER, lowResFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lowResLighting, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FboManager::PrepareScreenShader(Shader* shader) {
+	BindSceneAndGlow();
+	SetScreenShaderUniforms(shader);
+}
+
+void FboManager::OutputBuffers() {
+	std::cout << "fbo: " << fbo << std::endl;
+	std::cout << "tcbo[0]: " << tcbo[0] << std::endl;
+	std::cout << "tcbo[1]: " << tcbo[1] << std::endl;
+	std::cout << "rbo: " << rbo << std::endl;
+	std::cout << "pingpongFBO[0]: " << pingpongFBO[0] << std::endl;
+	std::cout << "pingpongFBO[1]: " << pingpongFBO[1] << std::endl;
+	std::cout << "pingpongBuffer[0]: " << pingpongBuffer[0] << std::endl;
+	std::cout << "pingpongBuffer[1]: " << pingpongBuffer[1] << std::endl;
+}
+
+// PRIVATE
+void FboManager::SetScreenShaderUniforms(Shader* shader) {
+
+	shader->SetBool("bloomEnabled", glowEnabled);
+
+	shader->SetBool("gammaEnabled", gammaCorrectionEnabled);
+	shader->SetFloat("gamma", gamma);
+	shader->SetBool("exposureEnabled", exposureEnabled);
+	shader->SetFloat("exposure", exposure);
+
+}
+
+void FboManager::BindSceneAndGlow() {
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, tcbo[0]);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, pingpongBuffer[!horizontal]);
+}
+
@@ -1,45 +1,135 @@
-#pragma once
-
-#include <glad/glad.h>
-#include <iostream>
-
-#include "../Shader/Shader.h"
-#include "../Renderer.h"
-
-class FboManager {
-public:
-	FboManager(unsigned int width, unsigned int height);
-	unsigned int GetFbo();
-	void Bind();
-	void BindDraw();
-	void PrepareScreenShader(Shader* shader);
-	void ApplyGlow(Shader shader);
-	void OutputBuffers();
-	bool GetGlowEnabled();
-	void PostProcessingGUI();
-private:
-	// Buffer Objects
-	unsigned int fbo;
-	unsigned int tcbo[2];
-	unsigned int rbo;
-	unsigned int pingpongFBO[2];
-	unsigned int pingpongBuffer[2];
-
-	// Glow
-	bool glowEnabled = true;
-	int glow = 4;
-	int weightType = 0;
-
-	// Gamma & Exposure
-	bool gammaCorrectionEnabled = true;
-	float gamma = 2.2f;
-	bool exposureEnabled = true;
-	float exposure = 1.0f;
-
-
-	bool horizontal = true;
-
-	void BindSceneAndGlow();
-	void SetScreenShaderUniforms(Shader* shader);
-
+#pragma once
+
+#include <glad/glad.h>
+#include <iostream>
+
+#include "../Shader/Shader.h"
+#include "../Renderer.h"
+#include "../Timer.h"
+#include "../BoltGeneration/BoltMesh.h"
+
+using glm::mat4;
+
+// texture unit of the last frame's lighting, after the g-buffer and shadow maps
+const unsigned int LIGHT_HISTORY_UNIT = 11;
+// texture unit of the reduced resolution lighting, while it's upsampled
+const unsigned int LOW_RES_LIGHTING_UNIT = 12;
+// binding points of the analytic glow's SSBOs (around BoltMesh's),
+// must match glow_bin.comp, glow_scan.comp and glow.comp
+const unsigned int GLOW_SEGMENT_BINDING = 6;
+const unsigned int GLOW_BIN_COUNT_BINDING = 7;
+const unsigned int GLOW_BIN_SEGMENT_BINDING = 8;
+const unsigned int GLOW_BIN_CURSOR_BINDING = 10;
+const unsigned int GLOW_BIN_TOTAL_BINDING = 11;
+
+class FboManager {
+public:
+	FboManager(unsigned int width, unsigned int height);
+	unsigned int GetFbo();
+	void Bind();
+	void BindDraw();
+	// with writeHistory the lighting pass also writes its lighting to this frame's
+	// history, and reads the last frame's from LIGHT_HISTORY_UNIT. At a reduced lighting
+	// resolution it's drawn to a smaller target, which EndLightingPass upsamples
+	// to the scene and bloom with upsampleShader (the g-buffer's textures bound).
+	void BeginLightingPass(bool writeHistory);
+	void EndLightingPass(Shader* upsampleShader);
+	// false when the history was just (re)allocated
+	bool GetLightHistoryValid();
+	// Tiled lighting: a compute shader writes the scene and bloom directly, with
+	// the g-buffer's textures and shadow maps bound and the shader's uniforms set
+	bool GetTiledLightingEnabled();
+	void BeginTiledLightingPass();
+	void DispatchTiledLighting(Shader* computeShader);
+	void PrepareScreenShader(Shader* shader);
+	void ApplyGlow(Shader shader);
+	// Analytic glow: worked out from the mesh's segments by the compute shaders
+	// instead of blurring the bolt, with the g-buffer's textures bound
+	bool GetAnalyticGlowEnabled();
+	void ApplyAnalyticGlow(Shader* binShader, Shader* scanShader, Shader* glowShader, BoltMesh* mesh,
+		mat4 viewProjection, vec3 viewPos, vec3 color, float alpha);
+	void OutputBuffers();
+	bool GetGlowEnabled();
+	void PostProcessingGUI();
+private:
+	// Buffer Objects
+	unsigned int fbo;
+	unsigned int tcbo[2];
+	unsigned int rbo;
+	unsigned int pingpongFBO[2];
+	unsigned int pingpongBuffer[2];
+	// Light History
+	// lighting (rgb) and distance from the camera (a) of this frame and the last
+	unsigned int historyBuffer[2];
+	int historyIndex = 0;
+	bool historyValid = false;
+	bool historyWritten = false;		// by the current lighting pass
+	unsigned int width, height;
+
+	// Lighting Resolution
+	// the lighting pass can be evaluated at 1/2 or 1/4 of the resolution, then upsampled
+	// with a bilateral filter that only mixes low resolution pixels with similar depths
+	// and normals. The history is kept at the lighting resolution.
+	int lightingScaleChoice = 0;			// index into lightingScales
+	const int lightingScales[3] = { 1, 2, 4 };
+	unsigned int lowResFBO;
+	unsigned int lowResLighting;
+	GpuTimer lightingTimer;
+	int timedPath = 0;
+	// measured, lighting pass and upsampling at each scale, then the tiled compute pass
+	double lightingMs[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+	// Tiled Lighting
+	// 16x16 pixel tiles each shaded by the lights that reach their surface, at full
+	// resolution only. The fragment shader is the fallback.
+	bool tiledLightingEnabled = false;
+	const int TILE_SIZE = 16;	// must match the work group size in tiled_lighting.comp
+
+	// Glow
+	bool glowEnabled = true;
+	int glow = 4;
+	int weightType = 0;
+	GpuTimer glowTimer;
+	int timedGlow = 0;
+	double glowMs[2] = { 0.0, 0.0 };	// measured, blur then analytic
+
+	// Analytic Glow
+	// each segment is added to the 32x32 pixel bins its glow reaches, then each
+	// pixel sums a gaussian of its distance to its bin's segments. The bins' lists
+	// share one buffer: the segments are counted per bin, a prefix sum of the
+	// counts places each bin's list, then the lists are filled. Only the bolt
+	// glows, lit surfaces over the bloom threshold don't.
+	int glowTypeChoice = 0;				// blur, analytic
+	float glowRadius = 0.006f;			// fraction of the screen height
+	float glowStrength = 2.0f;
+	const int GLOW_BIN_SIZE = 32;		// must match glow_bin.comp and glow.comp
+	unsigned int glowSegmentBuffer;
+	unsigned int binCountBuffer;
+	unsigned int binCursorBuffer;
+	unsigned int binTotalBuffer;
+	unsigned int binReadbackBuffer;		// copy of a frame's total, read once its fence has signaled
+	unsigned int binSegmentBuffer;
+	int glowSegmentCapacity = 0;
+	// binned segments the lists have room for, grown when a frame needs more. The
+	// total is read back once the GPU is done with it, without waiting, so the
+	// frames that overflow before then lose some glow.
+	int binCapacity;
+	int binnedSegments = 0;
+	int binOverflows = 0;				// times the lists ran out of room
+	GLsync binTotalFence = 0;			// pending copy to binReadbackBuffer
+	int numBinsX, numBinsY;
+
+	// Gamma & Exposure
+	bool gammaCorrectionEnabled = true;
+	float gamma = 2.2f;
+	bool exposureEnabled = true;
+	float exposure = 1.0f;
+
+
+	bool horizontal = true;
+
+	void BindSceneAndGlow();
+	void AllocateLightingTargets();
+	void SetScreenShaderUniforms(Shader* shader);
+
 };
\ No newline at end of file
@@ -51,6 +51,13 @@ void G_Buffer::Bind()
 	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
 }
 
+void G_Buffer::Clear()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const float noPosition[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, noPosition);
+}
+
 void G_Buffer::BindRead() {
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
 }
@@ -66,4 +73,4 @@ void G_Buffer::BindTextures() {
 
 void G_Buffer::GeometryPass(const Shader& shader) {
 	RenderScene(shader);
-}
\ No newline at end of file
+}
\ No newline at end of file
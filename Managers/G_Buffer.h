@@ -9,10 +9,12 @@ class G_Buffer {
 public:
 	G_Buffer(unsigned int width, unsigned int height);
 	void Bind();
+	// clears the bound g-buffer, gPosition's alpha to 0 so the background can be told apart
+	void Clear();
 	void BindRead();
 	void BindTextures();
 	void GeometryPass(const Shader& shader);
 private:
 	unsigned int gBuffer;
 	unsigned int gPosition, gNormal, gAlbedoSpec, rboDepth;
-};
\ No newline at end of file
+};
\ No newline at end of file
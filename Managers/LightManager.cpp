@@ -1,203 +1,822 @@
-#include "LightManager.h"
-
-LightManager::LightManager()
-{
-	SetupFBOandTexture();
-
-	// default values
-	lightPositions.resize(MAX_POINT_LIGHTS);
-	lightColor = vec3(1.0f, 1.0f, 1.0f);
-	near_plane = 1;
-	far_plane = 150;
-	numActiveLights = 0;
-	attenuationChoice = 7;
-	vec3 atten = attenuationOptions[attenuationChoice];
-	attenuationRadius = atten.x;
-	linear = atten.y;
-	quadratic = atten.z;
-
-	UpdateShadowProjection();
-}
-
-void LightManager::Init(Shader* _depthShader)
-{
-	depthShader = _depthShader;
-}
-
-void LightManager::SetupFBOandTexture() {
-	glGenFramebuffers(1, &depthCubemapArrayFBO);
-	// Depth Cubemap Array texture
-	glGenTextures(1, &depthCubemapArray);
-	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, depthCubemapArray);
-	// assign the texture 
-	glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT32, SHADOW_WIDTH,
-		SHADOW_HEIGHT, 6 * MAX_POINT_LIGHTS, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
-
-	// set texture parameters
-	glTexParameterf(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameterf(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	glClear(GL_DEPTH_BUFFER_BIT); float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
-	glTexParameterf(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, depthCubemapArrayFBO);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemapArray, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-// DYNAMIC
-void LightManager::SetLightPositions(vector<vec3>* _lightPositions) {
-
-	if (GetNumActiveLights() > MAX_POINT_LIGHTS) {
-		std::cout << "ERROR::LightManager::SetLightPositions::DYNAMIC:: numLightsActive > MAX_POINT_LIGHTS" << std::endl;
-		return;
-	}
-	lightPositions.clear();
-	numActiveLights	= GetNumActiveLights();
-	for (int i = 0; i < numActiveLights; i++) {
-		lightPositions.push_back(_lightPositions->at(i));
-	}
-}
-
-// STATIC
-void LightManager::SetLightPositions(vec3* _lightPositions) {
-
-	if (GetNumActiveLights() > MAX_POINT_LIGHTS) {
-		std::cout << "ERROR::LightManager::SetLightPositions::STATIC:: numSegmentsInPattern > MAX_POINT_LIGHTS" << std::endl;
-		return;
-	}
-
-	numActiveLights = GetNumActiveLights();
-	for (int i = 0; i < numActiveLights; i++) {
-		lightPositions[i] = (_lightPositions[i]);
-	}
-}
-
-void LightManager::RenderDepthMaps() {
-	glEnable(GL_DEPTH_TEST);
-	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-	glBindFramebuffer(GL_FRAMEBUFFER, depthCubemapArrayFBO);
-	glClear(GL_DEPTH_BUFFER_BIT);
-	depthShader->Use();
-	depthShader->SetFloat("far_plane", far_plane); // far_plane is constant for all lights
-
-	vector<mat4> shadowTransforms;
-	for (unsigned int light = 0; light < numActiveLights; light++) {
-		// For each light...
-		shadowTransforms = GenerateShadowTransforms(lightPositions[light]);
-		for (unsigned int i = 0; i < 6; i++) {
-			// For each face of the cubemap...
-			depthShader->SetMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-		}
-		depthShader->SetInt("index", light);
-		depthShader->SetVec3("lightPos", lightPositions[light]);
-		RenderScene(*depthShader);
-	}
-}
-
-void LightManager::BindCubeMapArray() {
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, depthCubemapArray);
-}
-
-void LightManager::SetLightingPassUniforms(Shader* shader) {
-	shader->SetFloat("Linear", linear);
-	shader->SetFloat("Quadratic", quadratic);
-	shader->SetFloat("far_plane", far_plane);
-	shader->SetVec3("lightColor", lightColor);
-	shader->SetInt("numLightsActive", numActiveLights);
-	// Set the light positions
-	for (int i = 0; i < numActiveLights; i++) {
-		shader->SetVec3("lightPositions[" + std::to_string(i) + "]", lightPositions[i]);
-	}
-}
-
-vector<mat4> LightManager::GenerateShadowTransforms(vec3 lightPos) {
-	// Create 6 transformation matrices, one for each face of the cube
-	vector<mat4> shadowTransforms;
-	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(1.0, 0.0, 0.0), vec3(0.0, -1.0, 0.0)));
-	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(-1.0, 0.0, 0.0), vec3(0.0, -1.0, 0.0)));
-	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0)));
-	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, -1.0)));
-	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, 0.0, 1.0), vec3(0.0, -1.0, 0.0)));
-	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, 0.0, -1.0), vec3(0.0, -1.0, 0.0)));
-
-	return shadowTransforms;
-}
-
-void LightManager::UpdateShadowProjection() {
-	shadowProj = glm::perspective(glm::radians(90.0f), aspect, near_plane, far_plane);
-}
-
-bool LightManager::GetLightBoxesEnabled() {
-	return lightBoxesEnabled;
-}
-
-// GUI
-void LightManager::LightingTabGUI() {
-	ImGui::Text("Attenuation");
-	ImGui::Text("Radius: %d", attenuationRadius);
-	if (ImGui::SliderInt("##choice", &attenuationChoice, 0, 11)) {
-		// Update the attenuation values
-		vec3 atten = attenuationOptions[attenuationChoice];
-		attenuationRadius = atten.x;
-		linear = atten.y;
-		quadratic = atten.z;
-	}
-
-	ImGui::Separator();
-	ImGui::Text("Light Color");
-	ImGui::ColorEdit3("##color", (float*)&lightColor);
-}
-// TABS
-void LightManager::ShadowsTabGUI() {
-	ImGui::Text("Far Plane: "); ImGui::SameLine();
-	ImGui::SliderFloat("##farPlane", &far_plane, 1, 200);
-}
-void LightManager::LightsTabGUI() {
-	int numLights = GetNumLights();
-
-	ImGui::Text("Number of Lights:"); ImGui::SameLine();
-	ImGui::Text("%d", numLights);  ImGui::SameLine();
-
-	ImGui::PushButtonRepeat(true);
-	if (ImGui::ArrowButton("##numLightsL", ImGuiDir_Up))
-		numLights++; SetNumLights(numLights); ImGui::SameLine();
-	if (ImGui::ArrowButton("##numLightsR", ImGuiDir_Down))
-		numLights--; SetNumLights(numLights);
-
-	ImGui::Separator();
-	if (ImGui::Button("Show Light Positions")) {
-		lightBoxesEnabled = !lightBoxesEnabled;
-	}
-}
-void LightManager::LightingGUI() {
-	const ImVec2 startPos = ImVec2(575, 426);
-	ImGui::SetNextWindowPos(startPos, ImGuiCond_Once);
-	ImGui::Begin("Lighting", NULL, ImGuiWindowFlags_AlwaysAutoResize);
-
-	if (ImGui::BeginTabBar("Lighting")) {
-		if (ImGui::BeginTabItem("Lighting")) {
-			LightingTabGUI();
-			ImGui::EndTabItem();
-		}
-		if (ImGui::BeginTabItem("Shadows")) {
-			ShadowsTabGUI();
-			ImGui::EndTabItem();
-		}
-		if (ImGui::BeginTabItem("Lights")) {
-			LightsTabGUI();
-			ImGui::EndTabItem();
-		}
-		ImGui::EndTabBar();
-	}
-
-	ImGui::End();
+#include "LightManager.h"
+
+LightManager::LightManager()
+{
+	SetupFBOandTexture();
+
+	// default values
+	lightPositions.resize(MAX_POINT_LIGHTS);
+	lightColor = vec3(1.0f, 1.0f, 1.0f);
+	near_plane = 1;
+	far_plane = 150;
+	numActiveLights = 0;
+	attenuationChoice = 7;
+	vec3 atten = attenuationOptions[attenuationChoice];
+	attenuationRadius = atten.x;
+	linear = atten.y;
+	quadratic = atten.z;
+
+	UpdateShadowProjection();
+}
+
+void LightManager::Init(Shader* _depthShader, Shader* _paraboloidShader)
+{
+	depthShader = _depthShader;
+	paraboloidShader = _paraboloidShader;
+	firstDrawLocation = glGetUniformLocation(depthShader->ID, "firstDraw");
+	paraboloidFirstDrawLocation = glGetUniformLocation(paraboloidShader->ID, "firstDraw");
+}
+
+void LightManager::SetupFBOandTexture() {
+	// One Depth Cubemap Array texture per resolution tier
+	for (int tier = 0; tier < NUM_SHADOW_TIERS; tier++) {
+		glGenFramebuffers(1, &tierFBOs[tier]);
+		glGenTextures(1, &tierCubemapArrays[tier]);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, tierCubemapArrays[tier]);
+		// assign the texture 
+		glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT32, tierResolutions[tier],
+			tierResolutions[tier], 6 * tierCapacities[tier], 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+
+		// set texture parameters
+		// sampled with depth comparison, the hardware filters the compared 2x2 texels
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+		float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameterfv(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glTexParameterf(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, tierFBOs[tier]);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, tierCubemapArrays[tier], 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	// Dual Paraboloid: a 2D array texture per tier, two layers (hemispheres) per light
+	for (int tier = 0; tier < NUM_SHADOW_TIERS; tier++) {
+		glGenFramebuffers(1, &paraboloidFBOs[tier]);
+		glGenTextures(1, &paraboloidArrays[tier]);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, paraboloidArrays[tier]);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, tierResolutions[tier],
+			tierResolutions[tier], 2 * tierCapacities[tier], 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, paraboloidFBOs[tier]);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, paraboloidArrays[tier], 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// DYNAMIC
+void LightManager::SetLightPositions(vector<vec3>* _lightPositions) {
+
+	if (GetNumActiveLights() > int(stochasticLights ? MAX_STOCHASTIC_LIGHTS : MAX_POINT_LIGHTS)) {
+		std::cout << "ERROR::LightManager::SetLightPositions::DYNAMIC:: numLightsActive > MAX_POINT_LIGHTS" << std::endl;
+		return;
+	}
+	lightPositions.clear();
+	lightsAreLines = false;
+	numActiveLights	= GetNumActiveLights();
+	for (int i = 0; i < numActiveLights; i++) {
+		lightPositions.push_back(_lightPositions->at(i));
+	}
+	AssignLightSlots();
+}
+
+// STATIC
+void LightManager::SetLightPositions(vec3* _lightPositions) {
+
+	if (GetNumActiveLights() > MAX_POINT_LIGHTS) {
+		std::cout << "ERROR::LightManager::SetLightPositions::STATIC:: numSegmentsInPattern > MAX_POINT_LIGHTS" << std::endl;
+		return;
+	}
+
+	lightsAreLines = false;
+	numActiveLights = GetNumActiveLights();
+	for (int i = 0; i < numActiveLights; i++) {
+		lightPositions[i] = (_lightPositions[i]);
+	}
+	AssignLightSlots();
+}
+
+// Moves the given bolt lights (indices into the positions last passed to
+// SetLightPositions) and marks their shadow maps as needing a refresh.
+void LightManager::UpdateLightPositions(vector<vec3>* _lightPositions, const vector<int>& movedLights) {
+	for (int light : movedLights) {
+		if (light >= int(lightSlots.size()) || lightSlots[light] < 0) {
+			continue;
+		}
+		lightPositions[lightSlots[light]] = _lightPositions->at(light);
+		shadowDirty[lightSlots[light]] = true;
+		lightTreeDirty = true;
+	}
+}
+
+// DYNAMIC, line lights: each line is slotted like a point light at its midpoint
+void LightManager::SetLineLights(const vector<pair<vec3, vec3>>& lines) {
+	int numLines = lines.size();
+	if (numLines > MAX_LINE_LIGHTS) {
+		std::cout << "ERROR::LightManager::SetLineLights:: lines > MAX_LINE_LIGHTS" << std::endl;
+		return;
+	}
+	lightPositions.clear();
+	lightsAreLines = true;
+	numActiveLights = numLines;
+	for (const pair<vec3, vec3>& line : lines) {
+		lightPositions.push_back((line.first + line.second) * 0.5f);
+	}
+	AssignLightSlots();
+	lineLights.assign(numActiveLights, pair<vec3, vec3>());
+	for (int i = 0; i < numLines; i++) {
+		if (lightSlots[i] >= 0) {
+			lineLights[lightSlots[i]] = lines[i];
+		}
+	}
+	UpdateTotalLineLength();
+}
+
+// Moves the line lights after a flicker, only the ones that changed get new shadow maps.
+// The same bolt gives the same number of lines, otherwise they're all set again.
+void LightManager::UpdateLineLights(const vector<pair<vec3, vec3>>& lines) {
+	if (!lightsAreLines || lines.size() != lightSlots.size()) {
+		SetLineLights(lines);
+		return;
+	}
+	for (int i = 0; i < int(lines.size()); i++) {
+		int slot = lightSlots[i];
+		if (slot < 0 || lineLights[slot] == lines[i]) {
+			continue;
+		}
+		lineLights[slot] = lines[i];
+		lightPositions[slot] = (lines[i].first + lines[i].second) * 0.5f;
+		shadowDirty[slot] = true;
+	}
+	UpdateTotalLineLength();
+}
+
+void LightManager::UpdateTotalLineLength() {
+	totalLineLength = 0;
+	for (int i = 0; i < numSlottedLights; i++) {
+		totalLineLength += glm::length(lineLights[i].second - lineLights[i].first);
+	}
+}
+
+// Packs the lights into the slots used by the shadow maps and the lighting pass.
+// Lights inside the scene's geometry (a bolt that ended inside the tower) 
+// can't light anything visible, they're given no slot.
+void LightManager::AssignLightSlots() {
+	lightsBuried = 0;
+	const TriangleBVH& sceneBVH = GetSceneBVH();
+	lightSlots.resize(numActiveLights);
+	int kept = 0;
+	for (int i = 0; i < numActiveLights; i++) {
+		if (removeBuriedLights && sceneBVH.Inside(lightPositions[i])) {
+			lightSlots[i] = -1;
+			lightsBuried++;
+		}
+		else {
+			lightSlots[i] = kept;
+			lightPositions[kept++] = lightPositions[i];
+		}
+	}
+	numActiveLights = kept;
+	numSlottedLights = kept;
+	shadowDirty.assign(numActiveLights, true);
+	shadowLastRefresh.assign(numActiveLights, shadowFrame);
+	shadowSlots.assign(numActiveLights, -1);
+	shadowSlotLights.assign(MAX_SHADOW_CASTERS, -1);
+	shadowSlotsDirty = true;
+	lightTreeDirty = true;
+}
+
+// Only the first count lights passed to SetLightPositions light the scene, used
+// while a bolt grows. Newly activated lights' shadow maps are still dirty.
+void LightManager::ActivateLights(int count) {
+	numActiveLights = 0;
+	for (int i = std::min(count, (int)lightSlots.size()) - 1; i >= 0; i--) {
+		if (lightSlots[i] >= 0) {
+			numActiveLights = lightSlots[i] + 1;
+			break;
+		}
+	}
+	shadowSlotsDirty = true;
+	lightTreeDirty = true;
+}
+
+// Clears every shadow map for a new bolt, RenderDirtyDepthMaps renders them
+void LightManager::ClearDepthMaps() {
+	for (int tier = 0; tier < NUM_SHADOW_TIERS; tier++) {
+		glBindFramebuffer(GL_FRAMEBUFFER, shadowTechnique == CUBEMAP ? tierFBOs[tier] : paraboloidFBOs[tier]);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+}
+
+// clears the layers of one light's shadow map, 6 cube faces or 2 hemispheres
+void LightManager::ClearShadowSlot(int shadowSlot) {
+	int tier = SlotTier(shadowSlot);
+	int resolution = tierResolutions[tier];
+	int layers = shadowTechnique == CUBEMAP ? 6 : 2;
+	unsigned int texture = shadowTechnique == CUBEMAP ? tierCubemapArrays[tier] : paraboloidArrays[tier];
+	float depth = 1.0f;
+	glClearTexSubImage(texture, 0, 0, 0, layers * (shadowSlot - TierFirstSlot(tier)),
+		resolution, resolution, layers, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+}
+
+// Every light's shadow map is rendered again with the new technique
+void LightManager::SetShadowTechnique(int technique) {
+	shadowTechnique = ShadowTechnique(technique);
+	ClearDepthMaps();
+	MarkShadowsDirty();
+}
+
+// Shadow slots are numbered through the tiers, highest resolution first
+int LightManager::TierFirstSlot(int tier) {
+	int first = 0;
+	for (int t = 0; t < tier; t++) {
+		first += tierCapacities[t];
+	}
+	return first;
+}
+
+int LightManager::SlotTier(int shadowSlot) {
+	int tier = 0;
+	while (tier < NUM_SHADOW_TIERS - 1 && shadowSlot >= TierFirstSlot(tier + 1)) {
+		tier++;
+	}
+	return tier;
+}
+
+// Gives the numShadowCasters most important active lights a shadow slot, in the 
+// highest resolution tier with room left in rank order. Lights that stay in 
+// the same tier keep their slot and don't need their shadow maps rendered again.
+void LightManager::AssignShadowSlots(const mat4& viewProjection, vec3 viewPos) {
+	shadowSlotsDirty = false;
+	int casters = std::min(numShadowCasters, numActiveLights);
+	vector<int> ranked(numActiveLights);
+	std::iota(ranked.begin(), ranked.end(), 0);
+	if (casters < numActiveLights) {
+		vector<float> importance(numActiveLights);
+		for (int light = 0; light < numActiveLights; light++) {
+			importance[light] = LightImportance(light, viewProjection, viewPos);
+		}
+		std::partial_sort(ranked.begin(), ranked.begin() + casters, ranked.end(),
+			[&](int a, int b) { return importance[a] > importance[b]; });
+	}
+	ranked.resize(casters);
+
+	// free the slots of lights that dropped out or changed tier...
+	vector<int> lightTiers(shadowSlots.size(), -1);
+	for (int rank = 0; rank < casters; rank++) {
+		lightTiers[ranked[rank]] = SlotTier(rank);
+	}
+	for (int slot = 0; slot < MAX_SHADOW_CASTERS; slot++) {
+		int light = shadowSlotLights[slot];
+		if (light >= 0 && lightTiers[light] != SlotTier(slot)) {
+			shadowSlots[light] = -1;
+			shadowSlotLights[slot] = -1;
+		}
+	}
+	// ...and give them to the lights that came in, unshadowed until they're rendered
+	for (int light : ranked) {
+		if (shadowSlots[light] >= 0) {
+			continue;
+		}
+		int freeSlot = TierFirstSlot(lightTiers[light]);
+		while (shadowSlotLights[freeSlot] >= 0) {
+			freeSlot++;
+		}
+		shadowSlots[light] = freeSlot;
+		shadowSlotLights[freeSlot] = light;
+		shadowDirty[light] = true;
+		ClearShadowSlot(freeSlot);
+	}
+	numCastingLights = casters;
+}
+
+// Renders the shadow maps of lights that moved (or were activated) since they were 
+// last rendered. Called every frame, with the scheduler on only the highest priority
+// ones that fit in the frame's budget are rendered, the rest wait for later frames.
+void LightManager::RenderDirtyDepthMaps(const mat4& viewProjection, vec3 viewPos) {
+	shadowFrame++;
+	double ms;
+	if (shadowTimer.Poll(&ms) && timedLights > 0) {
+		shadowMsPerLight[timedTechnique] = glm::mix(shadowMsPerLight[timedTechnique], ms / timedLights, 0.25);
+	}
+	if (shadowSlotsDirty) {
+		AssignShadowSlots(viewProjection, viewPos);
+	}
+
+	// only lights with a shadow slot have a shadow map
+	vector<int> lights;
+	for (int i = 0; i < numActiveLights; i++) {
+		if (shadowDirty[i] && shadowSlots[i] >= 0) {
+			lights.push_back(i);
+		}
+	}
+	lightsPending = lights.size();
+	if (lights.empty()) {
+		return;
+	}
+
+	if (shadowSchedulerEnabled) {
+		int budget = std::min(shadowLightBudget, std::max(1, int(shadowTimeBudget / shadowMsPerLight[shadowTechnique])));
+		if (int(lights.size()) > budget) {
+			vector<float> priority(numActiveLights);
+			for (int light : lights) {
+				priority[light] = ShadowPriority(light, viewProjection, viewPos);
+			}
+			std::partial_sort(lights.begin(), lights.begin() + budget, lights.end(),
+				[&](int a, int b) { return priority[a] > priority[b]; });
+			lights.resize(budget);
+		}
+	}
+
+	for (int light : lights) {
+		ClearShadowSlot(shadowSlots[light]);
+	}
+
+	bool timing = !shadowTimer.Pending();
+	if (timing) {
+		timedLights = lights.size();
+		timedTechnique = shadowTechnique;
+		shadowTimer.Begin();
+	}
+	RenderShadowMaps(lights);
+	if (timing) {
+		shadowTimer.End();
+	}
+
+	for (int light : lights) {
+		shadowLastRefresh[light] = shadowFrame;
+	}
+	lightsPending -= lights.size();
+}
+
+// Every shadow map is out of date, after the scene changed
+void LightManager::MarkShadowsDirty() {
+	shadowDirty.assign(shadowDirty.size(), true);
+}
+
+// A light's estimated contribution to the image: its intensity and the screen 
+// coverage of its attenuation radius
+float LightManager::LightImportance(int light, const mat4& viewProjection, vec3 viewPos) {
+	vec3 lightPos = lightPositions[light];
+	float radius = attenuationRadius;
+	float distance = glm::length(lightPos - viewPos);
+
+	// roughly the fraction of the view its sphere of influence covers
+	float coverage = 1.0f;
+	if (distance > radius) {
+		coverage = (radius * radius) / (distance * distance);
+		glm::vec4 clip = viewProjection * glm::vec4(lightPos, 1.0f);
+		float margin = clip.w + radius;
+		if (clip.w < -radius || glm::abs(clip.x) > margin || glm::abs(clip.y) > margin) {
+			coverage *= 0.1f;	// off screen, only its shadows' edges could be seen
+		}
+	}
+	float intensity = glm::dot(lightColor, vec3(0.2126f, 0.7152f, 0.0722f));
+	return coverage * intensity;
+}
+
+// A dirty shadow map's importance, growing the more frames it's out of date
+float LightManager::ShadowPriority(int light, const mat4& viewProjection, vec3 viewPos) {
+	int age = shadowFrame - shadowLastRefresh[light];
+	return LightImportance(light, viewProjection, viewPos) * (1.0f + age * shadowAgeWeight);
+}
+
+// Renders the shadow maps of the given light slots, their layers must be cleared
+void LightManager::RenderShadowMaps(vector<int> lights) {
+	// grouped by tier, so each tier's framebuffer is bound once
+	std::sort(lights.begin(), lights.end(), [&](int a, int b) { return shadowSlots[a] < shadowSlots[b]; });
+
+	// the dual paraboloid shader projects the two hemispheres itself
+	Shader* shader = shadowTechnique == CUBEMAP ? depthShader : paraboloidShader;
+	int drawLocation = shadowTechnique == CUBEMAP ? firstDrawLocation : paraboloidFirstDrawLocation;
+
+	glEnable(GL_DEPTH_TEST);
+	shader->Use();
+	shader->SetFloat("far_plane", far_plane); // far_plane is constant for all lights
+
+	const vector<DrawItem>& drawList = GetDrawList();
+	const vector<DrawCommand>& drawCommands = GetDrawCommands();
+	// objects beyond the attenuation radius (or the far plane) can't cast a visible shadow
+	float cullRadius = glm::min(float(attenuationRadius), far_plane);
+
+	lightsRefreshed = lights.size();
+	objectsTested = 0;
+	objectsCulled = 0;
+	facesCulled = 0;
+	shadowTriangles = 0;
+	shadowTrianglesFullDetail = 0;
+
+	// the items' bounds only tell if they might be in range, the scene's triangles are 
+	// tested against every light's radius in one batch, for the items they belong to.
+	const TriangleBVH& sceneBVH = GetSceneBVH();
+	vector<unsigned long long> lightObjects;
+	if (shadowCullingEnabled) {
+		vector<vec3> centers;
+		for (int light : lights) {
+			centers.push_back(lightPositions[light]);
+		}
+		sceneBVH.SphereObjectMasks(centers, cullRadius, &lightObjects);
+	}
+
+	// 1. Cull the scene for each light, building one command list for all the lights
+	vector<DrawCommand> commands;
+	vector<int> faceMasks;
+	lightDraws.resize(lights.size());
+	for (unsigned int entry = 0; entry < lights.size(); entry++) {
+		// For each light...
+		vec3 lightPos = lightPositions[lights[entry]];
+		LightDrawRange& draws = lightDraws[entry];
+		draws.first = commands.size();
+		draws.oneSidedCount = 0;
+		draws.twoSidedCount = 0;
+
+		for (unsigned int i = 0; i < drawList.size(); i++) {
+			// For each object in the scene...
+			const DrawItem& item = drawList[i];
+			int faceMask = 0x3F;	// all faces
+			if (shadowCullingEnabled) {
+				objectsTested++;
+				// two sided items aren't in the scene's BVH
+				bool inRange = item.reverseNormals ||
+					sceneBVH.MaskHasObject(&lightObjects[entry * sceneBVH.ObjectWords()], i);
+				if (inRange && SphereIntersectsAABB(lightPos, cullRadius, item.boundsMin, item.boundsMax)) {
+					faceMask = CubeFaceMask(lightPos, item.boundsMin, item.boundsMax);
+				}
+				else {
+					faceMask = 0;
+				}
+
+				if (faceMask == 0) {
+					objectsCulled++;
+					continue;
+				}
+				for (int face = 0; face < 6; face++) {
+					if (!(faceMask & (1 << face)))
+						facesCulled++;
+				}
+			}
+
+			// full detail, or a single shadow proxy command
+			unsigned int first = item.firstCommand;
+			unsigned int count = item.commandCount;
+			int resolution = tierResolutions[SlotTier(shadowSlots[lights[entry]])];
+			unsigned int lod = shadowLodEnabled ? ChooseShadowLod(item, lightPos, resolution, drawCommands) : 0;
+			if (lod > 0) {
+				first = item.firstLodCommand + lod - 1;
+				count = 1;
+			}
+
+			// two sided items are always last in the draw list
+			for (unsigned int c = first; c < first + count; c++) {
+				commands.push_back(drawCommands[c]);
+				faceMasks.push_back(faceMask);
+				shadowTriangles += drawCommands[c].count / 3;
+			}
+			for (unsigned int c = item.firstCommand; c < item.firstCommand + item.commandCount; c++) {
+				shadowTrianglesFullDetail += drawCommands[c].count / 3;
+			}
+			if (item.reverseNormals)
+				draws.twoSidedCount += count;
+			else
+				draws.oneSidedCount += count;
+		}
+	}
+	shadowCommands.Upload(commands, faceMasks);
+
+	// 2. Render each light's commands with one multi draw
+	BindSceneGeometry();
+	vector<mat4> shadowTransforms;
+	int boundTier = -1;
+	for (unsigned int entry = 0; entry < lights.size(); entry++) {
+		int light = lights[entry];
+		int tier = SlotTier(shadowSlots[light]);
+		if (tier != boundTier) {
+			glBindFramebuffer(GL_FRAMEBUFFER, shadowTechnique == CUBEMAP ? tierFBOs[tier] : paraboloidFBOs[tier]);
+			glViewport(0, 0, tierResolutions[tier], tierResolutions[tier]);
+			boundTier = tier;
+		}
+		shadowDirty[light] = false;
+		if (shadowTechnique == CUBEMAP) {
+			shadowTransforms = GenerateShadowTransforms(lightPositions[light]);
+			for (unsigned int i = 0; i < 6; i++) {
+				// For each face of the cubemap...
+				shader->SetMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+			}
+		}
+		shader->SetInt("index", shadowSlots[light] - TierFirstSlot(tier));
+		shader->SetVec3("lightPos", lightPositions[light]);
+
+		const LightDrawRange& draws = lightDraws[entry];
+		glUniform1i(drawLocation, draws.first);
+		shadowCommands.Draw(draws.first, draws.oneSidedCount);
+		if (draws.twoSidedCount > 0) {
+			glDisable(GL_CULL_FACE);
+			glUniform1i(drawLocation, draws.first + draws.oneSidedCount);
+			shadowCommands.Draw(draws.first + draws.oneSidedCount, draws.twoSidedCount);
+			glEnable(GL_CULL_FACE);
+		}
+	}
+}
+
+// Returns the coarsest shadow proxy with enough triangles for the item's size
+// in the light's shadow map, 0 is the full detail mesh.
+unsigned int LightManager::ChooseShadowLod(const DrawItem& item, vec3 lightPos, int resolution,
+	const vector<DrawCommand>& drawCommands) {
+
+	if (item.lodCount == 0) {
+		return 0;
+	}
+	vec3 center = (item.boundsMin + item.boundsMax) * 0.5f;
+	float radius = glm::length(item.boundsMax - item.boundsMin) * 0.5f;
+	float distance = glm::length(center - lightPos);
+	if (distance <= radius) {
+		return 0;	// the light is inside the item's bounds
+	}
+
+	// the cube faces have a 90 degree fov, half of the face's width covers 'distance'
+	float radiusTexels = radius / distance * (resolution * 0.5f);
+	float neededTriangles = 3.14159f * radiusTexels * radiusTexels / shadowLodTexelsPerTriangle;
+
+	for (unsigned int lod = item.lodCount; lod > 0; lod--) {
+		if (drawCommands[item.firstLodCommand + lod - 1].count / 3 >= neededTriangles) {
+			return lod;
+		}
+	}
+	return 0;
+}
+
+// each tier's cubemap array is bound to the unit after the last's from GL_TEXTURE3,
+// then each tier's paraboloid array
+void LightManager::BindShadowMaps() {
+	for (int tier = 0; tier < NUM_SHADOW_TIERS; tier++) {
+		glActiveTexture(GL_TEXTURE3 + tier);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, tierCubemapArrays[tier]);
+		glActiveTexture(GL_TEXTURE3 + NUM_SHADOW_TIERS + tier);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, paraboloidArrays[tier]);
+	}
+}
+
+void LightManager::SetLightingPassUniforms(Shader* shader) {
+	shader->SetFloat("Linear", linear);
+	shader->SetFloat("Quadratic", quadratic);
+	shader->SetFloat("far_plane", far_plane);
+	shader->SetVec3("lightColor", lightColor);
+	shader->SetBool("dualParaboloid", shadowTechnique == DUAL_PARABOLOID);
+	shader->SetBool("adaptivePCF", adaptivePCF);
+	shader->SetBool("lineLights", lightsAreLines);
+	if (lightsAreLines) {
+		shader->SetFloat("totalLineLength", std::max(totalLineLength, 0.001f));
+		for (int i = 0; i < numActiveLights; i++) {
+			shader->SetVec3("lineStarts[" + std::to_string(i) + "]", lineLights[i].first);
+			shader->SetVec3("lineEnds[" + std::to_string(i) + "]", lineLights[i].second);
+		}
+	}
+
+	// Stochastic: the lights and their shadow maps are in the light tree's buffers
+	shader->SetBool("stochasticLights", UsingStochasticLights());
+	if (UsingStochasticLights()) {
+		if (lightTreeDirty) {
+			lightTree.Build(lightPositions, numActiveLights);
+			lightTreeDirty = false;
+		}
+		vector<int> shadowMaps(numActiveLights);
+		for (int i = 0; i < numActiveLights; i++) {
+			shadowMaps[i] = PackedShadowMap(i);
+		}
+		lightTree.Upload(shadowMaps);
+		lightTree.Bind();
+		shader->SetInt("numLightsActive", numActiveLights);
+		shader->SetInt("lightSamples", lightSamples);
+		shader->SetBool("temporalAccumulation", temporalAccumulation);
+		shader->SetFloat("historyWeight", historyWeight);
+		shader->SetInt("frameIndex", shadowFrame);
+		return;
+	}
+
+	// Set the light positions, and the shadow map of each light that has one
+	int numUniformLights = std::min(numActiveLights, int(MAX_POINT_LIGHTS));
+	shader->SetInt("numLightsActive", numUniformLights);
+	for (int i = 0; i < numUniformLights; i++) {
+		shader->SetVec3("lightPositions[" + std::to_string(i) + "]", lightPositions[i]);
+		shader->SetInt("shadowSlots[" + std::to_string(i) + "]", PackedShadowMap(i));
+	}
+}
+
+// The light's shadow map as the lighting pass reads it, tier * 256 + layer, -1 for none
+int LightManager::PackedShadowMap(int light) {
+	if (shadowSlots[light] < 0) {
+		return -1;
+	}
+	int tier = SlotTier(shadowSlots[light]);
+	return tier * 256 + shadowSlots[light] - TierFirstSlot(tier);
+}
+
+vector<mat4> LightManager::GenerateShadowTransforms(vec3 lightPos) {
+	// Create 6 transformation matrices, one for each face of the cube
+	vector<mat4> shadowTransforms;
+	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(1.0, 0.0, 0.0), vec3(0.0, -1.0, 0.0)));
+	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(-1.0, 0.0, 0.0), vec3(0.0, -1.0, 0.0)));
+	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0)));
+	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, -1.0)));
+	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, 0.0, 1.0), vec3(0.0, -1.0, 0.0)));
+	shadowTransforms.push_back(shadowProj * lookAt(lightPos, lightPos + vec3(0.0, 0.0, -1.0), vec3(0.0, -1.0, 0.0)));
+
+	return shadowTransforms;
+}
+
+void LightManager::UpdateShadowProjection() {
+	shadowProj = glm::perspective(glm::radians(90.0f), aspect, near_plane, far_plane);
+}
+
+bool LightManager::GetLightBoxesEnabled() {
+	return lightBoxesEnabled;
+}
+
+bool LightManager::GetLineLightsEnabled() {
+	return lineLightsEnabled;
+}
+
+int LightManager::GetMaxLineLights() {
+	return maxLineLights;
+}
+
+bool LightManager::UsingLineLights() {
+	return lightsAreLines;
+}
+
+// line lights are few enough to all be evaluated
+bool LightManager::UsingStochasticLights() {
+	return stochasticLights && !lightsAreLines;
+}
+
+bool LightManager::UsingTemporalAccumulation() {
+	return UsingStochasticLights() && temporalAccumulation;
+}
+
+float LightManager::GetLightRadius() {
+	return attenuationRadius;
+}
+
+// GUI
+void LightManager::LightingTabGUI() {
+	ImGui::Text("Attenuation");
+	ImGui::Text("Radius: %d", attenuationRadius);
+	if (ImGui::SliderInt("##choice", &attenuationChoice, 0, 11)) {
+		// Update the attenuation values
+		vec3 atten = attenuationOptions[attenuationChoice];
+		attenuationRadius = atten.x;
+		linear = atten.y;
+		quadratic = atten.z;
+	}
+
+	ImGui::Separator();
+	ImGui::Text("Light Color");
+	ImGui::ColorEdit3("##color", (float*)&lightColor);
+
+	ImGui::Separator();
+	// takes effect from the next dynamic bolt
+	ImGui::Checkbox("Line Lights", &lineLightsEnabled);
+	if (lineLightsEnabled) {
+		ImGui::Text("Max Line Lights");
+		ImGui::SliderInt("##maxLineLights", &maxLineLights, 1, MAX_LINE_LIGHTS);
+	}
+	if (lightsAreLines) {
+		ImGui::Text("Line Lights: %d, length %.1f", numActiveLights, totalLineLength);
+	}
+
+	ImGui::Separator();
+	ImGui::Checkbox("Stochastic Lights", &stochasticLights);
+	if (stochasticLights) {
+		ImGui::Text("Samples Per Pixel");
+		ImGui::SliderInt("##lightSamples", &lightSamples, 1, 16);
+		ImGui::Checkbox("Temporal Accumulation", &temporalAccumulation);
+		if (temporalAccumulation) {
+			ImGui::Text("History Weight");
+			ImGui::SliderFloat("##historyWeight", &historyWeight, 0.02f, 1.0f);
+		}
+		ImGui::Text("Light Tree: %d nodes, %d lights, built in %.3f ms", 
+			lightTree.NumNodes(), lightTree.NumLights(), lightTree.BuildTime());
+	}
+}
+// TABS
+void LightManager::ShadowsTabGUI() {
+	ImGui::Text("Far Plane: "); ImGui::SameLine();
+	ImGui::SliderFloat("##farPlane", &far_plane, 1, 200);
+
+	ImGui::Separator();
+	ImGui::Checkbox("Cull Shadow Casters", &shadowCullingEnabled);
+	if (shadowCullingEnabled) {
+		ImGui::Text("Last Strike:");
+		ImGui::Text("Objects Culled: %d / %d", objectsCulled, objectsTested);
+		ImGui::Text("Faces Culled: %d", facesCulled);
+	}
+	ImGui::Checkbox("Remove Buried Lights", &removeBuriedLights);
+	if (removeBuriedLights) {
+		ImGui::Text("Lights Buried: %d", lightsBuried);
+	}
+	ImGui::Text("Lights Active: %d / %d", numActiveLights, numSlottedLights);
+
+	ImGui::Separator();
+	static const char* techniqueNames[2] = { "Cubemap", "Dual Paraboloid" };
+	int technique = shadowTechnique;
+	ImGui::Text("Technique: "); ImGui::SameLine();
+	if (ImGui::Combo("##shadowTechnique", &technique, techniqueNames, 2)) {
+		SetShadowTechnique(technique);
+	}
+	// measured on the GPU while each technique was in use
+	ImGui::Text("Cubemap: %.3f ms per light", float(shadowMsPerLight[CUBEMAP]));
+	ImGui::Text("Dual Paraboloid: %.3f ms per light", float(shadowMsPerLight[DUAL_PARABOLOID]));
+	ImGui::Checkbox("Adaptive PCF", &adaptivePCF);
+
+	ImGui::Separator();
+	ImGui::Text("Shadow Casters: "); ImGui::SameLine();
+	if (ImGui::SliderInt("##numShadowCasters", &numShadowCasters, 0, MAX_SHADOW_CASTERS)) {
+		shadowSlotsDirty = true;
+	}
+	ImGui::Text("Casting: %d / %d lights", numCastingLights, numActiveLights);
+	float memory = 0;
+	for (int tier = 0; tier < NUM_SHADOW_TIERS; tier++) {
+		int used = std::max(0, std::min(numCastingLights - TierFirstSlot(tier), tierCapacities[tier]));
+		ImGui::Text("  %4d: %d / %d", tierResolutions[tier], used, tierCapacities[tier]);
+		memory += 6.0f * tierResolutions[tier] * tierResolutions[tier] * 4 * tierCapacities[tier];
+	}
+	ImGui::Text("Shadow Map Memory: %.0f MB", memory / (1024 * 1024));
+	ImGui::Checkbox("Amortize Shadow Updates", &shadowSchedulerEnabled);
+	if (shadowSchedulerEnabled) {
+		ImGui::Text("Lights per Frame: "); ImGui::SameLine();
+		ImGui::SliderInt("##shadowLightBudget", &shadowLightBudget, 1, 64);
+		ImGui::Text("GPU Time per Frame (ms): "); ImGui::SameLine();
+		ImGui::SliderFloat("##shadowTimeBudget", &shadowTimeBudget, 0.1f, 16.0f);
+		ImGui::Text("Age Weight: "); ImGui::SameLine();
+		ImGui::SliderFloat("##shadowAgeWeight", &shadowAgeWeight, 0.0f, 2.0f);
+	}
+	ImGui::Text("Shadow Maps Refreshed: %d", lightsRefreshed);
+	ImGui::Text("Shadow Maps Pending: %d", lightsPending);
+
+	ImGui::Separator();
+	ImGui::Checkbox("Shadow LOD", &shadowLodEnabled);
+	if (shadowLodEnabled) {
+		ImGui::Text("Texels per Triangle: "); ImGui::SameLine();
+		ImGui::SliderFloat("##texelsPerTri", &shadowLodTexelsPerTriangle, 1, 64);
+		ImGui::Text("Shadow Triangles: %d / %d", shadowTriangles, shadowTrianglesFullDetail);
+	}
+}
+void LightManager::LightsTabGUI() {
+	int numLights = GetNumLights();
+
+	ImGui::Text("Number of Lights:"); ImGui::SameLine();
+	ImGui::Text("%d", numLights);  ImGui::SameLine();
+
+	ImGui::PushButtonRepeat(true);
+	if (ImGui::ArrowButton("##numLightsL", ImGuiDir_Up))
+		numLights++; SetNumLights(numLights); ImGui::SameLine();
+	if (ImGui::ArrowButton("##numLightsR", ImGuiDir_Down))
+		numLights--; SetNumLights(numLights);
+
+	ImGui::Separator();
+	if (ImGui::Button("Show Light Positions")) {
+		lightBoxesEnabled = !lightBoxesEnabled;
+	}
+}
+void LightManager::LightingGUI() {
+	const ImVec2 startPos = ImVec2(575, 426);
+	ImGui::SetNextWindowPos(startPos, ImGuiCond_Once);
+	ImGui::Begin("Lighting", NULL, ImGuiWindowFlags_AlwaysAutoResize);
+
+	if (ImGui::BeginTabBar("Lighting")) {
+		if (ImGui::BeginTabItem("Lighting")) {
+			LightingTabGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Shadows")) {
+			ShadowsTabGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Lights")) {
+			LightsTabGUI();
+			ImGui::EndTabItem();
+		}
+		ImGui::EndTabBar();
+	}
+
+	ImGui::End();
 }
\ No newline at end of file
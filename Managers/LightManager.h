@@ -4,6 +4,8 @@
 #include <glm/glm/gtc/matrix_transform.hpp>
 #include <glad/glad.h>
 #include <vector>
+#include <algorithm>
+#include <numeric>
 #include <imgui/imgui.h>
 
 #include "../Shader/Shader.h"
@@ -11,44 +13,118 @@
 #include "../Renderer.h"
 #include "../BoltGeneration/LightningPatterns.h"
 #include "../BoltGeneration/BoltSetup.h"
+#include "../Scene/Culling.h"
+#include "../Scene/LightBVH.h"
+#include "../Timer.h"
 
 using std::vector;
 using glm::vec3;
 using glm::mat4;
+using std::pair;
+
+// number of shadow map resolution tiers, should be equal to NUM_SHADOW_TIERS in lighting_pass.frag
+const int NUM_SHADOW_TIERS = 4;
 
 class LightManager {
 
 public:
 	LightManager();
-	void Init(Shader* _depthShader);
+	void Init(Shader* _depthShader, Shader* _paraboloidShader);
 	void SetLightPositions(vector<vec3>* _lightPositions);
 	void SetLightPositions(vec3* _lightPositions);
-	void RenderDepthMaps();
-	void BindCubeMapArray();
+	void UpdateLightPositions(vector<vec3>* _lightPositions, const vector<int>& movedLights);
+	void SetLineLights(const vector<pair<vec3, vec3>>& lines);
+	void UpdateLineLights(const vector<pair<vec3, vec3>>& lines);
+	void ActivateLights(int count);
+	void ClearDepthMaps();
+	void RenderDirtyDepthMaps(const mat4& viewProjection, vec3 viewPos);
+	void MarkShadowsDirty();
+	void SetShadowTechnique(int technique);
+	void BindShadowMaps();
 	void SetLightingPassUniforms(Shader* shader);
 	void LightingGUI();
 
 	bool GetLightBoxesEnabled();
+	bool GetLineLightsEnabled();
+	int GetMaxLineLights();
+	// the current lights are line lights, the option only changes the next bolt's
+	bool UsingLineLights();
+	bool UsingStochasticLights();
+	// the lighting pass blends with the last frame's, and needs this frame's kept
+	bool UsingTemporalAccumulation();
+	// distance at which a light's attenuation is negligible
+	float GetLightRadius();
 
 private:
 	// Variables ---------
-	unsigned int depthCubemapArrayFBO;
-	unsigned int depthCubemapArray;
+	unsigned int tierFBOs[NUM_SHADOW_TIERS];
+	unsigned int tierCubemapArrays[NUM_SHADOW_TIERS];
+	unsigned int paraboloidFBOs[NUM_SHADOW_TIERS];
+	unsigned int paraboloidArrays[NUM_SHADOW_TIERS];
 	Shader* depthShader;
+	Shader* paraboloidShader;
+	int firstDrawLocation;
+	int paraboloidFirstDrawLocation;
 	mat4 shadowProj;
 
 	vector<vec3> lightPositions;
 	int numLights = 50;	// controls the (max) number of lights
 	int numActiveLights;
+	int numSlottedLights = 0;	// lights with a slot, active or not
+	// slot of each light passed to SetLightPositions, -1 if it was removed
+	vector<int> lightSlots;
+	// slots whose shadow maps are out of date
+	vector<bool> shadowDirty;
+	int lightsRefreshed = 0;
 
 	// Constants
-	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	const float aspect = (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT;
+	const float aspect = 1.0f;	// cubemap faces are square
+
+	// Shadow Technique
+	// each light's shadow map is either a cubemap (6 faces) or two paraboloid maps, 
+	// one per hemisphere, which rasterises each triangle 2 times instead of 6
+	enum ShadowTechnique { CUBEMAP, DUAL_PARABOLOID };
+	ShadowTechnique shadowTechnique = CUBEMAP;
+	// a 4 sample probe first, all 20 PCF samples only where it finds a penumbra
+	bool adaptivePCF = true;
+
+	// Shadow Tiers
+	// each tier is a depth cubemap array at one resolution, the most important 
+	// lights get the highest resolution. The capacities add up to MAX_SHADOW_CASTERS.
+	const int tierResolutions[NUM_SHADOW_TIERS] = { 1024, 512, 256, 128 };
+	const int tierCapacities[NUM_SHADOW_TIERS] = { 8, 16, 24, 16 };
 
-	// MAX_POINT_LIGHTS is used to set the size of the depth cubemap array texture, 
-	// should be equal to MAX_NUM_LIGHTS in lighting_pass.frag, which sets the size 
-	// of the array of light positions.
+	// MAX_POINT_LIGHTS should be equal to MAX_NUM_LIGHTS in lighting_pass.frag, 
+	// which sets the size of the array of light positions.
 	const unsigned int MAX_POINT_LIGHTS = 300;
+	// with stochastic lights the positions are read from the light tree instead, 
+	// so there can be up to MAX_STOCHASTIC_LIGHTS
+	const unsigned int MAX_STOCHASTIC_LIGHTS = 8192;
+	// MAX_SHADOW_CASTERS is the number of cubemaps in all the shadow tiers
+	const int MAX_SHADOW_CASTERS = 64;
+
+	// Line Lights
+	// a dynamic bolt can be lit by a few line lights along its branches instead of 
+	// many point lights, shaded analytically along their length. Their midpoints 
+	// are used as the light positions for shadows and importance.
+	bool lineLightsEnabled = false;
+	int maxLineLights = 32;
+	bool lightsAreLines = false;		// the current lights were set by SetLineLights
+	vector<pair<vec3, vec3>> lineLights;	// in slot order, like lightPositions
+	float totalLineLength = 0;
+	// MAX_LINE_LIGHTS should be equal to MAX_LINE_LIGHTS in lighting_pass.frag
+	const int MAX_LINE_LIGHTS = 64;
+
+	// Stochastic Lights
+	// each pixel samples lightSamples lights from a light BVH, picked in proportion to 
+	// their estimated contribution, so its cost doesn't depend on the number of lights.
+	// The noise is resolved by blending with the last frames' reprojected lighting.
+	bool stochasticLights = false;
+	int lightSamples = 4;
+	bool temporalAccumulation = true;
+	float historyWeight = 0.1f;			// weight of the new frame
+	LightBVH lightTree;
+	bool lightTreeDirty = true;
 
 	// Specific options for light attenuation
 	const vec3 attenuationOptions[12] = {
@@ -75,12 +151,76 @@ private:
 	// Debuging
 	bool lightBoxesEnabled = false;
 
+	// Shadow Culling
+	// objects are culled per light against the light's radius (their bounds, 
+	// then their triangles) and the 6 faces of its cubemap, counted over the last strike.
+	bool shadowCullingEnabled = true;
+	int objectsTested = 0;
+	int objectsCulled = 0;
+	int facesCulled = 0;
+	// lights inside the scene's geometry, tested against the scene's BVH
+	bool removeBuriedLights = true;
+	int lightsBuried = 0;
+
+	// Shadow Casters
+	// only the numShadowCasters most important lights get a shadow map (a shadow 
+	// slot), the rest light the scene unshadowed
+	int numShadowCasters = 16;
+	int numCastingLights = 0;
+	vector<int> shadowSlots;			// each light's shadow slot, -1 for none
+	vector<int> shadowSlotLights;		// each shadow slot's light, -1 for none
+	bool shadowSlotsDirty = true;		// the lights changed since they were ranked
+
+	// Shadow Scheduler
+	// dirty shadow maps are refreshed in priority order (screen coverage, intensity and 
+	// frames out of date) until the frame's light or GPU time budget is spent
+	bool shadowSchedulerEnabled = true;
+	int shadowLightBudget = 24;
+	float shadowTimeBudget = 2.0f;		// ms
+	float shadowAgeWeight = 0.25f;		// priority gained per frame out of date
+	vector<int> shadowLastRefresh;		// frame each slot was last refreshed
+	int shadowFrame = 0;
+	GpuTimer shadowTimer;
+	int timedLights = 0;
+	int timedTechnique = 0;
+	double shadowMsPerLight[2] = { 0.1, 0.1 };	// measured, for each technique
+	int lightsPending = 0;
+
+	// Shadow LOD
+	// items with shadow proxies use the coarsest proxy that still has about one 
+	// triangle per shadowLodTexelsPerTriangle texels of the item's size in the shadow map
+	bool shadowLodEnabled = true;
+	float shadowLodTexelsPerTriangle = 8.0f;
+	int shadowTriangles = 0;
+	int shadowTrianglesFullDetail = 0;
+
+	// Shadow Draws
+	// each light's range in the shadow command list
+	struct LightDrawRange {
+		unsigned int first;
+		unsigned int oneSidedCount;
+		unsigned int twoSidedCount;
+	};
+	vector<LightDrawRange> lightDraws;
+	DrawCommandList shadowCommands;
+
 	// Functions ---------
 	void SetupFBOandTexture();
+	void AssignLightSlots();
+	void UpdateTotalLineLength();
+	int PackedShadowMap(int light);
+	void RenderShadowMaps(vector<int> lights);
+	int TierFirstSlot(int tier);
+	int SlotTier(int shadowSlot);
+	void AssignShadowSlots(const mat4& viewProjection, vec3 viewPos);
+	void ClearShadowSlot(int shadowSlot);
+	float LightImportance(int light, const mat4& viewProjection, vec3 viewPos);
+	float ShadowPriority(int light, const mat4& viewProjection, vec3 viewPos);
 	vector<mat4> GenerateShadowTransforms(vec3 lightPos);
 	void UpdateShadowProjection();
+	unsigned int ChooseShadowLod(const DrawItem& item, vec3 lightPos, int resolution, const vector<DrawCommand>& drawCommands);
 	// GUIs
 	void LightingTabGUI();
 	void ShadowsTabGUI();
 	void LightsTabGUI();
-};
\ No newline at end of file
+};
\ No newline at end of file
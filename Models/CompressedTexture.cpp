@@ -0,0 +1,363 @@
+#include "CompressedTexture.h"
+
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <cstring>
+#include <cfloat>
+
+using glm::vec3;
+
+// CompressedTexture ---------
+GLenum CompressedTexture::InternalFormat() const {
+	return format == BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+int CompressedTexture::LevelWidth(int level) const {
+	return glm::max(width >> level, 1);
+}
+
+int CompressedTexture::LevelHeight(int level) const {
+	return glm::max(height >> level, 1);
+}
+
+// levels smaller than a block still take a whole block
+size_t CompressedTexture::LevelSize(int level) const {
+	size_t blocks = size_t((LevelWidth(level) + 3) / 4) * size_t((LevelHeight(level) + 3) / 4);
+	return blocks * (format == BC1 ? 8 : 16);
+}
+// ---------------------------
+
+// Resamples an RGBA8 image to size x size with bilinear filtering
+vector<unsigned char> ResampleRGBA(const unsigned char* src, int width, int height, int size) {
+	vector<unsigned char> dst(size * size * 4);
+
+	for (int y = 0; y < size; y++) {
+		float sy = glm::clamp((y + 0.5f) * height / size - 0.5f, 0.0f, float(height - 1));
+		int y0 = int(sy);
+		int y1 = glm::min(y0 + 1, height - 1);
+		float fy = sy - y0;
+
+		for (int x = 0; x < size; x++) {
+			float sx = glm::clamp((x + 0.5f) * width / size - 0.5f, 0.0f, float(width - 1));
+			int x0 = int(sx);
+			int x1 = glm::min(x0 + 1, width - 1);
+			float fx = sx - x0;
+
+			for (int c = 0; c < 4; c++) {
+				float top = glm::mix(float(src[(y0 * width + x0) * 4 + c]), float(src[(y0 * width + x1) * 4 + c]), fx);
+				float bottom = glm::mix(float(src[(y1 * width + x0) * 4 + c]), float(src[(y1 * width + x1) * 4 + c]), fx);
+				dst[(y * size + x) * 4 + c] = (unsigned char)(glm::mix(top, bottom, fy) + 0.5f);
+			}
+		}
+	}
+	return dst;
+}
+
+
+// Halves the image with a 2x2 box filter, odd edges are clamped
+vector<unsigned char> DownsampleRGBA(const vector<unsigned char>& src, int width, int height) {
+	int newWidth = glm::max(width / 2, 1);
+	int newHeight = glm::max(height / 2, 1);
+	vector<unsigned char> dst(newWidth * newHeight * 4);
+
+	for (int y = 0; y < newHeight; y++) {
+		int y0 = glm::min(y * 2, height - 1);
+		int y1 = glm::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < newWidth; x++) {
+			int x0 = glm::min(x * 2, width - 1);
+			int x1 = glm::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; c++) {
+				int sum = src[(y0 * width + x0) * 4 + c] + src[(y0 * width + x1) * 4 + c]
+					+ src[(y1 * width + x0) * 4 + c] + src[(y1 * width + x1) * 4 + c];
+				dst[(y * newWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+// Block Encoding ------------
+unsigned short Pack565(vec3 color) {
+	int r = (int(color.r) * 31 + 127) / 255;
+	int g = (int(color.g) * 63 + 127) / 255;
+	int b = (int(color.b) * 31 + 127) / 255;
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+vec3 Unpack565(unsigned short color) {
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	return vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// BC1 color block: the end points are fitted along the principal axis of the 
+// block's colors, each pixel takes the nearest of the 4 palette colors.
+void EncodeColorBlock(const unsigned char pixels[64], unsigned char* out) {
+	vec3 colors[16];
+	vec3 mean = vec3(0.0f);
+	for (int i = 0; i < 16; i++) {
+		colors[i] = vec3(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2]);
+		mean += colors[i];
+	}
+	mean /= 16.0f;
+
+	// covariance, then a few power iterations for the principal axis
+	glm::mat3 covariance(0.0f);
+	for (int i = 0; i < 16; i++) {
+		vec3 d = colors[i] - mean;
+		covariance += glm::outerProduct(d, d);
+	}
+	vec3 axis = vec3(0.577f);
+	for (int iteration = 0; iteration < 4; iteration++) {
+		vec3 next = covariance * axis;
+		float length = glm::length(next);
+		if (length < 1e-6f) {
+			break;
+		}
+		axis = next / length;
+	}
+
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+	for (int i = 0; i < 16; i++) {
+		float t = glm::dot(colors[i] - mean, axis);
+		minT = glm::min(minT, t);
+		maxT = glm::max(maxT, t);
+	}
+	unsigned short c0 = Pack565(glm::clamp(mean + axis * maxT, 0.0f, 255.0f));
+	unsigned short c1 = Pack565(glm::clamp(mean + axis * minT, 0.0f, 255.0f));
+	// c0 > c1 selects the 4 color mode
+	if (c0 < c1) {
+		std::swap(c0, c1);
+	}
+
+	unsigned int indices = 0;
+	if (c0 != c1) {
+		vec3 palette[4];
+		palette[0] = Unpack565(c0);
+		palette[1] = Unpack565(c1);
+		palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+		palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+
+		for (int i = 0; i < 16; i++) {
+			unsigned int best = 0;
+			float bestDistance = FLT_MAX;
+			for (unsigned int p = 0; p < 4; p++) {
+				vec3 d = colors[i] - palette[p];
+				float distance = glm::dot(d, d);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+	out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+	std::memcpy(out + 4, &indices, 4);
+}
+
+// BC3 alpha block: 8 interpolated alphas between the block's min and max
+void EncodeAlphaBlock(const unsigned char pixels[64], unsigned char* out) {
+	int a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; i++) {
+		a0 = glm::max(a0, int(pixels[i * 4 + 3]));
+		a1 = glm::min(a1, int(pixels[i * 4 + 3]));
+	}
+
+	unsigned long long indices = 0;
+	if (a0 != a1) {
+		int palette[8] = { a0, a1 };
+		for (int p = 2; p < 8; p++) {
+			palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7;
+		}
+		for (int i = 0; i < 16; i++) {
+			int alpha = pixels[i * 4 + 3];
+			unsigned long long best = 0;
+			int bestDistance = 256;
+			for (int p = 0; p < 8; p++) {
+				int distance = std::abs(alpha - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+
+	out[0] = (unsigned char)a0;
+	out[1] = (unsigned char)a1;
+	for (int i = 0; i < 6; i++) {
+		out[2 + i] = (unsigned char)(indices >> (i * 8));
+	}
+}
+
+// Appends the blocks of one RGBA8 level, edge blocks repeat the last row/column
+void EncodeLevel(const vector<unsigned char>& image, int width, int height, 
+	BlockFormat format, vector<unsigned char>* out) {
+
+	int blockSize = format == BC1 ? 8 : 16;
+	unsigned char pixels[64];
+	for (int by = 0; by < height; by += 4) {
+		for (int bx = 0; bx < width; bx += 4) {
+			for (int i = 0; i < 16; i++) {
+				int x = glm::min(bx + i % 4, width - 1);
+				int y = glm::min(by + i / 4, height - 1);
+				std::memcpy(&pixels[i * 4], &image[(y * width + x) * 4], 4);
+			}
+
+			size_t offset = out->size();
+			out->resize(offset + blockSize);
+			unsigned char* block = out->data() + offset;
+			if (format == BC3) {
+				EncodeAlphaBlock(pixels, block);
+				block += 8;
+			}
+			EncodeColorBlock(pixels, block);
+		}
+	}
+}
+// ---------------------------
+
+// Cache ---------------------
+// file layout: magic, version, format, width, height, levels, then the levels' blocks
+const unsigned int TEXTURE_MAGIC = 0x58544342;	// "BCTX"
+const unsigned int TEXTURE_VERSION = 1;
+const unsigned int TEXTURE_HEADER_SIZE = 6 * sizeof(unsigned int);
+
+// levels down to 1x1, floor(log2(max(width, height))) + 1
+int FullMipLevels(int width, int height) {
+	int levels = 1;
+	while ((glm::max(width, height) >> levels) > 0) {
+		levels++;
+	}
+	return levels;
+}
+
+void ComputeLevelOffsets(CompressedTexture* texture) {
+	texture->levelOffsets.clear();
+	size_t offset = 0;
+	for (int level = 0; level < texture->levels; level++) {
+		texture->levelOffsets.push_back(offset);
+		offset += texture->LevelSize(level);
+	}
+}
+
+// The cache must be the size in its name, width x height, with a valid number of
+// levels. Anything else is rejected so the image is transcoded again.
+bool ReadTextureCache(const std::string& cachePath, int width, int height, CompressedTexture* texture) {
+	// the whole file in one read
+	std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	size_t fileSize = file.tellg();
+	if (fileSize < TEXTURE_HEADER_SIZE) {
+		return false;
+	}
+	vector<unsigned char> contents(fileSize);
+	file.seekg(0);
+	file.read((char*)contents.data(), fileSize);
+	if (!file) {
+		return false;
+	}
+
+	unsigned int header[6];
+	std::memcpy(header, contents.data(), TEXTURE_HEADER_SIZE);
+	if (header[0] != TEXTURE_MAGIC || header[1] != TEXTURE_VERSION || header[2] != (unsigned int)texture->format) {
+		return false;
+	}
+	if (header[3] != (unsigned int)width || header[4] != (unsigned int)height ||
+		header[5] < 1 || header[5] > (unsigned int)FullMipLevels(width, height)) {
+		return false;
+	}
+	texture->width = width;
+	texture->height = height;
+	texture->levels = header[5];
+	ComputeLevelOffsets(texture);
+
+	size_t dataSize = texture->levelOffsets.back() + texture->LevelSize(texture->levels - 1);
+	if (fileSize != TEXTURE_HEADER_SIZE + dataSize) {
+		return false;
+	}
+	texture->data.assign(contents.begin() + TEXTURE_HEADER_SIZE, contents.end());
+	return true;
+}
+
+void WriteTextureCache(const std::string& cachePath, const CompressedTexture& texture) {
+	std::ofstream file(cachePath, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::CompressedTexture::WriteTextureCache:: could not write " << cachePath << std::endl;
+		return;
+	}
+	unsigned int header[6] = { TEXTURE_MAGIC, TEXTURE_VERSION, (unsigned int)texture.format,
+		(unsigned int)texture.width, (unsigned int)texture.height, (unsigned int)texture.levels };
+	file.write((const char*)header, TEXTURE_HEADER_SIZE);
+	file.write((const char*)texture.data.data(), texture.data.size());
+}
+// ---------------------------
+
+BlockFormat ChooseBlockFormat(const std::string& path) {
+	int width, height, components;
+	if (stbi_info(path.c_str(), &width, &height, &components) && components == 4) {
+		return BC3;
+	}
+	return BC1;
+}
+
+bool LoadCompressedTexture(const std::string& path, int size, BlockFormat format, CompressedTexture* texture) {
+	namespace fs = std::filesystem;
+	texture->format = format;
+
+	// the cache name depends on the output size, so find the image's size first
+	int width = size, height = size, components;
+	if (size == 0 && !stbi_info(path.c_str(), &width, &height, &components)) {
+		return false;
+	}
+	std::string cachePath = path + "." + std::to_string(width) + "x" + std::to_string(height)
+		+ (format == BC1 ? ".bc1" : ".bc3") + ".tex";
+
+	std::error_code error;
+	bool cacheValid = fs::exists(cachePath, error) &&
+		fs::last_write_time(cachePath, error) >= fs::last_write_time(path, error);
+	if (cacheValid && ReadTextureCache(cachePath, width, height, texture)) {
+		return true;
+	}
+
+	// transcode
+	int sourceWidth, sourceHeight, sourceComponents;
+	unsigned char* source = stbi_load(path.c_str(), &sourceWidth, &sourceHeight, &sourceComponents, 4);
+	if (!source) {
+		return false;
+	}
+	vector<unsigned char> image;
+	if (size > 0) {
+		image = ResampleRGBA(source, sourceWidth, sourceHeight, size);
+	}
+	else {
+		image.assign(source, source + sourceWidth * sourceHeight * 4);
+	}
+	stbi_image_free(source);
+
+	texture->width = width;
+	texture->height = height;
+	texture->levels = FullMipLevels(width, height);
+	texture->data.clear();
+	for (int level = 0; level < texture->levels; level++) {
+		int levelWidth = texture->LevelWidth(level);
+		int levelHeight = texture->LevelHeight(level);
+		EncodeLevel(image, levelWidth, levelHeight, format, &texture->data);
+		if (level + 1 < texture->levels) {
+			image = DownsampleRGBA(image, levelWidth, levelHeight);
+		}
+	}
+	ComputeLevelOffsets(texture);
+
+	WriteTextureCache(cachePath, *texture);
+	std::cout << "Transcoded: " << cachePath << std::endl;
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <stb_image/stb_image.h>
+#include <vector>
+#include <string>
+
+using std::vector;
+
+// Block compressed textures (BC1 / BC3) with a precomputed mip chain.
+// Source images are transcoded once and cached next to the source as 
+// "<image>.<width>x<height>.<bc1|bc3>.tex", later runs load the cache with 
+// a single read and upload the blocks as they are.
+
+// S3TC formats (EXT_texture_compression_s3tc), not in the core profile header
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum BlockFormat { BC1, BC3 };
+
+struct CompressedTexture {
+	BlockFormat format;
+	int width;
+	int height;
+	int levels;
+	vector<unsigned char> data;		// all the levels, largest first
+	vector<size_t> levelOffsets;	// offset of each level in data
+
+	GLenum InternalFormat() const;
+	int LevelWidth(int level) const;
+	int LevelHeight(int level) const;
+	size_t LevelSize(int level) const;
+};
+
+// BC3 if the image has an alpha channel, BC1 otherwise. Only reads the image header.
+BlockFormat ChooseBlockFormat(const std::string& path);
+
+// Loads the image at path as a compressed texture with a full mip chain. The image
+// is resampled to size x size, or kept at its own size if size is 0.
+// Returns false if the image can't be loaded.
+bool LoadCompressedTexture(const std::string& path, int size, BlockFormat format, CompressedTexture* texture);
+
+// Bilinear resample of an RGBA8 image to size x size
+vector<unsigned char> ResampleRGBA(const unsigned char* src, int width, int height, int size);
@@ -0,0 +1,376 @@
+#include "MeshSimplifier.h"
+
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cfloat>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+
+using glm::vec3;
+using glm::dvec3;
+
+// Symmetric 4x4 quadric, stored as the upper triangle
+struct Quadric {
+	double a[10] = {};
+
+	// quadric of the plane n.x + d = 0, scaled by weight
+	static Quadric FromPlane(dvec3 n, double d, double weight) {
+		Quadric q;
+		q.a[0] = n.x * n.x; q.a[1] = n.x * n.y; q.a[2] = n.x * n.z; q.a[3] = n.x * d;
+		q.a[4] = n.y * n.y; q.a[5] = n.y * n.z; q.a[6] = n.y * d;
+		q.a[7] = n.z * n.z; q.a[8] = n.z * d;
+		q.a[9] = d * d;
+		for (double& v : q.a) v *= weight;
+		return q;
+	}
+
+	Quadric& operator+=(const Quadric& q) {
+		for (int i = 0; i < 10; i++) a[i] += q.a[i];
+		return *this;
+	}
+
+	double Error(dvec3 p) const {
+		return a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x
+			+ a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y
+			+ a[7] * p.z * p.z + 2 * a[8] * p.z
+			+ a[9];
+	}
+
+	// position minimizing the error, false if the system is singular
+	bool Optimal(dvec3* p) const {
+		glm::dmat3 A(a[0], a[1], a[2],
+			a[1], a[4], a[5],
+			a[2], a[5], a[7]);
+		double det = glm::determinant(A);
+		if (std::abs(det) < 1e-12) {
+			return false;
+		}
+		*p = glm::inverse(A) * -dvec3(a[3], a[6], a[8]);
+		return true;
+	}
+};
+
+struct Collapse {
+	double cost;
+	unsigned int v0, v1;
+	unsigned int version0, version1;
+	vec3 target;
+
+	bool operator>(const Collapse& c) const { return cost > c.cost; }
+};
+
+struct SimplifierVertex {
+	vec3 position;
+	Quadric quadric;
+	vector<unsigned int> faces;
+	unsigned int version = 0;
+	bool removed = false;
+};
+
+struct SimplifierFace {
+	unsigned int v[3];
+	bool removed = false;
+};
+
+// Merges vertices with identical positions, returns the welded triangles
+void WeldVertices(const vector<vec3>& positions, const vector<unsigned int>& indices,
+	vector<SimplifierVertex>* vertices, vector<SimplifierFace>* faces) {
+
+	struct PositionHash {
+		size_t operator()(const vec3& p) const {
+			unsigned int bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+	std::unordered_map<vec3, unsigned int, PositionHash> welded;
+	vector<unsigned int> remap(positions.size());
+
+	for (unsigned int i = 0; i < positions.size(); i++) {
+		auto found = welded.find(positions[i]);
+		if (found == welded.end()) {
+			remap[i] = vertices->size();
+			welded[positions[i]] = vertices->size();
+			SimplifierVertex vertex;
+			vertex.position = positions[i];
+			vertices->push_back(vertex);
+		}
+		else {
+			remap[i] = found->second;
+		}
+	}
+
+	for (unsigned int i = 0; i + 2 < indices.size(); i += 3) {
+		SimplifierFace face;
+		face.v[0] = remap[indices[i]];
+		face.v[1] = remap[indices[i + 1]];
+		face.v[2] = remap[indices[i + 2]];
+		// skip triangles that were degenerate before welding
+		if (face.v[0] == face.v[1] || face.v[1] == face.v[2] || face.v[0] == face.v[2]) {
+			continue;
+		}
+		faces->push_back(face);
+	}
+}
+
+// true if moving vertex v to target flips (or degenerates) any of its faces, 
+// ignoring the faces shared with vertex other which are removed by the collapse.
+bool CollapseFlipsFaces(const vector<SimplifierVertex>& vertices, const vector<SimplifierFace>& faces,
+	unsigned int v, unsigned int other, vec3 target) {
+
+	for (unsigned int f : vertices[v].faces) {
+		const SimplifierFace& face = faces[f];
+		if (face.removed || face.v[0] == other || face.v[1] == other || face.v[2] == other) {
+			continue;
+		}
+		vec3 p[3], moved[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = vertices[face.v[k]].position;
+			moved[k] = face.v[k] == v ? target : p[k];
+		}
+		vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+		vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+		if (glm::dot(before, after) <= 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+Collapse EvaluateCollapse(const vector<SimplifierVertex>& vertices, unsigned int v0, unsigned int v1) {
+	Quadric q = vertices[v0].quadric;
+	q += vertices[v1].quadric;
+
+	Collapse collapse;
+	collapse.v0 = v0;
+	collapse.v1 = v1;
+	collapse.version0 = vertices[v0].version;
+	collapse.version1 = vertices[v1].version;
+
+	dvec3 optimal;
+	if (q.Optimal(&optimal)) {
+		collapse.target = vec3(optimal);
+		collapse.cost = q.Error(optimal);
+	}
+	else {
+		// fall back to the best of the end points and the mid point
+		vec3 candidates[3] = { vertices[v0].position, vertices[v1].position,
+			(vertices[v0].position + vertices[v1].position) * 0.5f };
+		collapse.cost = DBL_MAX;
+		for (vec3 candidate : candidates) {
+			double error = q.Error(dvec3(candidate));
+			if (error < collapse.cost) {
+				collapse.cost = error;
+				collapse.target = candidate;
+			}
+		}
+	}
+	return collapse;
+}
+
+void SimplifyMesh(const vector<vec3>& positions, const vector<unsigned int>& indices,
+	unsigned int targetTriangles, vector<vec3>* outPositions, vector<unsigned int>* outIndices) {
+
+	vector<SimplifierVertex> vertices;
+	vector<SimplifierFace> faces;
+	WeldVertices(positions, indices, &vertices, &faces);
+
+	// 1. Face adjacency and quadrics
+	std::unordered_map<unsigned long long, int> edgeFaceCount;
+	auto EdgeKey = [](unsigned int a, unsigned int b) {
+		if (a > b) std::swap(a, b);
+		return (unsigned long long)a << 32 | b;
+	};
+
+	for (unsigned int f = 0; f < faces.size(); f++) {
+		const SimplifierFace& face = faces[f];
+		dvec3 p0 = vertices[face.v[0]].position;
+		dvec3 p1 = vertices[face.v[1]].position;
+		dvec3 p2 = vertices[face.v[2]].position;
+		dvec3 n = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(n);
+		if (area > 0) {
+			n /= area;
+		}
+		// area weighted plane quadric
+		Quadric q = Quadric::FromPlane(n, -glm::dot(n, p0), area * 0.5);
+
+		for (int k = 0; k < 3; k++) {
+			vertices[face.v[k]].faces.push_back(f);
+			vertices[face.v[k]].quadric += q;
+			edgeFaceCount[EdgeKey(face.v[k], face.v[(k + 1) % 3])]++;
+		}
+	}
+
+	// open boundary edges get a perpendicular plane, so the outline is preserved
+	const double boundaryWeight = 1000.0;
+	for (const SimplifierFace& face : faces) {
+		for (int k = 0; k < 3; k++) {
+			unsigned int a = face.v[k];
+			unsigned int b = face.v[(k + 1) % 3];
+			if (edgeFaceCount[EdgeKey(a, b)] != 1) {
+				continue;
+			}
+			dvec3 pa = vertices[a].position;
+			dvec3 pb = vertices[b].position;
+			dvec3 faceNormal = glm::cross(pb - pa, dvec3(vertices[face.v[(k + 2) % 3]].position) - pa);
+			dvec3 n = glm::cross(pb - pa, faceNormal);
+			double length = glm::length(n);
+			if (length == 0) {
+				continue;
+			}
+			n /= length;
+			Quadric q = Quadric::FromPlane(n, -glm::dot(n, pa), boundaryWeight);
+			vertices[a].quadric += q;
+			vertices[b].quadric += q;
+		}
+	}
+
+	// 2. Initial collapse candidates, one per edge
+	std::priority_queue<Collapse, vector<Collapse>, std::greater<Collapse>> heap;
+	for (const auto& edge : edgeFaceCount) {
+		unsigned int a = (unsigned int)(edge.first >> 32);
+		unsigned int b = (unsigned int)(edge.first & 0xFFFFFFFF);
+		heap.push(EvaluateCollapse(vertices, a, b));
+	}
+
+	// 3. Collapse the cheapest edges until the target is reached
+	unsigned int liveFaces = faces.size();
+	vector<unsigned int> neighbours;
+	while (liveFaces > targetTriangles && !heap.empty()) {
+		Collapse collapse = heap.top();
+		heap.pop();
+
+		SimplifierVertex& v0 = vertices[collapse.v0];
+		SimplifierVertex& v1 = vertices[collapse.v1];
+		// skip stale entries
+		if (v0.removed || v1.removed || v0.version != collapse.version0 || v1.version != collapse.version1) {
+			continue;
+		}
+		if (CollapseFlipsFaces(vertices, faces, collapse.v0, collapse.v1, collapse.target) ||
+			CollapseFlipsFaces(vertices, faces, collapse.v1, collapse.v0, collapse.target)) {
+			continue;
+		}
+
+		// merge v1 into v0
+		v0.position = collapse.target;
+		v0.quadric += v1.quadric;
+		v0.version++;
+		v1.removed = true;
+
+		for (unsigned int f : v1.faces) {
+			SimplifierFace& face = faces[f];
+			if (face.removed) {
+				continue;
+			}
+			bool shared = face.v[0] == collapse.v0 || face.v[1] == collapse.v0 || face.v[2] == collapse.v0;
+			if (shared) {
+				face.removed = true;
+				liveFaces--;
+			}
+			else {
+				for (int k = 0; k < 3; k++) {
+					if (face.v[k] == collapse.v1) face.v[k] = collapse.v0;
+				}
+				v0.faces.push_back(f);
+			}
+		}
+		v1.faces.clear();
+
+		// drop removed faces from v0 and re-evaluate its edges
+		v0.faces.erase(std::remove_if(v0.faces.begin(), v0.faces.end(),
+			[&faces](unsigned int f) { return faces[f].removed; }), v0.faces.end());
+
+		neighbours.clear();
+		for (unsigned int f : v0.faces) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int n = faces[f].v[k];
+				if (n != collapse.v0) neighbours.push_back(n);
+			}
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		for (unsigned int n : neighbours) {
+			heap.push(EvaluateCollapse(vertices, collapse.v0, n));
+		}
+	}
+
+	// 4. Compact the remaining vertices and faces
+	outPositions->clear();
+	outIndices->clear();
+	vector<int> remap(vertices.size(), -1);
+	for (const SimplifierFace& face : faces) {
+		if (face.removed) {
+			continue;
+		}
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = face.v[k];
+			if (remap[v] < 0) {
+				remap[v] = outPositions->size();
+				outPositions->push_back(vertices[v].position);
+			}
+			outIndices->push_back(remap[v]);
+		}
+	}
+}
+
+// Shadow Proxy Cache --------
+// file layout: magic, version, source triangle count, vertex count, index count,
+// then the positions and indices.
+const unsigned int PROXY_MAGIC = 0x444F4C53;	// "SLOD"
+const unsigned int PROXY_VERSION = 1;
+
+bool ReadProxyCache(const std::string& cachePath, unsigned int sourceTriangles, ShadowProxy* proxy) {
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	unsigned int header[5];
+	file.read((char*)header, sizeof(header));
+	if (!file || header[0] != PROXY_MAGIC || header[1] != PROXY_VERSION || header[2] != sourceTriangles) {
+		return false;
+	}
+	proxy->positions.resize(header[3]);
+	proxy->indices.resize(header[4]);
+	file.read((char*)proxy->positions.data(), proxy->positions.size() * sizeof(glm::vec3));
+	file.read((char*)proxy->indices.data(), proxy->indices.size() * sizeof(unsigned int));
+	return bool(file);
+}
+
+void WriteProxyCache(const std::string& cachePath, unsigned int sourceTriangles, const ShadowProxy& proxy) {
+	std::ofstream file(cachePath, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::MeshSimplifier::WriteProxyCache:: could not write " << cachePath << std::endl;
+		return;
+	}
+	unsigned int header[5] = { PROXY_MAGIC, PROXY_VERSION, sourceTriangles,
+		(unsigned int)proxy.positions.size(), (unsigned int)proxy.indices.size() };
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)proxy.positions.data(), proxy.positions.size() * sizeof(glm::vec3));
+	file.write((const char*)proxy.indices.data(), proxy.indices.size() * sizeof(unsigned int));
+}
+
+void LoadShadowProxy(const std::string& assetPath, const vector<vec3>& positions,
+	const vector<unsigned int>& indices, unsigned int triangleBudget, ShadowProxy* proxy) {
+
+	namespace fs = std::filesystem;
+	proxy->triangleBudget = triangleBudget;
+	std::string cachePath = assetPath + ".shadow" + std::to_string(triangleBudget) + ".lod";
+	unsigned int sourceTriangles = indices.size() / 3;
+
+	std::error_code error;
+	bool cacheValid = fs::exists(cachePath, error) && 
+		fs::last_write_time(cachePath, error) >= fs::last_write_time(assetPath, error);
+	if (cacheValid && ReadProxyCache(cachePath, sourceTriangles, proxy)) {
+		return;
+	}
+
+	SimplifyMesh(positions, indices, triangleBudget, &proxy->positions, &proxy->indices);
+	WriteProxyCache(cachePath, sourceTriangles, *proxy);
+	std::cout << "Built shadow proxy: " << cachePath << " (" << sourceTriangles << " -> " 
+		<< proxy->indices.size() / 3 << " triangles)" << std::endl;
+}
+// ---------------------------
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <string>
+
+using std::vector;
+
+// Quadric error metric (Garland & Heckbert) edge collapse simplification.
+// Only positions are kept, the result is meant for shadow proxies where 
+// normals and texture coordinates aren't needed.
+
+// a simplified, position only copy of a model
+struct ShadowProxy {
+	unsigned int triangleBudget;
+	vector<glm::vec3> positions;
+	vector<unsigned int> indices;
+};
+
+// Simplifies the triangle mesh down to (at most) targetTriangles triangles.
+// Vertices with the same position are welded first, so meshes split on
+// normal/uv seams simplify as one surface.
+void SimplifyMesh(const vector<glm::vec3>& positions, const vector<unsigned int>& indices,
+	unsigned int targetTriangles, vector<glm::vec3>* outPositions, vector<unsigned int>* outIndices);
+
+// Loads the proxy from its cache file next to the source asset, 
+// "<asset>.shadow<budget>.lod". If the cache is missing or older than the asset, 
+// the proxy is simplified from the given mesh and the cache is rewritten.
+void LoadShadowProxy(const std::string& assetPath, const vector<glm::vec3>& positions,
+	const vector<unsigned int>& indices, unsigned int triangleBudget, ShadowProxy* proxy);
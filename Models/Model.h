@@ -13,9 +13,11 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <cfloat>
 #include <vector>
 
 #include "Mesh.h"
+#include "MeshSimplifier.h"
 #include "../Shader/Shader.h"
 #include "../FunctionLibrary.h"
 
@@ -23,65 +25,50 @@ class Model
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
     std::string directory;
+    std::string path;
     bool gammaCorrection;
+    // local space bounds of all the meshes
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+    glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+    // simplified copies for the shadow maps, most detailed first
+    vector<ShadowProxy> shadowProxies;
 
     // constructor, expects a filepath to a 3D model.
-    Model(std::string const& path, bool gamma = false) : gammaCorrection(gamma)
+    Model(std::string const& path, bool gamma = false) : path(path), gammaCorrection(gamma)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(const Shader& shader)
+    // builds (or loads from the cache) a shadow proxy for each triangle budget, 
+    // budgets that aren't below the model's triangle count are skipped.
+    void BuildShadowProxies(const vector<unsigned int>& triangleBudgets)
     {
-        for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
-    }
-
-private:
-    unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false)
-    {
-        std::string filename = std::string(path);
-        filename = directory + '\\' + filename;
-
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-        if (data)
+        // all meshes are merged into one, proxies are drawn with a single command
+        vector<glm::vec3> positions;
+        vector<unsigned int> indices;
+        for (const Mesh& mesh : meshes)
         {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
+            unsigned int baseVertex = positions.size();
+            for (const Vertex& vertex : mesh.vertices)
+                positions.push_back(vertex.Position);
+            for (unsigned int index : mesh.indices)
+                indices.push_back(baseVertex + index);
         }
-        else
+
+        shadowProxies.clear();
+        for (unsigned int budget : triangleBudgets)
         {
-            std::cout << "Texture failed to load at path: " << path << std::endl;
-            stbi_image_free(data);
+            if (budget >= indices.size() / 3)
+                continue;
+            ShadowProxy proxy;
+            LoadShadowProxy(path, positions, indices, budget, &proxy);
+            shadowProxies.push_back(proxy);
         }
-
-        return textureID;
     }
 
+private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(std::string const& path)
     {
@@ -137,6 +124,8 @@ private:
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
+            boundsMin = glm::min(boundsMin, vector);
+            boundsMax = glm::max(boundsMax, vector);
             // normals
             if (mesh->HasNormals())
             {
@@ -204,8 +193,7 @@ private:
         return Mesh(vertices, indices, textures);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
+    // the paths of all material textures of a given type, StaticMeshBuffer loads them into its texture array
     vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
     {
         vector<Texture> textures;
@@ -213,35 +201,11 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-
-            // check if texture was loaded before and if so, continue 
-            // to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    // a texture with the same filepath has already 
-                    // been loaded, continue to the next one.
-                    textures.push_back(textures_loaded[j]);
-                    skip = true;
-                    break;
-                }
-            }
-            if (!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                // store it as texture loaded for entire model, to ensure
-                // we won't load duplicate textures.
-                textures_loaded.push_back(texture);
-
-                std::cout << "Loaded: " << str.C_Str() << std::endl;
-            }
+            Texture texture;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
-};
\ No newline at end of file
+};
\ No newline at end of file
@@ -5,6 +5,52 @@ unsigned int cubeVAO = 0;
 unsigned int floorVAO = 0;
 unsigned int wallVAO = 0;
 
+const float cubeVertices[] = {
+	// position 		   //normal           //texture
+	// back face
+	-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+	 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+	 1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
+	 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+	-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+	-1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
+	// front face
+	-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+	 1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
+	 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+	 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+	-1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
+	-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+	// left face
+	-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+	-1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
+	-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+	-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+	-1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+	-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+	// right face
+	 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+	 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+	 1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
+	 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+	 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+	 1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
+	 // bottom face
+	 -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+	  1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
+	  1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+	  1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+	 -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+	 -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+	 // top face
+	 -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+	  1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+	  1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
+	  1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+	 -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+	 -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
+};
+
 // Random Boxes
 vec3 boxPositions[10];
 bool boxPositionsSet = false;
@@ -14,6 +60,10 @@ const int range = 15;
 // Models & Textures
 std::vector<Model> models;
 vec3 defaultDiffuseColor = vec3(1.0f, 0.0f, 1.0f); // Purple
+// Shadow Proxies
+// triangle budgets of the simplified models, most detailed first
+const std::vector<unsigned int> shadowLodBudgets = { 20000, 5000, 1250 };
+std::vector<int> shadowLodMeshes[2];	// proxy mesh handles for each SceneMesh
 
 // Debugging
 bool toggleDiffuse = true;
@@ -22,16 +72,37 @@ bool toggleNormal = false;
 
 // Scenes
 int scene = 1;
-void RenderScene1(Shader shader);
-
-// Extras Render Functions
-void RenderRoomCube(Shader shader, float scale, vec3 pos);
-void RenderRandomBoxes(Shader shader);
-void RenderAlcove(Shader shader);
-void RenderPlane(Shader shader);
-void RenderSlab(Shader shader, mat4 model);
-void RenderArch(Shader shader, mat4 model);
-void RenderTower(Shader shader);
+void BuildScene1();
+
+// Draw List
+std::vector<DrawItem> drawList;
+std::vector<DrawCommand> drawCommands;	// one per mesh of each item, in draw list order, then the shadow proxies
+unsigned int numOneSidedCommands = 0;
+unsigned int numSceneCommands = 0;
+unsigned int drawDataSSBO = 0;
+unsigned int meshDrawSSBO = 0;
+StaticMeshBuffer meshBuffer;
+DrawCommandList sceneCommands;
+void BuildDrawCommands();
+void UploadDrawList();
+// Scene Collision
+TriangleBVH sceneBVH;
+SceneSDF sceneSDF;
+const float SDF_CELL_SIZE = 1.0f;
+const float SDF_MAX_DISTANCE = 8.0f;	// only needs to cover the bolt's attraction radius
+void BuildSceneCollision();
+void AddDrawItem(SceneMesh mesh, mat4 model, vec3 color, bool textured = false,
+	bool reverseNormals = false);
+void SetupCube();
+
+// Extras Scene Builders
+void AddRoomCube(float scale, vec3 pos);
+void AddRandomBoxes();
+void AddAlcove();
+void AddPlane();
+void AddSlab(mat4 model);
+void AddArch(mat4 model);
+void AddTower();
 
 void LoadModels() {
 	// flip loaded texture's on y-axis
@@ -39,17 +110,64 @@ void LoadModels() {
 
 	Model waterTower(ProjectBasePath() + "\\Models\\waterTower\\Water Tower Scanline.obj");
 	models.push_back(waterTower);
+
+	// pack the static meshes into the shared buffers, in SceneMesh order
+	vector<PackedVertex> cubeMesh;
+	vector<unsigned int> cubeIndices;
+	for (unsigned int i = 0; i < 36; i++) {
+		const float* v = &cubeVertices[i * 8];
+		cubeMesh.push_back({ vec3(v[0], v[1], v[2]), vec3(v[3], v[4], v[5]), glm::vec2(v[6], v[7]) });
+		cubeIndices.push_back(i);
+	}
+	meshBuffer.AddMesh(cubeMesh, cubeIndices);	// CUBE_MESH
+	meshBuffer.AddModel(models[0]);				// TOWER_MESH
+
+	models[0].BuildShadowProxies(shadowLodBudgets);
+	for (const ShadowProxy& proxy : models[0].shadowProxies) {
+		shadowLodMeshes[TOWER_MESH].push_back(meshBuffer.AddShadowProxy(proxy));
+	}
+	meshBuffer.Upload();
+
+	BuildScene();
 }
 
-// Only Sets the model matrix, other matrices should already be set
+// Only the view and projection matrices need to be set, model matrices
+// are read from the draw data SSBO.
+// The whole scene is submitted with one glMultiDrawElementsIndirect, plus one
+// for the two sided items.
 void RenderScene(const Shader& shader) {
+	BindSceneGeometry();
+	shader.SetBool("useDiffuse", toggleDiffuse);
+	shader.SetBool("useSpecular", toggleSpecular);
+	shader.SetBool("useNormal", toggleNormal);
 
-	switch (scene) {
-	case 0:
-		break;
-	case 1:
-		RenderScene1(shader);
-	}
+	sceneCommands.Draw(0, numOneSidedCommands);
+	glDisable(GL_CULL_FACE);
+	sceneCommands.Draw(numOneSidedCommands, numSceneCommands - numOneSidedCommands);
+	glEnable(GL_CULL_FACE);
+}
+
+// Binds the shared mesh buffer, material textures and the per draw SSBOs
+void BindSceneGeometry() {
+	meshBuffer.Bind(MATERIAL_TEXTURE_UNIT);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_DRAW_BINDING, meshDrawSSBO);
+}
+
+const std::vector<DrawItem>& GetDrawList() {
+	return drawList;
+}
+
+const std::vector<DrawCommand>& GetDrawCommands() {
+	return drawCommands;
+}
+
+const TriangleBVH& GetSceneBVH() {
+	return sceneBVH;
+}
+
+const SceneSDF& GetSceneSDF() {
+	return sceneSDF;
 }
 // GUI ----------
 void RenderGUI() {
@@ -65,151 +183,295 @@ void RenderGUI() {
 }
 // --------------
 
-// Set Uniforms -
-void SetModelUniforms(Shader shader) {
-	shader.SetBool("useDiffuse", toggleDiffuse);
-	shader.SetBool("useSpecular", toggleSpecular);
-	shader.SetBool("useNormal", toggleNormal);
+// Draw List ----
+void AddDrawItem(SceneMesh mesh, mat4 model, vec3 color, bool textured, 
+	bool reverseNormals) {
+
+	DrawItem item;
+	item.mesh = mesh;
+	item.model = model;
+	item.color = color;
+	item.textured = textured;
+	item.reverseNormals = reverseNormals;
+
+	// local space bounds of the mesh
+	vec3 localMin = vec3(-1);
+	vec3 localMax = vec3(1);
+	if (mesh == TOWER_MESH) {
+		localMin = models[0].boundsMin;
+		localMax = models[0].boundsMax;
+	}
+
+	// transform the 8 corners to get the world space AABB
+	item.boundsMin = vec3(FLT_MAX);
+	item.boundsMax = vec3(-FLT_MAX);
+	for (int corner = 0; corner < 8; corner++) {
+		vec3 local = vec3(corner & 1 ? localMax.x : localMin.x,
+			corner & 2 ? localMax.y : localMin.y,
+			corner & 4 ? localMax.z : localMin.z);
+		vec3 world = vec3(model * vec4(local, 1.0f));
+		item.boundsMin = glm::min(item.boundsMin, world);
+		item.boundsMax = glm::max(item.boundsMax, world);
+	}
+
+	drawList.push_back(item);
+}
+
+// Creates an indirect draw command for each mesh range of each item
+void BuildDrawCommands() {
+	drawCommands.clear();
+	numOneSidedCommands = 0;
+
+	for (unsigned int i = 0; i < drawList.size(); i++) {
+		DrawItem& item = drawList[i];
+		item.firstCommand = drawCommands.size();
+
+		for (const MeshRange& range : meshBuffer.GetRanges(item.mesh)) {
+			DrawCommand command;
+			command.count = range.indexCount;
+			command.instanceCount = 1;
+			command.firstIndex = range.firstIndex;
+			command.baseVertex = range.baseVertex;
+			// the base instance indexes the mesh draw data
+			command.baseInstance = drawCommands.size();
+			drawCommands.push_back(command);
+		}
+
+		item.commandCount = drawCommands.size() - item.firstCommand;
+		if (!item.reverseNormals) {
+			numOneSidedCommands += item.commandCount;
+		}
+	}
+	numSceneCommands = drawCommands.size();
+
+	// shadow proxies
+	for (DrawItem& item : drawList) {
+		item.firstLodCommand = drawCommands.size();
+		item.lodCount = shadowLodMeshes[item.mesh].size();
+
+		for (int lodMesh : shadowLodMeshes[item.mesh]) {
+			const MeshRange& range = meshBuffer.GetRanges(lodMesh)[0];
+			DrawCommand command;
+			command.count = range.indexCount;
+			command.instanceCount = 1;
+			command.firstIndex = range.firstIndex;
+			command.baseVertex = range.baseVertex;
+			command.baseInstance = drawCommands.size();
+			drawCommands.push_back(command);
+		}
+	}
 }
-void DefaultModelUniforms(Shader shader) {
-	shader.SetBool("useDiffuse", false);
-	shader.SetBool("useSpecular", false);
-	shader.SetBool("useNormal", false);
+
+void UploadDrawList() {
+	vector<DrawData> drawData(drawList.size());
+	for (unsigned int i = 0; i < drawList.size(); i++) {
+		drawData[i].model = drawList[i].model;
+		drawData[i].normalMatrix = mat4(glm::transpose(glm::inverse(glm::mat3(drawList[i].model))));
+		drawData[i].color = vec4(drawList[i].color, 1.0f);
+		drawData[i].flags = ivec4(drawList[i].textured, drawList[i].reverseNormals, 0, 0);
+	}
+
+	vector<MeshDrawData> meshDrawData;
+	for (unsigned int i = 0; i < drawList.size(); i++) {
+		const vector<MeshRange>& ranges = meshBuffer.GetRanges(drawList[i].mesh);
+		for (const MeshRange& range : ranges) {
+			meshDrawData.push_back({ int(i), range.diffuseLayer, range.specularLayer, range.normalLayer });
+		}
+	}
+	// shadow proxies have no materials
+	for (unsigned int i = 0; i < drawList.size(); i++) {
+		for (unsigned int lod = 0; lod < drawList[i].lodCount; lod++) {
+			meshDrawData.push_back({ int(i), -1, -1, -1 });
+		}
+	}
+
+	if (drawDataSSBO == 0) {
+		glGenBuffers(1, &drawDataSSBO);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size() * sizeof(DrawData), 
+		drawData.data(), GL_STATIC_DRAW);
+	if (meshDrawSSBO == 0) {
+		glGenBuffers(1, &meshDrawSSBO);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshDrawSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, meshDrawData.size() * sizeof(MeshDrawData),
+		meshDrawData.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the scene's commands have no parameters
+	sceneCommands.Upload(drawCommands, vector<int>(drawCommands.size(), 0));
 }
 // --------------
 
 // Scenes -------
 void SetScene(int _scene) {
 	scene = _scene;
+	BuildScene();
+}
+
+// Builds the draw list of the current scene
+void BuildScene() {
+	drawList.clear();
+
+	switch (scene) {
+	case 0:
+		break;
+	case 1:
+		BuildScene1();
+	}
+
+	// two sided items are drawn last, in their own batch with face culling disabled
+	std::stable_partition(drawList.begin(), drawList.end(), 
+		[](const DrawItem& item) { return !item.reverseNormals; });
+
+	BuildDrawCommands();
+	UploadDrawList();
+	BuildSceneCollision();
 }
-void RenderScene1(Shader shader) {
+
+// World space triangles of the one sided items (two sided items are rooms,
+// which would put everything inside) into the BVH, each triangle's object is 
+// its item's index in the draw list. Then bakes the SDF from it.
+void BuildSceneCollision() {
+	const vector<PackedVertex>& vertices = meshBuffer.GetVertices();
+	const vector<unsigned int>& indices = meshBuffer.GetIndices();
+
+	vector<vec3> triangles;
+	vector<int> objects;
+	for (unsigned int i = 0; i < drawList.size(); i++) {
+		const DrawItem& item = drawList[i];
+		if (item.reverseNormals) {
+			continue;
+		}
+		for (const MeshRange& range : meshBuffer.GetRanges(item.mesh)) {
+			for (unsigned int v = 0; v < range.indexCount; v++) {
+				vec3 p = vertices[range.baseVertex + indices[range.firstIndex + v]].Position;
+				triangles.push_back(vec3(item.model * vec4(p, 1.0f)));
+			}
+			objects.insert(objects.end(), range.indexCount / 3, i);
+		}
+	}
+	sceneBVH.Build(triangles, objects);
+	std::cout << "Scene BVH: " << sceneBVH.NumTriangles() << " triangles, " << sceneBVH.NumNodes()
+		<< " nodes, built in " << sceneBVH.BuildTime() << " ms" << std::endl;
+
+	int numThreads = glm::max(int(std::thread::hardware_concurrency()), 1);
+	sceneSDF.Bake(sceneBVH, SDF_CELL_SIZE, SDF_MAX_DISTANCE, numThreads);
+	std::cout << "Scene SDF: " << sceneSDF.MemoryBytes() / 1024 << " KB, baked in " << sceneSDF.BakeTime()
+		<< " ms" << std::endl;
+}
+
+void BuildScene1() {
 	// Tower, Floor, Back Wall, 2 Boxes, Arch
 
 	// Tower
-	mat4 model = mat4(1.0f);
-	model = glm::translate(model, vec3(-20, 1, 16));
-	model = glm::scale(model, vec3(1, 1, 1));
-	shader.SetMat4("model", model);
-	SetModelUniforms(shader);
-	RenderTower(shader);
-	DefaultModelUniforms(shader);
+	AddTower();
 
 	// Everything else
-	RenderPlane(shader);
+	AddPlane();
 }
 // --------------
 
 // Extras -------
-void RenderTower(Shader shader) {	
-
-	models[0].Draw(shader);
+void AddTower() {
+	mat4 model = mat4(1.0f);
+	model = glm::translate(model, vec3(-20, 1, 16));
+	model = glm::scale(model, vec3(1, 1, 1));
+	AddDrawItem(TOWER_MESH, model, vec3(0.5f), true);
 }
 
-void RenderPlane(Shader shader) {
+void AddPlane() {
 	mat4 model = mat4(1.0f);
 
 	// Floor
-	shader.SetVec3("color", vec3(0.1f));
+	vec3 color = vec3(0.1f);
 	model = glm::translate(model, vec3(0, 0, 0));
 	model = glm::scale(model, vec3(40, 1, 60));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 
 	// Back Wall
 	model = mat4(1.0f);
 	model = glm::translate(model, vec3(-30, 30, 0));
 	model = glm::scale(model, vec3(1, 80, 60));
 	//model = glm::rotate(model, glm::radians(90.0f), vec3(1, 1, 2));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 
 	// Boxes
 	model = mat4(1.0f);
 	model = glm::translate(model, vec3(3, 1.3f, -2));
 	model = glm::scale(model, vec3(0.5f));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 
 	model = glm::translate(model, vec3(0, 0, 8));
 	model = glm::scale(model, vec3(1.5f));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 
 	// Arch
-	shader.SetVec3("color", vec3(0.0f, 0.0f, 0.0f));
 	model = mat4(1.0f);
 	model = glm::scale(model, vec3(0.4f));
 	model = glm::translate(model, vec3(0, 7, -20));
-	RenderArch(shader, model);
+	AddArch(model);
 }
 
-void RenderArch(Shader shader, mat4 model) {
+void AddArch(mat4 model) {
+	vec3 color = vec3(0.0f, 0.0f, 0.0f);
 
 	model = glm::translate(model, vec3(0, 0, 5));
 	model = glm::scale(model, vec3(1, 5, 1));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 
 	model = glm::translate(model, vec3(0, 0, -10));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 
 	model = glm::translate(model, vec3(0, 0.8f, 5));
 	model = glm::scale(model, vec3(0.7f, 0.14f, 4.9f));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, color);
 }
 
-void RenderAlcove(Shader shader) {
+void AddAlcove() {
 	mat4 model = mat4(1.0f);
 
 	// Back Wall
 	model = glm::translate(model, vec3(-40, 0, 0));
-	RenderSlab(shader, model);
+	AddSlab(model);
 
 	// Right Wall
 	model = mat4(1.0f);
 	model = glm::rotate(model, glm::radians(90.0f), vec3(0, 1, 0));
 	model = glm::translate(model, vec3(40, 0, 0));
-	RenderSlab(shader, model);
+	AddSlab(model);
 
 	// Left Wall
 	model = mat4(1.0f);
 	model = glm::rotate(model, glm::radians(-90.0f), vec3(0, 1, 0));
 	model = glm::translate(model, vec3(40, 0, 0));
-	RenderSlab(shader, model);
+	AddSlab(model);
 
 	// Floor
 	model = mat4(1.0f);
 	model = glm::rotate(model, glm::radians(90.0f), vec3(0, 0, 1));
 	model = glm::translate(model, vec3(-40, 0, 0));
-	RenderSlab(shader, model);
+	AddSlab(model);
 
 	// Objects
 	model = mat4(1);
 	model = glm::translate(model, vec3(0, -25, 6));
 	model = glm::scale(model, vec3(5));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, vec3(0.5f));
 	model = glm::translate(model, vec3(2, 3, -5));
 	model = glm::scale(model, vec3(1, 4, 1));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, vec3(0.5f));
 }
 
-void RenderRoomCube(Shader shader, float scale, vec3 pos) {
+void AddRoomCube(float scale, vec3 pos) {
 	mat4 model = mat4(1.0f);
 	model = glm::translate(model, pos);
 	model = glm::scale(model, glm::vec3(scale));
-	shader.SetMat4("model", model);
-	glDisable(GL_CULL_FACE);
-	shader.SetInt("reverse_normals", 1);
-	RenderCube();
-	shader.SetInt("reverse_normals", 0);
-	glEnable(GL_CULL_FACE);
+	AddDrawItem(CUBE_MESH, model, vec3(0.5f), false, true);
 }
 
-void RenderRandomBoxes(Shader shader) {
+void AddRandomBoxes() {
 	// Shadow Testing Room
 	mat4 model;
 	if (!boxPositionsSet) { // set random box positions
@@ -227,15 +489,13 @@ void RenderRandomBoxes(Shader shader) {
 		model = mat4(1);
 		model = glm::translate(model, boxPositions[box]);
 		model = glm::scale(model, glm::vec3(3));
-		shader.SetMat4("model", model);
-		RenderCube();
+		AddDrawItem(CUBE_MESH, model, vec3(0.5f));
 	}
 }
 
-void RenderSlab(Shader shader, mat4 model) {
+void AddSlab(mat4 model) {
 	model = glm::scale(model, vec3(1, 40, 40));
-	shader.SetMat4("model", model);
-	RenderCube();
+	AddDrawItem(CUBE_MESH, model, vec3(0.5f));
 }
 // ---------------
 
@@ -268,54 +528,8 @@ void RenderQuad() {
 	glBindVertexArray(0);
 }
 
-void RenderCube() {
+void SetupCube() {
 	if (cubeVAO == 0) {
-		float cubeVertices[] = {
-			// position 		   //normal           //texture
-			// back face
-			-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-			 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-			 1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
-			 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-			-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-			-1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
-			// front face
-			-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-			 1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
-			 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-			 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-			-1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
-			-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-			// left face
-			-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-			-1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
-			-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-			-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-			-1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-			-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-			// right face
-			 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-			 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-			 1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
-			 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-			 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-			 1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
-			 // bottom face
-			 -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-			  1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
-			  1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-			  1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-			 -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-			 -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-			 // top face
-			 -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-			  1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-			  1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
-			  1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-			 -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-			 -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
-		};
-
 		unsigned int cubeVBO;
 		glGenVertexArrays(1, &cubeVAO);
 		glGenBuffers(1, &cubeVBO);
@@ -334,11 +548,13 @@ void RenderCube() {
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 		glEnableVertexAttribArray(2);
 	}
+}
 
+void RenderCube() {
+	SetupCube();
 	glBindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
 	glBindVertexArray(0);
-
 }
 
 void RenderFloor() {
@@ -419,4 +635,4 @@ void RenderWall() {
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 	glBindVertexArray(0);
 }
-// ---------------
\ No newline at end of file
+// ---------------
\ No newline at end of file
@@ -3,17 +3,86 @@
 #include <glad/glad.h>
 #include <glm/glm/gtc/matrix_transform.hpp>
 #include <imgui/imgui.h>
+#include <vector>
+#include <algorithm>
 
 #include "Shader/Shader.h"
 #include "Models/Model.h"
+#include "Scene/StaticMeshBuffer.h"
+#include "Scene/DrawCommandList.h"
+#include "Scene/TriangleBVH.h"
+#include "Scene/SceneSDF.h"
 #include "FunctionLibrary.h"
 
 using glm::mat4;
 using glm::vec3;
+using glm::vec4;
+using glm::ivec4;
+
+// Draw List --------
+// The static scene is built into a flat draw list once, when the scene is
+// loaded or changed. Each item's meshes become indirect draw commands into the
+// StaticMeshBuffer, the command's base instance indexes the mesh draw data SSBO
+// which in turn indexes the item's draw data (model matrices and material).
+
+// binding points of the SSBOs, must match the bindings in 
+// g_buffer.vert and depth.vert
+const unsigned int DRAW_DATA_BINDING = 0;
+const unsigned int MESH_DRAW_BINDING = 1;
+// texture unit of the material texture array in the geometry pass
+const unsigned int MATERIAL_TEXTURE_UNIT = 0;
+
+// mesh handles used by the draw list
+enum SceneMesh { CUBE_MESH, TOWER_MESH };
+
+struct DrawItem {
+	SceneMesh mesh;
+	mat4 model;
+	// material
+	vec3 color;
+	bool textured;			// use the model's textures (toggled in the Debugging window)
+	bool reverseNormals;	// for rendering the inside of the mesh
+	// world space bounds
+	vec3 boundsMin;
+	vec3 boundsMax;
+	// range of the item's commands in the draw commands
+	unsigned int firstCommand;
+	unsigned int commandCount;
+	// shadow proxies, one command each, most detailed first. They are placed 
+	// after all of the scene's commands, so are only drawn by the shadow pass.
+	unsigned int firstLodCommand;
+	unsigned int lodCount;
+};
+
+// GPU copy of a DrawItem, std430 layout
+struct DrawData {
+	mat4 model;
+	mat4 normalMatrix;
+	vec4 color;
+	ivec4 flags;			// x: textured, y: reverse normals
+};
+
+// per draw command data, std430 layout
+struct MeshDrawData {
+	int drawIndex;			// index of the item's DrawData
+	// layers in the material texture array, -1 if none
+	int diffuseLayer;
+	int specularLayer;
+	int normalLayer;
+};
+// ------------------
 
 void SetScene(int _scene);
+void BuildScene();
 void RenderScene(const Shader& shader);
+void BindSceneGeometry();
 void LoadModels();
+const std::vector<DrawItem>& GetDrawList();
+const std::vector<DrawCommand>& GetDrawCommands();
+// built from the draw list's one sided items whenever the scene is built,
+// the BVH's objects are draw list indices
+const TriangleBVH& GetSceneBVH();
+const SceneSDF& GetSceneSDF();
 
 void RenderGUI();
 
@@ -21,4 +90,4 @@ void RenderGUI();
 void RenderQuad();
 void RenderCube();
 void RenderFloor();
-void RenderWall();
\ No newline at end of file
+void RenderWall();
@@ -0,0 +1,42 @@
+#include "Culling.h"
+
+bool SphereIntersectsAABB(vec3 center, float radius, vec3 boundsMin, vec3 boundsMax) {
+	// distance from the center to the closest point in the box
+	vec3 closest = glm::clamp(center, boundsMin, boundsMax);
+	vec3 d = center - closest;
+	return glm::dot(d, d) <= radius * radius;
+}
+
+int CubeFaceMask(vec3 lightPos, vec3 boundsMin, vec3 boundsMax) {
+	// box relative to the light
+	vec3 bMin = boundsMin - lightPos;
+	vec3 bMax = boundsMax - lightPos;
+
+	int mask = 0;
+	for (int face = 0; face < 6; face++) {
+		int axis = face / 2;
+		bool positive = face % 2 == 0;
+
+		// furthest extent of the box along the face's direction
+		float extent = positive ? bMax[axis] : -bMin[axis];
+		if (extent < 0) {
+			continue;	// box is behind the face
+		}
+
+		// the face's frustum is bounded by the 4 planes |p.other| <= p.axis,
+		// test the box's most positive vertex against each plane
+		bool inside = true;
+		for (int k = 1; k < 3; k++) {
+			int other = (axis + k) % 3;
+			if (extent - bMin[other] < 0 || extent + bMax[other] < 0) {
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside) {
+			mask |= 1 << face;
+		}
+	}
+	return mask;
+}
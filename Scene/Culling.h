@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+using glm::vec3;
+
+// Bounding volume tests used to cull the scene's draw list.
+
+// true if the sphere overlaps the axis aligned bounding box
+bool SphereIntersectsAABB(vec3 center, float radius, vec3 boundsMin, vec3 boundsMax);
+
+// Returns a bit mask of the cubemap faces (+X, -X, +Y, -Y, +Z, -Z) centered
+// on lightPos whose 90 degree frustum overlaps the bounding box.
+int CubeFaceMask(vec3 lightPos, vec3 boundsMin, vec3 boundsMax);
@@ -0,0 +1,41 @@
+#include "DrawCommandList.h"
+
+// buffers are generated on the first upload, so lists can be created before the GL context
+DrawCommandList::DrawCommandList() {
+	commandBuffer = 0;
+	paramBuffer = 0;
+	numCommands = 0;
+}
+
+void DrawCommandList::Upload(const vector<DrawCommand>& commands, const vector<int>& params) {
+	if (commandBuffer == 0) {
+		glGenBuffers(1, &commandBuffer);
+		glGenBuffers(1, &paramBuffer);
+	}
+	numCommands = commands.size();
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand),
+		commands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, paramBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, params.size() * sizeof(int),
+		params.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void DrawCommandList::Draw(unsigned int first, unsigned int count) {
+	if (count == 0) {
+		return;
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_PARAM_BINDING, paramBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		(void*)(first * sizeof(DrawCommand)), count, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+unsigned int DrawCommandList::Size() {
+	return numCommands;
+}
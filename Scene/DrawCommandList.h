@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "StaticMeshBuffer.h"
+
+using std::vector;
+
+// binding point of the per command parameter SSBO, must match depth.vert
+const unsigned int DRAW_PARAM_BINDING = 2;
+
+// A list of indirect draw commands into the StaticMeshBuffer, each command 
+// has one int parameter (e.g. the shadow pass' cubemap face mask) which the
+// shaders index with gl_DrawID.
+class DrawCommandList {
+public:
+	DrawCommandList();
+	void Upload(const vector<DrawCommand>& commands, const vector<int>& params);
+	// Draws count commands starting from first with one glMultiDrawElementsIndirect,
+	// the StaticMeshBuffer should be bound.
+	void Draw(unsigned int first, unsigned int count);
+	unsigned int Size();
+
+private:
+	unsigned int commandBuffer;
+	unsigned int paramBuffer;
+	unsigned int numCommands;
+};
@@ -0,0 +1,307 @@
+#include "LightBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+#include "../Threading.h"
+
+const int LIGHT_BVH_MAX_LEAF_SIZE = 4;
+// Morton codes have 10 bits per axis, sorted 8 bits per pass
+const int MORTON_AXIS_BITS = 10;
+const int RADIX_BITS = 8;
+const int RADIX_PASSES = 4;
+// below this many lights per thread, starting the threads costs more than they save
+const int LIGHTS_PER_SORT_THREAD = 4096;
+// Each split is on a lower bit of the codes than its parent's, or halves lights
+// with equal codes, so no tree is deeper than the code's bits plus 31 and the
+// query's stack (one entry per level, plus one) can't overflow.
+const int LIGHT_BVH_STACK_SIZE = 64;
+static_assert(LIGHT_BVH_STACK_SIZE > 3 * MORTON_AXIS_BITS + 31 + 1, "light BVH query stack too small");
+
+// spreads the low 10 bits out to every third bit
+inline unsigned int ExpandBits(unsigned int v) {
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+// p is in the unit cube
+inline unsigned int MortonCode(vec3 p) {
+	const float scale = float((1 << MORTON_AXIS_BITS) - 1);
+	glm::uvec3 q = glm::uvec3(glm::clamp(p, vec3(0.0f), vec3(1.0f)) * scale);
+	return (ExpandBits(q.x) << 2) | (ExpandBits(q.y) << 1) | ExpandBits(q.z);
+}
+
+// buffers are generated on the first upload, so trees can be created before the GL context
+LightBVH::LightBVH() {
+	nodeBuffer = 0;
+	lightBuffer = 0;
+}
+
+void LightBVH::Build(const vector<vec3>& positions, int numLights, const vector<float>& intensities) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	lightPositions.assign(positions.begin(), positions.begin() + numLights);
+	lightIntensities = intensities.empty() ? vector<float>(numLights, 1.0f) : intensities;
+
+	vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (const vec3& p : lightPositions) {
+		boundsMin = glm::min(boundsMin, p);
+		boundsMax = glm::max(boundsMax, p);
+	}
+	vec3 invExtent = 1.0f / glm::max(boundsMax - boundsMin, vec3(1e-6f));
+	codes.resize(numLights);
+	order.resize(numLights);
+	for (int i = 0; i < numLights; i++) {
+		codes[i] = MortonCode((lightPositions[i] - boundsMin) * invExtent);
+		order[i] = i;
+	}
+	SortByCode();
+
+	nodes.clear();
+	nodes.reserve(glm::max(2 * numLights, 1));
+	if (numLights > 0) {
+		Subdivide(0, numLights);
+	}
+	nodesUploaded = false;
+
+	std::chrono::duration<float, std::milli> ms = std::chrono::high_resolution_clock::now() - t1;
+	buildTime = ms.count();
+}
+
+// Least significant digit radix sort of the codes, and the order with them. Each
+// thread sorts a contiguous part of the input: it counts its digits, works out
+// where each of its digits goes from every thread's counts, then scatters them.
+void LightBVH::SortByCode() {
+	int n = codes.size();
+	int threads = glm::clamp(n / LIGHTS_PER_SORT_THREAD, 1, glm::max(int(std::thread::hardware_concurrency()), 1));
+	const int numDigits = 1 << RADIX_BITS;
+	vector<unsigned int> codesOut(n);
+	vector<int> orderOut(n);
+	vector<vector<int>> digitCounts(threads, vector<int>(numDigits));
+	ThreadBarrier barrier(threads);
+
+	auto Worker = [&](int thread) {
+		int begin = n * thread / threads;
+		int end = n * (thread + 1) / threads;
+		unsigned int* keys = codes.data();
+		unsigned int* keysOut = codesOut.data();
+		int* values = order.data();
+		int* valuesOut = orderOut.data();
+		vector<int> offsets(numDigits);
+
+		for (int pass = 0; pass < RADIX_PASSES; pass++) {
+			int shift = pass * RADIX_BITS;
+			vector<int>& counts = digitCounts[thread];
+			std::fill(counts.begin(), counts.end(), 0);
+			for (int i = begin; i < end; i++) {
+				counts[(keys[i] >> shift) & (numDigits - 1)]++;
+			}
+			barrier.Wait();
+
+			// all the smaller digits, then this digit in the threads before this one
+			int offset = 0;
+			for (int digit = 0; digit < numDigits; digit++) {
+				for (int t = 0; t < threads; t++) {
+					if (t == thread) {
+						offsets[digit] = offset;
+					}
+					offset += digitCounts[t][digit];
+				}
+			}
+			for (int i = begin; i < end; i++) {
+				int position = offsets[(keys[i] >> shift) & (numDigits - 1)]++;
+				keysOut[position] = keys[i];
+				valuesOut[position] = values[i];
+			}
+			barrier.Wait();
+			std::swap(keys, keysOut);
+			std::swap(values, valuesOut);
+		}
+	};
+
+	vector<std::thread> workers;
+	for (int thread = 1; thread < threads; thread++) {
+		workers.emplace_back(Worker, thread);
+	}
+	Worker(0);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	// an even number of passes ends back in codes and order
+}
+
+int LightBVH::Subdivide(int first, int count) {
+	int index = nodes.size();
+	nodes.push_back(LightBVHNode());
+
+	if (count <= LIGHT_BVH_MAX_LEAF_SIZE) {
+		vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		float intensity = 0;
+		for (int i = first; i < first + count; i++) {
+			boundsMin = glm::min(boundsMin, lightPositions[order[i]]);
+			boundsMax = glm::max(boundsMax, lightPositions[order[i]]);
+			intensity += lightIntensities[order[i]];
+		}
+		nodes[index].boundsMin = boundsMin;
+		nodes[index].boundsMax = boundsMax;
+		nodes[index].intensity = intensity;
+		nodes[index].rightOrFirst = first;
+		nodes[index].count = count;
+		return index;
+	}
+
+	int split = FindSplit(first, count);
+	int left = Subdivide(first, split - first);
+	int right = Subdivide(split, first + count - split);
+	nodes[index].boundsMin = glm::min(nodes[left].boundsMin, nodes[right].boundsMin);
+	nodes[index].boundsMax = glm::max(nodes[left].boundsMax, nodes[right].boundsMax);
+	nodes[index].intensity = nodes[left].intensity + nodes[right].intensity;
+	nodes[index].rightOrFirst = right;
+	nodes[index].count = 0;
+	return index;
+}
+
+// First light of the right child: where the highest bit that differs in the
+// range's codes is set, or the middle if they're all the same
+int LightBVH::FindSplit(int first, int count) const {
+	unsigned int firstCode = codes[first];
+	unsigned int lastCode = codes[first + count - 1];
+	if (firstCode == lastCode) {
+		return first + count / 2;
+	}
+	int bit = glm::findMSB(firstCode ^ lastCode);
+	return std::partition_point(codes.begin() + first, codes.begin() + first + count,
+		[bit](unsigned int code) { return ((code >> bit) & 1) == 0; }) - codes.begin();
+}
+
+void LightBVH::Upload(const vector<int>& shadowMaps) {
+	if (nodeBuffer == 0) {
+		glGenBuffers(1, &nodeBuffer);
+		glGenBuffers(1, &lightBuffer);
+	}
+	if (!nodesUploaded) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, nodes.size() * sizeof(LightBVHNode),
+			nodes.data(), GL_DYNAMIC_DRAW);
+		nodesUploaded = true;
+	}
+
+	// shadow maps are reassigned every frame, so the lights are always uploaded
+	gpuLights.resize(order.size());
+	for (int i = 0; i < int(order.size()); i++) {
+		gpuLights[i].position = lightPositions[order[i]];
+		gpuLights[i].shadowMap = shadowMaps[order[i]];
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, gpuLights.size() * sizeof(LightBVHLight),
+		gpuLights.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightBVH::Bind() {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_NODE_BINDING, nodeBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_TREE_LIGHT_BINDING, lightBuffer);
+}
+
+void LightBVH::QueryAABB(vec3 boxMin, vec3 boxMax, float radius, vector<int>* lights) const {
+	lights->clear();
+	if (nodes.empty()) {
+		return;
+	}
+	float radiusSq = radius * radius;
+	int stack[LIGHT_BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int index = stack[--stackSize];
+		const LightBVHNode& node = nodes[index];
+		// gap between the boxes on each axis
+		vec3 gap = glm::max(glm::max(node.boundsMin - boxMax, boxMin - node.boundsMax), vec3(0.0f));
+		if (glm::dot(gap, gap) > radiusSq) {
+			continue;
+		}
+		if (node.count > 0) {
+			for (int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++) {
+				vec3 p = lightPositions[order[i]];
+				vec3 d = p - glm::clamp(p, boxMin, boxMax);
+				if (glm::dot(d, d) <= radiusSq) {
+					lights->push_back(order[i]);
+				}
+			}
+			continue;
+		}
+		stack[stackSize++] = node.rightOrFirst;
+		stack[stackSize++] = index + 1;
+	}
+}
+
+bool LightBVH::Validate() const {
+	int numLights = order.size();
+	vector<int> leafOf(numLights, -1);
+	for (int i = 0; i < numLights; i++) {
+		if (i > 0 && codes[i - 1] > codes[i]) {
+			std::cout << "ERROR::LIGHT_BVH::NOT_SORTED at " << i << std::endl;
+			return false;
+		}
+		if (order[i] < 0 || order[i] >= numLights || leafOf[order[i]] >= 0) {
+			std::cout << "ERROR::LIGHT_BVH::ORDER_NOT_A_PERMUTATION at " << i << std::endl;
+			return false;
+		}
+		leafOf[order[i]] = i;
+	}
+
+	// each node covers a contiguous range of the lights, children split it
+	vector<int> first(nodes.size()), count(nodes.size());
+	for (int index = nodes.size() - 1; index >= 0; index--) {
+		const LightBVHNode& node = nodes[index];
+		if (node.count > 0) {
+			first[index] = node.rightOrFirst;
+			count[index] = node.count;
+		}
+		else {
+			int left = index + 1;
+			int right = node.rightOrFirst;
+			if (first[left] + count[left] != first[right]) {
+				std::cout << "ERROR::LIGHT_BVH::CHILDREN_NOT_CONTIGUOUS at node " << index << std::endl;
+				return false;
+			}
+			first[index] = first[left];
+			count[index] = count[left] + count[right];
+		}
+
+		vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		float intensity = 0;
+		for (int i = first[index]; i < first[index] + count[index]; i++) {
+			boundsMin = glm::min(boundsMin, lightPositions[order[i]]);
+			boundsMax = glm::max(boundsMax, lightPositions[order[i]]);
+			intensity += lightIntensities[order[i]];
+		}
+		if (boundsMin != node.boundsMin || boundsMax != node.boundsMax ||
+			glm::abs(intensity - node.intensity) > 1e-3f * glm::max(intensity, 1.0f)) {
+			std::cout << "ERROR::LIGHT_BVH::BAD_NODE " << index << std::endl;
+			return false;
+		}
+	}
+	if (!nodes.empty() && (first[0] != 0 || count[0] != numLights)) {
+		std::cout << "ERROR::LIGHT_BVH::LIGHTS_MISSING" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int LightBVH::NumNodes() const {
+	return nodes.size();
+}
+
+int LightBVH::NumLights() const {
+	return order.size();
+}
+
+float LightBVH::BuildTime() const {
+	return buildTime;
+}
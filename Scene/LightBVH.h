@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+
+using glm::vec3;
+using std::vector;
+
+// binding points of the light tree's SSBOs, must match lighting_pass.frag
+const unsigned int LIGHT_NODE_BINDING = 3;
+const unsigned int LIGHT_TREE_LIGHT_BINDING = 4;
+
+// Bounding volume hierarchy over the bolt's point lights, used by the lighting
+// pass to pick the lights most likely to light each pixel. Rebuilt every strike:
+// the lights are sorted by the Morton code of their position with a (parallel)
+// radix sort, and each node splits its range where the highest differing bit
+// of the codes changes. Nodes are stored depth first like TriangleBVH's, a node's
+// left child is the next node. Each node also has the total intensity of its lights.
+// Laid out for std430, so the nodes and lights can be uploaded as they are.
+
+struct alignas(16) LightBVHNode {
+	vec3 boundsMin;
+	int rightOrFirst;	// right child for inner nodes, first light for leaves
+	vec3 boundsMax;
+	int count;			// number of lights, 0 for inner nodes
+	float intensity;	// sum of the lights' intensities
+	float padding[3];
+};
+
+struct LightBVHLight {
+	vec3 position;
+	int shadowMap;		// packed tier * 256 + layer, -1 for none
+};
+
+class LightBVH {
+public:
+	LightBVH();
+	// Builds over the first numLights positions, intensities is empty for all 1
+	void Build(const vector<vec3>& positions, int numLights, const vector<float>& intensities = {});
+	// Uploads the lights in leaf order with each light's shadow map, and the nodes if they changed
+	void Upload(const vector<int>& shadowMaps);
+	void Bind();
+	// Lights within radius of the box, as indices into the positions passed to Build
+	void QueryAABB(vec3 boxMin, vec3 boxMax, float radius, vector<int>* lights) const;
+	// Checks the lights are sorted by their codes, each light is in one leaf and
+	// each node's bounds and intensity match its lights. Prints the first problem.
+	bool Validate() const;
+
+	int NumNodes() const;
+	int NumLights() const;
+	float BuildTime() const;
+
+private:
+	vector<LightBVHNode> nodes;
+	vector<int> order;				// light in each leaf position
+	vector<unsigned int> codes;		// Morton code of each leaf position's light
+	vector<vec3> lightPositions;
+	vector<float> lightIntensities;
+	vector<LightBVHLight> gpuLights;
+	float buildTime = 0;
+	bool nodesUploaded = false;
+
+	unsigned int nodeBuffer;
+	unsigned int lightBuffer;
+
+	void SortByCode();
+	int Subdivide(int first, int count);
+	int FindSplit(int first, int count) const;
+};
@@ -0,0 +1,126 @@
+#include "SceneSDF.h"
+
+void SceneSDF::Bake(const TriangleBVH& bvh, float _cellSize, float _maxDistance, int numThreads) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	cellSize = _cellSize;
+	maxDistance = _maxDistance;
+	if (bvh.NumTriangles() == 0) {
+		size = ivec3(0);
+		distances.clear();
+		return;
+	}
+	origin = bvh.BoundsMin() - vec3(maxDistance);
+	size = ivec3(glm::ceil((bvh.BoundsMax() + vec3(maxDistance) - origin) / cellSize)) + 1;
+	distances.assign((size_t)size.x * size.y * size.z, SHRT_MAX);
+
+	// threads take z slices until none are left
+	std::atomic<int> nextSlice(0);
+	auto BakeSlices = [&]() {
+		for (int z = nextSlice++; z < size.z; z = nextSlice++) {
+			for (int y = 0; y < size.y; y++) {
+				for (int x = 0; x < size.x; x++) {
+					vec3 p = origin + vec3(x, y, z) * cellSize;
+					vec3 closest, normal;
+					if (!bvh.ClosestPoint(p, maxDistance, &closest, &normal)) {
+						continue;
+					}
+					float distance = glm::length(p - closest);
+					// behind the closest face, edge or vertex is inside
+					if (glm::dot(p - closest, normal) < 0) {
+						distance = -distance;
+					}
+					size_t i = x + ((size_t)y + (size_t)z * size.y) * size.x;
+					distances[i] = short(glm::clamp(distance / maxDistance, -1.0f, 1.0f) * SHRT_MAX);
+				}
+			}
+		}
+	};
+
+	vector<std::thread> threads;
+	for (int t = 1; t < numThreads; t++) {
+		threads.push_back(std::thread(BakeSlices));
+	}
+	BakeSlices();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	auto t2 = std::chrono::high_resolution_clock::now();
+	bakeTime = std::chrono::duration<float, std::milli>(t2 - t1).count();
+}
+
+float SceneSDF::Distance(vec3 p) const {
+	vec3 g = (p - origin) / cellSize;
+	if (g.x < 0 || g.y < 0 || g.z < 0 || 
+		g.x >= size.x - 1 || g.y >= size.y - 1 || g.z >= size.z - 1) {
+		return maxDistance;
+	}
+	ivec3 c = ivec3(g);
+	vec3 f = g - vec3(c);
+
+	float x00 = glm::mix(Cell(c.x, c.y, c.z), Cell(c.x + 1, c.y, c.z), f.x);
+	float x10 = glm::mix(Cell(c.x, c.y + 1, c.z), Cell(c.x + 1, c.y + 1, c.z), f.x);
+	float x01 = glm::mix(Cell(c.x, c.y, c.z + 1), Cell(c.x + 1, c.y, c.z + 1), f.x);
+	float x11 = glm::mix(Cell(c.x, c.y + 1, c.z + 1), Cell(c.x + 1, c.y + 1, c.z + 1), f.x);
+	return glm::mix(glm::mix(x00, x10, f.y), glm::mix(x01, x11, f.y), f.z);
+}
+
+vec3 SceneSDF::Gradient(vec3 p) const {
+	float h = cellSize * 0.5f;
+	vec3 gradient = vec3(
+		Distance(p + vec3(h, 0, 0)) - Distance(p - vec3(h, 0, 0)),
+		Distance(p + vec3(0, h, 0)) - Distance(p - vec3(0, h, 0)),
+		Distance(p + vec3(0, 0, h)) - Distance(p - vec3(0, 0, h)));
+	float length = glm::length(gradient);
+	return length > 0 ? gradient / length : vec3(0.0f);
+}
+
+bool SceneSDF::Raymarch(vec3 start, vec3 end, float surfaceDistance, vec3* hit) const {
+	if (!IsBaked()) {
+		return false;
+	}
+	vec3 dir = end - start;
+	float length = glm::length(dir);
+	if (length <= 0) {
+		return false;
+	}
+	dir /= length;
+
+	// the field is filtered, so never step less than a fraction of a cell
+	float minStep = cellSize * 0.25f;
+	float t = 0;
+	while (true) {
+		vec3 p = start + dir * t;
+		float d = Distance(p);
+		if (d <= surfaceDistance) {
+			*hit = p;
+			return true;
+		}
+		if (t >= length) {
+			return false;
+		}
+		t = glm::min(t + glm::max(d - surfaceDistance, minStep), length);
+	}
+}
+
+bool SceneSDF::IsBaked() const {
+	return !distances.empty();
+}
+
+float SceneSDF::MaxDistance() const {
+	return maxDistance;
+}
+
+float SceneSDF::BakeTime() const {
+	return bakeTime;
+}
+
+size_t SceneSDF::MemoryBytes() const {
+	return distances.size() * sizeof(short);
+}
+
+// PRIVATE
+float SceneSDF::Cell(int x, int y, int z) const {
+	return distances[x + ((size_t)y + (size_t)z * size.y) * size.x] * (maxDistance / SHRT_MAX);
+}
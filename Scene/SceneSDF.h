@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <climits>
+
+#include "TriangleBVH.h"
+
+using glm::vec3;
+using glm::ivec3;
+using std::vector;
+
+// Signed distance field of the static scene, baked once at load time.
+// Distances are stored as 16 bit fractions of maxDistance, anything further
+// from the scene than maxDistance is clamped, so only the band near the 
+// surfaces has detail. Negative inside geometry.
+
+class SceneSDF {
+public:
+	// Bakes the field over the bvh's bounds plus maxDistance, on numThreads threads
+	void Bake(const TriangleBVH& bvh, float cellSize, float maxDistance, int numThreads);
+
+	// trilinearly filtered distance, maxDistance outside the baked bounds
+	float Distance(vec3 p) const;
+	// direction of increasing distance (away from the surface)
+	vec3 Gradient(vec3 p) const;
+	// Sphere traces from start to end, stopping within surfaceDistance of the scene. 
+	// Returns true and the stopping point in hit if the segment reaches the scene.
+	bool Raymarch(vec3 start, vec3 end, float surfaceDistance, vec3* hit) const;
+
+	bool IsBaked() const;
+	float MaxDistance() const;
+	float BakeTime() const;
+	size_t MemoryBytes() const;
+
+private:
+	vector<short> distances;
+	ivec3 size = ivec3(0);
+	vec3 origin = vec3(0.0f);	// position of cell (0, 0, 0)
+	float cellSize = 1.0f;
+	float maxDistance = 0.0f;
+	float bakeTime = 0;
+
+	float Cell(int x, int y, int z) const;
+};
@@ -0,0 +1,180 @@
+#include "StaticMeshBuffer.h"
+
+// buffers are generated in Upload, so the mesh buffer can be created before the GL context
+StaticMeshBuffer::StaticMeshBuffer() {
+	VAO = 0;
+	VBO = 0;
+	EBO = 0;
+	textureArray = 0;
+	textureArrayBytes = 0;
+}
+
+int StaticMeshBuffer::AddMesh(const vector<PackedVertex>& meshVertices, 
+	const vector<unsigned int>& meshIndices) {
+
+	MeshRange range;
+	range.firstIndex = indices.size();
+	range.indexCount = meshIndices.size();
+	range.baseVertex = vertices.size();
+	range.diffuseLayer = -1;
+	range.specularLayer = -1;
+	range.normalLayer = -1;
+
+	vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+	indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+
+	meshes.push_back({ range });
+	return meshes.size() - 1;
+}
+
+int StaticMeshBuffer::AddModel(const Model& model) {
+	vector<MeshRange> ranges;
+
+	for (const Mesh& mesh : model.meshes) {
+		MeshRange range;
+		range.firstIndex = indices.size();
+		range.indexCount = mesh.indices.size();
+		range.baseVertex = vertices.size();
+		range.diffuseLayer = FindLayer(mesh, model.directory, "texture_diffuse");
+		range.specularLayer = FindLayer(mesh, model.directory, "texture_specular");
+		range.normalLayer = FindLayer(mesh, model.directory, "texture_normal");
+
+		for (const Vertex& vertex : mesh.vertices) {
+			vertices.push_back({ vertex.Position, vertex.Normal, vertex.TexCoords });
+		}
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+		ranges.push_back(range);
+	}
+
+	meshes.push_back(ranges);
+	return meshes.size() - 1;
+}
+
+int StaticMeshBuffer::AddShadowProxy(const ShadowProxy& proxy) {
+	vector<PackedVertex> proxyVertices;
+	proxyVertices.reserve(proxy.positions.size());
+	for (const glm::vec3& position : proxy.positions) {
+		proxyVertices.push_back({ position, glm::vec3(0.0f), glm::vec2(0.0f) });
+	}
+	return AddMesh(proxyVertices, proxy.indices);
+}
+
+void StaticMeshBuffer::Upload() {
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	// positions
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
+	// normals
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+	// texture coords
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+	glBindVertexArray(0);
+
+	BuildTextureArray();
+
+	std::cout << "StaticMeshBuffer: " << vertices.size() << " vertices, " << indices.size() / 3
+		<< " triangles, " << texturePaths.size() << " textures (" << textureArrayBytes / (1024 * 1024) 
+		<< " MB compressed)" << std::endl;
+}
+
+void StaticMeshBuffer::Bind(unsigned int textureUnit) {
+	glBindVertexArray(VAO);
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+}
+
+const vector<MeshRange>& StaticMeshBuffer::GetRanges(int handle) {
+	return meshes[handle];
+}
+
+const vector<PackedVertex>& StaticMeshBuffer::GetVertices() const {
+	return vertices;
+}
+
+const vector<unsigned int>& StaticMeshBuffer::GetIndices() const {
+	return indices;
+}
+
+// PRIVATE
+// returns the layer of the mesh's first texture of the given type, -1 if it has none
+int StaticMeshBuffer::FindLayer(const Mesh& mesh, const std::string& directory, 
+	const std::string& type) {
+
+	for (const Texture& texture : mesh.textures) {
+		if (texture.type == type) {
+			return AddTexture(directory + '\\' + texture.path);
+		}
+	}
+	return -1;
+}
+
+int StaticMeshBuffer::AddTexture(const std::string& path) {
+	for (unsigned int i = 0; i < texturePaths.size(); i++) {
+		if (texturePaths[i] == path) {
+			return i;
+		}
+	}
+	texturePaths.push_back(path);
+	return texturePaths.size() - 1;
+}
+
+void StaticMeshBuffer::BuildTextureArray() {
+	glGenTextures(1, &textureArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+
+	// always allocate at least one layer, so the sampler is valid
+	if (texturePaths.empty()) {
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, 1, 1, 1);
+	}
+	else {
+		// the layers share one format, BC3 if any of the textures has alpha
+		BlockFormat format = BC1;
+		for (const std::string& path : texturePaths) {
+			if (ChooseBlockFormat(path) == BC3) {
+				format = BC3;
+			}
+		}
+
+		CompressedTexture texture;
+		texture.format = format;
+		texture.width = TEXTURE_ARRAY_SIZE;
+		texture.height = TEXTURE_ARRAY_SIZE;
+		int levels = int(glm::floor(glm::log2(float(TEXTURE_ARRAY_SIZE)))) + 1;
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, texture.InternalFormat(), 
+			TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_SIZE, texturePaths.size());
+		for (int level = 0; level < levels; level++) {
+			textureArrayBytes += texture.LevelSize(level) * texturePaths.size();
+		}
+
+		// the mip chains are precomputed, each layer is copied straight from its cache
+		for (unsigned int layer = 0; layer < texturePaths.size(); layer++) {
+			if (!LoadCompressedTexture(texturePaths[layer], TEXTURE_ARRAY_SIZE, format, &texture)) {
+				std::cout << "Texture failed to load at path: " << texturePaths[layer] << std::endl;
+				continue;
+			}
+			for (int level = 0; level < texture.levels; level++) {
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, 
+					texture.LevelWidth(level), texture.LevelHeight(level), 1, texture.InternalFormat(),
+					texture.LevelSize(level), texture.data.data() + texture.levelOffsets[level]);
+			}
+		}
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
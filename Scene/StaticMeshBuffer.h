@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <stb_image/stb_image.h>
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "../Models/Model.h"
+#include "../Models/CompressedTexture.h"
+
+using std::vector;
+
+// Packs every static mesh into one shared vertex and index buffer, so the
+// whole scene can be submitted with glMultiDrawElementsIndirect. Material
+// textures are stored as block compressed layers of a single texture array.
+
+// vertex layout shared by all the static meshes
+struct PackedVertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 TexCoords;
+};
+
+// a mesh's range in the shared buffers
+struct MeshRange {
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	int baseVertex;
+	// layers in the material texture array, -1 if the mesh has none
+	int diffuseLayer;
+	int specularLayer;
+	int normalLayer;
+};
+
+// layout read by glMultiDrawElementsIndirect
+struct DrawCommand {
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+class StaticMeshBuffer {
+public:
+	StaticMeshBuffer();
+	// Add a mesh or a model (one range per model mesh), returns the mesh handle.
+	int AddMesh(const vector<PackedVertex>& meshVertices, const vector<unsigned int>& meshIndices);
+	int AddModel(const Model& model);
+	// Position only mesh, normals and texture coordinates are left zero
+	int AddShadowProxy(const ShadowProxy& proxy);
+	// Uploads the buffers and builds the material texture array, 
+	// call once after all the meshes are added.
+	void Upload();
+	// Binds the shared VAO and the material texture array to textureUnit
+	void Bind(unsigned int textureUnit);
+
+	const vector<MeshRange>& GetRanges(int handle);
+	// CPU copies, kept for building the scene's collision structures
+	const vector<PackedVertex>& GetVertices() const;
+	const vector<unsigned int>& GetIndices() const;
+
+private:
+	unsigned int VAO, VBO, EBO;
+	unsigned int textureArray;
+	size_t textureArrayBytes;
+	// all textures in the array are resampled to this size
+	const int TEXTURE_ARRAY_SIZE = 1024;
+
+	vector<PackedVertex> vertices;
+	vector<unsigned int> indices;
+	vector<vector<MeshRange>> meshes;
+	vector<std::string> texturePaths;
+
+	int AddTexture(const std::string& path);
+	int FindLayer(const Mesh& mesh, const std::string& directory, const std::string& type);
+	void BuildTextureArray();
+};
@@ -0,0 +1,732 @@
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Build
+const int BVH_BINS = 16;
+const int BVH_MAX_LEAF_SIZE = 16;
+const float BVH_TRAVERSAL_COST = 1.0f;	// relative to one triangle test
+// Past this depth nodes are halved at their median, so no tree is deeper than
+// BVH_MAX_DEPTH + 32 and the traversal stacks (one entry per level, plus one)
+// can't overflow.
+const int BVH_MAX_DEPTH = 64;
+const int BVH_STACK_SIZE = 128;
+static_assert(BVH_STACK_SIZE > BVH_MAX_DEPTH + 32, "BVH traversal stack too small");
+
+float SurfaceArea(vec3 boundsMin, vec3 boundsMax) {
+	vec3 e = glm::max(boundsMax - boundsMin, vec3(0.0f));
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// Slab test of the ray against the node's bounds, both loaded as 4 floats
+// with the node's ints in the w lanes, which are never read.
+// Returns the entry distance, or FLT_MAX if the ray misses within maxT.
+inline float RayNode(const BVHNode& node, __m128 origin, __m128 invDir, float maxT) {
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.boundsMin.x), origin), invDir);
+	__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.boundsMax.x), origin), invDir);
+	__m128 near4 = _mm_min_ps(t1, t2);
+	__m128 far4 = _mm_max_ps(t1, t2);
+	// reduce x, y and z
+	__m128 nearY = _mm_shuffle_ps(near4, near4, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 nearZ = _mm_shuffle_ps(near4, near4, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 farY = _mm_shuffle_ps(far4, far4, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 farZ = _mm_shuffle_ps(far4, far4, _MM_SHUFFLE(2, 2, 2, 2));
+	float tNear = _mm_cvtss_f32(_mm_max_ss(_mm_max_ss(near4, nearY), nearZ));
+	float tFar = _mm_cvtss_f32(_mm_min_ss(_mm_min_ss(far4, farY), farZ));
+
+	if (tFar < tNear || tFar < 0 || tNear > maxT) {
+		return FLT_MAX;
+	}
+	return tNear;
+}
+
+inline float BoxDistanceSq(vec3 p, vec3 boundsMin, vec3 boundsMax) {
+	vec3 d = p - glm::clamp(p, boundsMin, boundsMax);
+	return glm::dot(d, d);
+}
+
+void TriangleBVH::Build(const vector<vec3>& triangleVertices, const vector<int>& triangleObjects) {
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	int numTriangles = triangleVertices.size() / 3;
+	buildTriangles.resize(numTriangles);
+	order.resize(numTriangles);
+	for (int t = 0; t < numTriangles; t++) {
+		vec3 a = triangleVertices[t * 3];
+		vec3 b = triangleVertices[t * 3 + 1];
+		vec3 c = triangleVertices[t * 3 + 2];
+		buildTriangles[t].boundsMin = glm::min(a, glm::min(b, c));
+		buildTriangles[t].boundsMax = glm::max(a, glm::max(b, c));
+		buildTriangles[t].centroid = (a + b + c) / 3.0f;
+		order[t] = t;
+	}
+
+	nodes.clear();
+	nodeObjects.clear();
+	triangles.clear();
+	if (numTriangles > 0) {
+		nodes.reserve(numTriangles * 2);
+		nodeObjects.reserve(numTriangles * 2);
+		// objects are needed for the node masks while subdividing
+		triangles.resize(numTriangles);
+		int maxObject = 0;
+		for (int t = 0; t < numTriangles; t++) {
+			triangles[t].object = triangleObjects.empty() ? 0 : triangleObjects[t];
+			maxObject = glm::max(maxObject, triangles[t].object);
+		}
+		objectWords = maxObject / 64 + 1;
+		Subdivide(0, numTriangles, 0);
+
+		BuildPseudoNormals(triangleVertices);
+
+		// store the triangles in leaf order
+		vector<BVHTriangle> sorted(numTriangles);
+		vector<BVHTriangleFeatures> sortedFeatures(numTriangles);
+		for (int i = 0; i < numTriangles; i++) {
+			int t = order[i];
+			vec3 a = triangleVertices[t * 3];
+			sorted[i] = { a, triangleVertices[t * 3 + 1] - a, triangleVertices[t * 3 + 2] - a, triangles[t].object };
+			sortedFeatures[i] = features[t];
+		}
+		triangles.swap(sorted);
+		features.swap(sortedFeatures);
+	}
+	else {
+		features.clear();
+		vertexNormals.clear();
+		edgeNormals.clear();
+	}
+	buildTriangles.clear();
+	order.clear();
+
+	auto t2 = std::chrono::high_resolution_clock::now();
+	buildTime = std::chrono::duration<float, std::milli>(t2 - t1).count();
+}
+
+bool TriangleBVH::Intersect(vec3 origin, vec3 dir, float maxT, BVHHit* hit) const {
+	if (nodes.empty()) {
+		return false;
+	}
+	__m128 origin4 = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+	__m128 invDir4 = _mm_setr_ps(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z, 0.0f);
+
+	int bestTriangle = -1;
+	float bestT = maxT;
+	if (RayNode(nodes[0], origin4, invDir4, bestT) == FLT_MAX) {
+		return false;
+	}
+
+	int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int n = stack[--stackSize];
+		const BVHNode& node = nodes[n];
+		if (node.count > 0) {
+			for (int t = node.rightOrFirst; t < node.rightOrFirst + node.count; t++) {
+				float tHit;
+				if (IntersectTriangle(triangles[t], origin, dir, bestT, &tHit)) {
+					bestT = tHit;
+					bestTriangle = t;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first, skipping children beyond the best hit so far
+		float tLeft = RayNode(nodes[n + 1], origin4, invDir4, bestT);
+		float tRight = RayNode(nodes[node.rightOrFirst], origin4, invDir4, bestT);
+		int near = n + 1;
+		int far = node.rightOrFirst;
+		if (tRight < tLeft) {
+			std::swap(tLeft, tRight);
+			std::swap(near, far);
+		}
+		if (tRight != FLT_MAX) {
+			stack[stackSize++] = far;
+		}
+		if (tLeft != FLT_MAX) {
+			stack[stackSize++] = near;
+		}
+	}
+
+	if (bestTriangle < 0) {
+		return false;
+	}
+	const BVHTriangle& triangle = triangles[bestTriangle];
+	hit->t = bestT;
+	hit->normal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+	hit->object = triangle.object;
+	return true;
+}
+
+bool TriangleBVH::Occluded(vec3 origin, vec3 dir, float maxT) const {
+	if (nodes.empty()) {
+		return false;
+	}
+	__m128 origin4 = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+	__m128 invDir4 = _mm_setr_ps(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z, 0.0f);
+	if (RayNode(nodes[0], origin4, invDir4, maxT) == FLT_MAX) {
+		return false;
+	}
+
+	int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int n = stack[--stackSize];
+		const BVHNode& node = nodes[n];
+		if (node.count > 0) {
+			for (int t = node.rightOrFirst; t < node.rightOrFirst + node.count; t++) {
+				float tHit;
+				if (IntersectTriangle(triangles[t], origin, dir, maxT, &tHit)) {
+					return true;
+				}
+			}
+			continue;
+		}
+
+		// any hit will do, but the nearer child is still the most likely to have one
+		float tLeft = RayNode(nodes[n + 1], origin4, invDir4, maxT);
+		float tRight = RayNode(nodes[node.rightOrFirst], origin4, invDir4, maxT);
+		int near = n + 1;
+		int far = node.rightOrFirst;
+		if (tRight < tLeft) {
+			std::swap(tLeft, tRight);
+			std::swap(near, far);
+		}
+		if (tRight != FLT_MAX) {
+			stack[stackSize++] = far;
+		}
+		if (tLeft != FLT_MAX) {
+			stack[stackSize++] = near;
+		}
+	}
+	return false;
+}
+
+bool TriangleBVH::ClosestPoint(vec3 p, float maxDistance, vec3* closest, vec3* normal) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	float bestDistanceSq = maxDistance * maxDistance;
+	int bestTriangle = -1;
+	int bestFeature = 6;
+
+	int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int n = stack[--stackSize];
+		const BVHNode& node = nodes[n];
+		// skip nodes further away than the best triangle so far
+		if (BoxDistanceSq(p, node.boundsMin, node.boundsMax) > bestDistanceSq) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int t = node.rightOrFirst; t < node.rightOrFirst + node.count; t++) {
+				const BVHTriangle& triangle = triangles[t];
+				int feature;
+				vec3 point = ClosestPointOnTriangle(p, triangle.v0, triangle.v0 + triangle.edge1,
+					triangle.v0 + triangle.edge2, &feature);
+				vec3 offset = p - point;
+				float distanceSq = glm::dot(offset, offset);
+				if (distanceSq < bestDistanceSq) {
+					bestDistanceSq = distanceSq;
+					bestTriangle = t;
+					bestFeature = feature;
+					*closest = point;
+				}
+			}
+			continue;
+		}
+
+		// push the further child first, so the nearer one is visited first
+		const BVHNode& right = nodes[node.rightOrFirst];
+		const BVHNode& left = nodes[n + 1];
+		bool leftFirst = BoxDistanceSq(p, left.boundsMin, left.boundsMax) <=
+			BoxDistanceSq(p, right.boundsMin, right.boundsMax);
+		stack[stackSize++] = leftFirst ? node.rightOrFirst : n + 1;
+		stack[stackSize++] = leftFirst ? n + 1 : node.rightOrFirst;
+	}
+
+	if (bestTriangle < 0) {
+		return false;
+	}
+	vec3 n = PseudoNormal(bestTriangle, bestFeature);
+	float length = glm::length(n);
+	*normal = length > 0 ? n / length : vec3(0, 1, 0);
+	return true;
+}
+
+void TriangleBVH::SphereObjectMask(vec3 center, float radius, unsigned long long* mask) const {
+	std::fill(mask, mask + objectWords, 0ull);
+	if (nodes.empty()) {
+		return;
+	}
+	float radiusSq = radius * radius;
+	// true if the node's subtree has objects not found yet
+	auto HasNew = [&](int n) {
+		const unsigned long long* objects = &nodeObjects[n * objectWords];
+		for (int w = 0; w < objectWords; w++) {
+			if (objects[w] & ~mask[w]) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int n = stack[--stackSize];
+		const BVHNode& node = nodes[n];
+		// nothing new can be found in this subtree
+		if (!HasNew(n) || BoxDistanceSq(center, node.boundsMin, node.boundsMax) > radiusSq) {
+			continue;
+		}
+		// the whole node is inside the sphere
+		vec3 farthest = glm::max(glm::abs(node.boundsMin - center), glm::abs(node.boundsMax - center));
+		if (glm::dot(farthest, farthest) <= radiusSq) {
+			for (int w = 0; w < objectWords; w++) {
+				mask[w] |= nodeObjects[n * objectWords + w];
+			}
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int t = node.rightOrFirst; t < node.rightOrFirst + node.count; t++) {
+				const BVHTriangle& triangle = triangles[t];
+				if (MaskHasObject(mask, triangle.object)) {
+					continue;
+				}
+				vec3 offset = center - ClosestPointOnTriangle(center, triangle.v0,
+					triangle.v0 + triangle.edge1, triangle.v0 + triangle.edge2);
+				if (glm::dot(offset, offset) <= radiusSq) {
+					mask[triangle.object >> 6] |= 1ull << (triangle.object & 63);
+				}
+			}
+			continue;
+		}
+		stack[stackSize++] = node.rightOrFirst;
+		stack[stackSize++] = n + 1;
+	}
+}
+
+bool TriangleBVH::Inside(vec3 p) const {
+	// upwards and off the axes, so the rays don't run along walls or through edges
+	static const vec3 directions[] = {
+		glm::normalize(vec3(0.05f, 1.0f, 0.03f)),
+		glm::normalize(vec3(0.71f, 0.62f, 0.33f)),
+		glm::normalize(vec3(-0.58f, 0.67f, 0.46f)),
+		glm::normalize(vec3(0.27f, 0.59f, -0.76f)),
+		glm::normalize(vec3(-0.39f, 0.71f, -0.58f)),
+	};
+	int inside = 0;
+	for (vec3 dir : directions) {
+		inside += CountHits(p, dir) & 1;
+	}
+	return inside * 2 > 5;
+}
+
+void TriangleBVH::IntersectSegments(const vector<pair<vec3, vec3>>& segments, vector<float>* hitFractions) const {
+	hitFractions->assign(segments.size(), -1.0f);
+	vec3 batchMin = vec3(FLT_MAX);
+	vec3 batchMax = vec3(-FLT_MAX);
+	for (const pair<vec3, vec3>& segment : segments) {
+		batchMin = glm::min(batchMin, glm::min(segment.first, segment.second));
+		batchMax = glm::max(batchMax, glm::max(segment.first, segment.second));
+	}
+	if (nodes.empty() || glm::any(glm::greaterThan(batchMin, BoundsMax())) ||
+		glm::any(glm::lessThan(batchMax, BoundsMin()))) {
+		return;
+	}
+
+	BVHHit hit;
+	for (unsigned int s = 0; s < segments.size(); s++) {
+		vec3 dir = segments[s].second - segments[s].first;
+		float length = glm::length(dir);
+		if (length > 0 && Intersect(segments[s].first, dir / length, length, &hit)) {
+			(*hitFractions)[s] = hit.t / length;
+		}
+	}
+}
+
+void TriangleBVH::OccludedSegments(const vector<pair<vec3, vec3>>& segments, vector<bool>* occluded) const {
+	occluded->assign(segments.size(), false);
+	vec3 batchMin = vec3(FLT_MAX);
+	vec3 batchMax = vec3(-FLT_MAX);
+	for (const pair<vec3, vec3>& segment : segments) {
+		batchMin = glm::min(batchMin, glm::min(segment.first, segment.second));
+		batchMax = glm::max(batchMax, glm::max(segment.first, segment.second));
+	}
+	if (nodes.empty() || glm::any(glm::greaterThan(batchMin, BoundsMax())) ||
+		glm::any(glm::lessThan(batchMax, BoundsMin()))) {
+		return;
+	}
+
+	for (unsigned int s = 0; s < segments.size(); s++) {
+		vec3 dir = segments[s].second - segments[s].first;
+		float length = glm::length(dir);
+		(*occluded)[s] = length > 0 && Occluded(segments[s].first, dir / length, length);
+	}
+}
+
+void TriangleBVH::SphereObjectMasks(const vector<vec3>& centers, float radius,
+	vector<unsigned long long>* masks) const {
+
+	masks->assign(centers.size() * objectWords, 0);
+	vec3 batchMin = vec3(FLT_MAX);
+	vec3 batchMax = vec3(-FLT_MAX);
+	for (vec3 center : centers) {
+		batchMin = glm::min(batchMin, center - radius);
+		batchMax = glm::max(batchMax, center + radius);
+	}
+	if (nodes.empty() || glm::any(glm::greaterThan(batchMin, BoundsMax())) ||
+		glm::any(glm::lessThan(batchMax, BoundsMin()))) {
+		return;
+	}
+
+	for (unsigned int c = 0; c < centers.size(); c++) {
+		SphereObjectMask(centers[c], radius, &(*masks)[c * objectWords]);
+	}
+}
+
+vec3 TriangleBVH::BoundsMin() const {
+	return nodes.empty() ? vec3(0.0f) : nodes[0].boundsMin;
+}
+
+vec3 TriangleBVH::BoundsMax() const {
+	return nodes.empty() ? vec3(0.0f) : nodes[0].boundsMax;
+}
+
+int TriangleBVH::NumTriangles() const {
+	return triangles.size();
+}
+
+int TriangleBVH::NumNodes() const {
+	return nodes.size();
+}
+
+float TriangleBVH::BuildTime() const {
+	return buildTime;
+}
+
+int TriangleBVH::ObjectWords() const {
+	return objectWords;
+}
+
+bool TriangleBVH::MaskHasObject(const unsigned long long* mask, int object) const {
+	int word = object >> 6;
+	return word < objectWords && (mask[word] >> (object & 63) & 1);
+}
+
+// PRIVATE
+// Adds the node for order[first, first + count) and its subtree, returns its index
+int TriangleBVH::Subdivide(int first, int count, int depth) {
+	int n = nodes.size();
+	nodes.push_back(BVHNode());
+	nodeObjects.insert(nodeObjects.end(), objectWords, 0ull);
+
+	vec3 boundsMin = vec3(FLT_MAX);
+	vec3 boundsMax = vec3(-FLT_MAX);
+	for (int i = first; i < first + count; i++) {
+		boundsMin = glm::min(boundsMin, buildTriangles[order[i]].boundsMin);
+		boundsMax = glm::max(boundsMax, buildTriangles[order[i]].boundsMax);
+	}
+	nodes[n].boundsMin = boundsMin;
+	nodes[n].boundsMax = boundsMax;
+
+	int axis = 0;
+	float split = 0;
+	float splitCost = count > 1 ? FindSplit(first, count, boundsMin, boundsMax, &axis, &split) : FLT_MAX;
+	int leftCount = 0;
+	if (depth >= BVH_MAX_DEPTH && count > BVH_MAX_LEAF_SIZE) {
+		// too deep, halve at the median of the longest axis
+		vec3 extent = boundsMax - boundsMin;
+		axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		leftCount = count / 2;
+		std::nth_element(&order[first], &order[first] + leftCount, &order[first] + count,
+			[&](int a, int b) { return buildTriangles[a].centroid[axis] < buildTriangles[b].centroid[axis]; });
+	}
+	else if (splitCost < float(count) || count > BVH_MAX_LEAF_SIZE) {
+		int* middle = std::partition(&order[first], &order[first] + count,
+			[&](int t) { return buildTriangles[t].centroid[axis] < split; });
+		leftCount = middle - &order[first];
+		// no useful split (centroids all in one place), halve the node
+		if (leftCount == 0 || leftCount == count) {
+			leftCount = count / 2;
+		}
+	}
+
+	if (leftCount == 0) {
+		nodes[n].rightOrFirst = first;
+		nodes[n].count = count;
+		for (int i = first; i < first + count; i++) {
+			int object = triangles[order[i]].object;
+			nodeObjects[n * objectWords + (object >> 6)] |= 1ull << (object & 63);
+		}
+		return n;
+	}
+
+	int left = Subdivide(first, leftCount, depth + 1);
+	int right = Subdivide(first + leftCount, count - leftCount, depth + 1);
+	nodes[n].rightOrFirst = right;
+	nodes[n].count = 0;
+	for (int w = 0; w < objectWords; w++) {
+		nodeObjects[n * objectWords + w] = nodeObjects[left * objectWords + w] | nodeObjects[right * objectWords + w];
+	}
+	return n;
+}
+
+// Binned surface area heuristic over all 3 axes. Returns the best split's
+// cost relative to one triangle test, FLT_MAX if there's no split.
+float TriangleBVH::FindSplit(int first, int count, vec3 boundsMin, vec3 boundsMax, int* axis, float* split) const {
+	vec3 centroidMin = vec3(FLT_MAX);
+	vec3 centroidMax = vec3(-FLT_MAX);
+	for (int i = first; i < first + count; i++) {
+		centroidMin = glm::min(centroidMin, buildTriangles[order[i]].centroid);
+		centroidMax = glm::max(centroidMax, buildTriangles[order[i]].centroid);
+	}
+
+	float bestCost = FLT_MAX;
+	for (int a = 0; a < 3; a++) {
+		float extent = centroidMax[a] - centroidMin[a];
+		if (extent <= 0) {
+			continue;
+		}
+		struct Bin {
+			vec3 boundsMin = vec3(FLT_MAX);
+			vec3 boundsMax = vec3(-FLT_MAX);
+			int count = 0;
+		} bins[BVH_BINS];
+		float scale = BVH_BINS / extent;
+		for (int i = first; i < first + count; i++) {
+			const BuildTriangle& triangle = buildTriangles[order[i]];
+			int b = glm::min(int((triangle.centroid[a] - centroidMin[a]) * scale), BVH_BINS - 1);
+			bins[b].boundsMin = glm::min(bins[b].boundsMin, triangle.boundsMin);
+			bins[b].boundsMax = glm::max(bins[b].boundsMax, triangle.boundsMax);
+			bins[b].count++;
+		}
+
+		// sweep from the left, then from the right, for the cost of each plane
+		float leftArea[BVH_BINS - 1];
+		int leftCount[BVH_BINS - 1];
+		vec3 sweepMin = vec3(FLT_MAX);
+		vec3 sweepMax = vec3(-FLT_MAX);
+		int sweepCount = 0;
+		for (int b = 0; b < BVH_BINS - 1; b++) {
+			sweepMin = glm::min(sweepMin, bins[b].boundsMin);
+			sweepMax = glm::max(sweepMax, bins[b].boundsMax);
+			sweepCount += bins[b].count;
+			leftArea[b] = SurfaceArea(sweepMin, sweepMax);
+			leftCount[b] = sweepCount;
+		}
+		sweepMin = vec3(FLT_MAX);
+		sweepMax = vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int b = BVH_BINS - 1; b > 0; b--) {
+			sweepMin = glm::min(sweepMin, bins[b].boundsMin);
+			sweepMax = glm::max(sweepMax, bins[b].boundsMax);
+			sweepCount += bins[b].count;
+			if (leftCount[b - 1] == 0 || sweepCount == 0) {
+				continue;
+			}
+			float cost = leftArea[b - 1] * leftCount[b - 1] + SurfaceArea(sweepMin, sweepMax) * sweepCount;
+			if (cost < bestCost) {
+				bestCost = cost;
+				*axis = a;
+				*split = centroidMin[a] + b / scale;
+			}
+		}
+	}
+
+	if (bestCost == FLT_MAX) {
+		return FLT_MAX;
+	}
+	float area = SurfaceArea(boundsMin, boundsMax);
+	return BVH_TRAVERSAL_COST + (area > 0 ? bestCost / area : float(count));
+}
+
+// Moller-Trumbore, hits within (0, maxT)
+bool TriangleBVH::IntersectTriangle(const BVHTriangle& triangle, vec3 origin, vec3 dir, float maxT, float* t) const {
+	vec3 h = glm::cross(dir, triangle.edge2);
+	float det = glm::dot(triangle.edge1, h);
+	if (glm::abs(det) < 1e-9f) {
+		return false;	// parallel
+	}
+	float invDet = 1.0f / det;
+	vec3 s = origin - triangle.v0;
+	float u = glm::dot(s, h) * invDet;
+	if (u < 0 || u > 1) {
+		return false;
+	}
+	vec3 q = glm::cross(s, triangle.edge1);
+	float v = glm::dot(dir, q) * invDet;
+	if (v < 0 || u + v > 1) {
+		return false;
+	}
+	float tHit = glm::dot(triangle.edge2, q) * invDet;
+	if (tHit <= 0 || tHit >= maxT) {
+		return false;
+	}
+	*t = tHit;
+	return true;
+}
+
+// Welds the triangles' vertices by position, then sums each vertex's face
+// normals weighted by the triangles' angles at it, and each edge's two face normals
+void TriangleBVH::BuildPseudoNormals(const vector<vec3>& triangleVertices) {
+	int numTriangles = triangleVertices.size() / 3;
+	features.resize(numTriangles);
+
+	vector<int> sortedVertices(triangleVertices.size());
+	for (unsigned int v = 0; v < sortedVertices.size(); v++) {
+		sortedVertices[v] = v;
+	}
+	auto Less = [&](int a, int b) {
+		vec3 pa = triangleVertices[a];
+		vec3 pb = triangleVertices[b];
+		return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+	};
+	std::sort(sortedVertices.begin(), sortedVertices.end(), Less);
+	vector<int> vertexIds(triangleVertices.size());
+	int numVertices = 0;
+	for (unsigned int i = 0; i < sortedVertices.size(); i++) {
+		if (i > 0 && Less(sortedVertices[i - 1], sortedVertices[i])) {
+			numVertices++;
+		}
+		vertexIds[sortedVertices[i]] = numVertices;
+	}
+	vertexNormals.assign(numVertices + 1, vec3(0.0f));
+	edgeNormals.clear();
+
+	std::unordered_map<unsigned long long, int> edgeIds;
+	for (int t = 0; t < numTriangles; t++) {
+		vec3 corners[3] = { triangleVertices[t * 3], triangleVertices[t * 3 + 1], triangleVertices[t * 3 + 2] };
+		vec3 faceNormal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		float area = glm::length(faceNormal);
+		faceNormal = area > 0 ? faceNormal / area : vec3(0.0f);
+
+		for (int c = 0; c < 3; c++) {
+			int id = vertexIds[t * 3 + c];
+			features[t].vertices[c] = id;
+			vec3 e1 = corners[(c + 1) % 3] - corners[c];
+			vec3 e2 = corners[(c + 2) % 3] - corners[c];
+			float lengths = glm::length(e1) * glm::length(e2);
+			if (lengths > 0) {
+				float angle = glm::acos(glm::clamp(glm::dot(e1, e2) / lengths, -1.0f, 1.0f));
+				vertexNormals[id] += angle * faceNormal;
+			}
+
+			int other = vertexIds[t * 3 + (c + 1) % 3];
+			unsigned long long key = (unsigned long long)glm::min(id, other) << 32 | (unsigned int)glm::max(id, other);
+			auto edge = edgeIds.find(key);
+			if (edge == edgeIds.end()) {
+				edge = edgeIds.insert({ key, int(edgeNormals.size()) }).first;
+				edgeNormals.push_back(vec3(0.0f));
+			}
+			edgeNormals[edge->second] += faceNormal;
+			features[t].edges[c] = edge->second;
+		}
+	}
+}
+
+// feature as given by ClosestPointOnTriangle
+vec3 TriangleBVH::PseudoNormal(int triangle, int feature) const {
+	if (feature < 3) {
+		return vertexNormals[features[triangle].vertices[feature]];
+	}
+	if (feature < 6) {
+		return edgeNormals[features[triangle].edges[feature - 3]];
+	}
+	return glm::cross(triangles[triangle].edge1, triangles[triangle].edge2);
+}
+
+// Number of triangles the ray crosses, however far away
+int TriangleBVH::CountHits(vec3 origin, vec3 dir) const {
+	if (nodes.empty()) {
+		return 0;
+	}
+	__m128 origin4 = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+	__m128 invDir4 = _mm_setr_ps(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z, 0.0f);
+
+	int hits = 0;
+	int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int n = stack[--stackSize];
+		const BVHNode& node = nodes[n];
+		if (RayNode(node, origin4, invDir4, FLT_MAX) == FLT_MAX) {
+			continue;
+		}
+		if (node.count > 0) {
+			for (int t = node.rightOrFirst; t < node.rightOrFirst + node.count; t++) {
+				float tHit;
+				if (IntersectTriangle(triangles[t], origin, dir, FLT_MAX, &tHit)) {
+					hits++;
+				}
+			}
+			continue;
+		}
+		stack[stackSize++] = node.rightOrFirst;
+		stack[stackSize++] = n + 1;
+	}
+	return hits;
+}
+
+// Real-Time Collision Detection (Ericson), 5.1.5
+vec3 ClosestPointOnTriangle(vec3 p, vec3 a, vec3 b, vec3 c, int* feature) {
+	int unused;
+	if (feature == nullptr) {
+		feature = &unused;
+	}
+	vec3 ab = b - a;
+	vec3 ac = c - a;
+	vec3 ap = p - a;
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	*feature = 0;
+	if (d1 <= 0 && d2 <= 0) return a;
+
+	vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	*feature = 1;
+	if (d3 >= 0 && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	*feature = 3;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		return a + ab * (d1 / (d1 - d3));
+	}
+
+	vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	*feature = 2;
+	if (d6 >= 0 && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	*feature = 5;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		return a + ac * (d2 / (d2 - d6));
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	*feature = 4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	*feature = 6;
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float w = vc * denom;
+	return a + ab * v + ac * w;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include <emmintrin.h>
+#include <unordered_map>
+
+using glm::vec3;
+using std::vector;
+using std::pair;
+
+// Bounding volume hierarchy over the static scene's world space triangles,
+// shared by bolt collision, shadow caster culling and the scene SDF bake.
+// Built with the surface area heuristic, nodes are stored depth first so
+// a node's left child is the next node, and every subtree's triangles are
+// contiguous.
+
+struct alignas(32) BVHNode {
+	vec3 boundsMin;
+	int rightOrFirst;	// right child for inner nodes, first triangle for leaves
+	vec3 boundsMax;
+	int count;			// number of triangles, 0 for inner nodes
+};
+
+// first vertex and edges, as used by the ray test
+struct BVHTriangle {
+	vec3 v0;
+	vec3 edge1;
+	vec3 edge2;
+	int object;
+};
+
+// Indices of the triangle's angle weighted pseudo-normals (Baerentzen and
+// Aanaes), shared with the triangles around the same vertex or edge.
+// Edges are v0-v1, v1-v2, v2-v0.
+struct BVHTriangleFeatures {
+	int vertices[3];
+	int edges[3];
+};
+
+struct BVHHit {
+	float t;			// distance along the ray
+	vec3 normal;		// face normal
+	int object;
+};
+
+class TriangleBVH {
+public:
+	// triangleVertices holds 3 vertices per triangle, triangleObjects the
+	// object (draw item) each triangle belongs to, or is empty for object 0.
+	void Build(const vector<vec3>& triangleVertices, const vector<int>& triangleObjects = {});
+
+	// closest hit along dir (normalised) within maxT
+	bool Intersect(vec3 origin, vec3 dir, float maxT, BVHHit* hit) const;
+	// any hit along dir (normalised) within maxT
+	bool Occluded(vec3 origin, vec3 dir, float maxT) const;
+	// Finds the closest point on any triangle within maxDistance of p,
+	// returns false if there is none. normal is the pseudo-normal of the
+	// face, edge or vertex the point is on, p is inside the geometry if it's
+	// behind it, even next to edges and corners.
+	bool ClosestPoint(vec3 p, float maxDistance, vec3* closest, vec3* normal) const;
+	// Sets bit object of mask (ObjectWords() words) for each object with any
+	// triangle within radius of center.
+	void SphereObjectMask(vec3 center, float radius, unsigned long long* mask) const;
+	// true if p is inside closed (non overlapping) geometry: most of a few
+	// rays cast upwards from it cross an odd number of triangles. Rays only go
+	// up so open ground below p isn't counted.
+	bool Inside(vec3 p) const;
+
+	// Batched queries, skipped entirely when the batch's bounds miss the scene.
+	// Fraction of the way along each segment of its first hit, -1 for no hit.
+	void IntersectSegments(const vector<pair<vec3, vec3>>& segments, vector<float>* hitFractions) const;
+	void OccludedSegments(const vector<pair<vec3, vec3>>& segments, vector<bool>* occluded) const;
+	// ObjectWords() words per center
+	void SphereObjectMasks(const vector<vec3>& centers, float radius, vector<unsigned long long>* masks) const;
+
+	vec3 BoundsMin() const;
+	vec3 BoundsMax() const;
+	int NumTriangles() const;
+	int NumNodes() const;
+	float BuildTime() const;
+
+	// words in an object mask, one bit per object
+	int ObjectWords() const;
+	bool MaskHasObject(const unsigned long long* mask, int object) const;
+
+private:
+	vector<BVHNode> nodes;
+	vector<unsigned long long> nodeObjects;	// objects in each node's subtree, ObjectWords() per node
+	int objectWords = 1;
+	vector<BVHTriangle> triangles;			// in leaf order
+	vector<BVHTriangleFeatures> features;	// in leaf order
+	vector<vec3> vertexNormals;
+	vector<vec3> edgeNormals;
+	float buildTime = 0;
+
+	// only used while building
+	struct BuildTriangle {
+		vec3 boundsMin;
+		vec3 boundsMax;
+		vec3 centroid;
+	};
+	vector<BuildTriangle> buildTriangles;
+	vector<int> order;
+
+	int Subdivide(int first, int count, int depth);
+	float FindSplit(int first, int count, vec3 boundsMin, vec3 boundsMax, int* axis, float* split) const;
+	bool IntersectTriangle(const BVHTriangle& triangle, vec3 origin, vec3 dir, float maxT, float* t) const;
+	void BuildPseudoNormals(const vector<vec3>& triangleVertices);
+	vec3 PseudoNormal(int triangle, int feature) const;
+	int CountHits(vec3 origin, vec3 dir) const;
+};
+
+// Closest point to p on the triangle abc. feature, if given, is set to the
+// part of the triangle it's on: 0-2 the vertices a, b, c, 3-5 the edges
+// ab, bc, ca, or 6 the face.
+vec3 ClosestPointOnTriangle(vec3 p, vec3 a, vec3 b, vec3 c, int* feature = nullptr);
@@ -0,0 +1,10 @@
+// Dual paraboloid shadow maps, shared by depth_dual_paraboloid.geom and shadows.glsl
+// ------------
+// hemisphere 0 looks down +z, 1 down -z, both like a right handed camera so
+// the winding stays the same. z of the result is the distance in front of the
+// hemisphere's plane, negative for the other hemisphere
+vec3 ParaboloidCoords(vec3 dir, int hemisphere) {
+    float forward = hemisphere == 0 ? dir.z : -dir.z;
+    float x = hemisphere == 0 ? -dir.x : dir.x;
+    return vec3(vec2(x, dir.y) / max(1.0 + forward, 1e-4), forward);
+}
@@ -0,0 +1,21 @@
+// Point Lights, shared by lighting_pass.frag and tiled_lighting.comp
+// ------------
+// Expects the includer to declare Linear, Quadratic and lightColor.
+vec3 PointLighting(vec3 lightPos, vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, float specularColor)
+{
+    // diffuse
+    vec3 lightDir = normalize(lightPos - fragPos);
+    vec3 diffuse = max(dot(normal, lightDir), 0.0) * diffuseColor * lightColor;
+
+    // specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    // TODO - control shininess
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 16.0);
+    vec3 specular = specularColor * spec * lightColor;
+
+    // attenuation
+    float distance = length(lightPos - fragPos);
+    float attenuation = 1.0 / (1.0 + Linear * distance + Quadratic * distance * distance);
+
+    return (diffuse + specular) * attenuation;
+}
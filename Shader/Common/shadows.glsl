@@ -0,0 +1,120 @@
+// Shadows, shared by lighting_pass.frag and tiled_lighting.comp
+// ------------
+// Expects the includer to declare viewPos and far_plane.
+#include "paraboloid.glsl"
+
+const int NUM_SHADOW_TIERS = 4;
+uniform samplerCubeArrayShadow depthMapTiers[NUM_SHADOW_TIERS];  // a depth cubemap array per shadow resolution
+uniform sampler2DArrayShadow paraboloidTiers[NUM_SHADOW_TIERS];  // or two paraboloid maps per light
+uniform bool dualParaboloid;    // which of the two the lights use
+uniform bool adaptivePCF;       // probe a few samples, take them all only in penumbras
+uniform bool shadows;           // Toggle shadows
+
+// array of offset direction for sampling, the first PROBE_SAMPLES are 
+// spread over a tetrahedron for the adaptive probe
+const int PCF_SAMPLES = 20;
+const int PROBE_SAMPLES = 4;
+vec3 gridSamplingDisk[PCF_SAMPLES] = vec3[]
+(
+   vec3(1, 1,  1), vec3(-1, -1,  1), vec3( 1, -1, -1), vec3(-1, 1, -1), 
+   vec3(1, -1, 1), vec3(-1,  1,  1), vec3( 1,  1, -1), vec3(-1, -1, -1),
+   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
+   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
+   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
+);
+const float bias = 0.15;   // bias is larger since depth is in [near_plane, far_plane] range
+
+// scale diskRadius with viewDistance, making shadows softer when far away
+// and sharper when close
+float DiskRadius(vec3 fragPos) {
+    float viewDistance = length(viewPos - fragPos);
+    return (1 + (viewDistance / far_plane)) / 25;
+}
+
+// shadow calculation for a single light, from an array of depth cubemaps
+float ShadowCalculation(vec3 fragPos, vec3 lightPos, samplerCubeArrayShadow depthMapArray, int lightIndex) {
+    // get the vector betweent the fragment position and the light positions
+    vec3 lightToFrag = fragPos-lightPos;
+
+    // the depth maps store the distance to the light over far_plane, each sample
+    // is compared with it and 2x2 filtered by the hardware, 1 is lit
+    float compareDepth = (length(lightToFrag) - bias) / far_plane;
+    float diskRadius = DiskRadius(fragPos);
+
+    // PCF
+    // Using the gridSamplingDisk array, we can take samples in roughly seperable
+    // directions to get a smoother shadow. A cheap probe comes first, if its 
+    // samples agree the pixel is fully lit or fully shadowed and we stop there.
+    float lit = 0;
+    for (int i = 0; i < PROBE_SAMPLES; i++) {
+        lit += texture(depthMapArray, vec4(lightToFrag + diskRadius * gridSamplingDisk[i], lightIndex), compareDepth);
+    }
+    int samples = PROBE_SAMPLES;
+    if (!adaptivePCF || (lit > 0.0 && lit < float(PROBE_SAMPLES))) {
+        for (int i = PROBE_SAMPLES; i < PCF_SAMPLES; i++) {
+            lit += texture(depthMapArray, vec4(lightToFrag + diskRadius * gridSamplingDisk[i], lightIndex), compareDepth);
+        }
+        samples = PCF_SAMPLES;
+    }
+
+    return 1.0 - lit / float(samples);
+}
+
+// one compared sample of a light's paraboloid maps
+float ParaboloidSample(sampler2DArrayShadow depthMap, vec3 lightToSample, int lightIndex, float compareDepth) {
+    vec3 dir = normalize(lightToSample);
+    int hemisphere = dir.z >= 0.0 ? 0 : 1;
+    vec2 uv = ParaboloidCoords(dir, hemisphere).xy * 0.5 + 0.5;
+    return texture(depthMap, vec4(uv, lightIndex * 2 + hemisphere, compareDepth));
+}
+
+// shadow calculation for a single light, from its two paraboloid maps, with
+// the same PCF samples as the cubemaps
+float ParaboloidShadowCalculation(vec3 fragPos, vec3 lightPos, sampler2DArrayShadow depthMap, int lightIndex) {
+    vec3 lightToFrag = fragPos - lightPos;
+    float compareDepth = (length(lightToFrag) - bias) / far_plane;
+    float diskRadius = DiskRadius(fragPos);
+
+    float lit = 0;
+    for (int i = 0; i < PROBE_SAMPLES; i++) {
+        lit += ParaboloidSample(depthMap, lightToFrag + diskRadius * gridSamplingDisk[i], lightIndex, compareDepth);
+    }
+    int samples = PROBE_SAMPLES;
+    if (!adaptivePCF || (lit > 0.0 && lit < float(PROBE_SAMPLES))) {
+        for (int i = PROBE_SAMPLES; i < PCF_SAMPLES; i++) {
+            lit += ParaboloidSample(depthMap, lightToFrag + diskRadius * gridSamplingDisk[i], lightIndex, compareDepth);
+        }
+        samples = PCF_SAMPLES;
+    }
+
+    return 1.0 - lit / float(samples);
+}
+
+// shadowMap is the light's tier * 256 + layer, -1 for unshadowed lights
+float LightShadow(vec3 fragPos, vec3 lightPos, int shadowMap)
+{
+    if (!shadows || shadowMap < 0)
+        return 0.0;
+    int layer = shadowMap % 256;
+    // sampler arrays can only be indexed with dynamically uniform values, and a
+    // stochastically picked light's tier differs from pixel to pixel, so each
+    // tier's samplers are named with a constant index
+    switch (shadowMap / 256) {
+    case 0:
+        return dualParaboloid ?
+            ParaboloidShadowCalculation(fragPos, lightPos, paraboloidTiers[0], layer) :
+            ShadowCalculation(fragPos, lightPos, depthMapTiers[0], layer);
+    case 1:
+        return dualParaboloid ?
+            ParaboloidShadowCalculation(fragPos, lightPos, paraboloidTiers[1], layer) :
+            ShadowCalculation(fragPos, lightPos, depthMapTiers[1], layer);
+    case 2:
+        return dualParaboloid ?
+            ParaboloidShadowCalculation(fragPos, lightPos, paraboloidTiers[2], layer) :
+            ShadowCalculation(fragPos, lightPos, depthMapTiers[2], layer);
+    default:
+        return dualParaboloid ?
+            ParaboloidShadowCalculation(fragPos, lightPos, paraboloidTiers[3], layer) :
+            ShadowCalculation(fragPos, lightPos, depthMapTiers[3], layer);
+    }
+}
@@ -3,10 +3,26 @@
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BlurColor;
 
+noperspective in float Across;      // pixels from the segment's line
+noperspective in float Along;       // pixels along the segment from its start
+noperspective in float HalfWidth;   // in pixels
+flat in float SegmentLength;        // in pixels
+noperspective in float Coverage;    // of ribbons thinner than a pixel
+
 uniform vec3 color;
 uniform float alpha;
+// the ribbons are max blended, which ignores the blend factors
+uniform bool premultiplied;
 
 void main() {
-    BlurColor = vec4(color, alpha);
-    FragColor = vec4(color, alpha);
-}
\ No newline at end of file
+    // analytic anti-aliasing: the fraction of the pixel inside the capsule
+    // around the segment, from the pixel's distance to it
+    float outside = max(-Along, 0.0) + max(Along - SegmentLength, 0.0);
+    float d = length(vec2(outside, Across));
+    float coverage = clamp(HalfWidth + 0.5 - d, 0.0, 1.0) * Coverage;
+
+    float a = alpha * coverage;
+    vec3 c = premultiplied ? color * a : color;
+    BlurColor = vec4(c, a);
+    FragColor = vec4(c, a);
+}
@@ -1,6 +1,6 @@
 #version 460 core 
 
-layout (location = 0) out vec3 gPosition;
+layout (location = 0) out vec4 gPosition;     // alpha is 0 where nothing was drawn
 layout (location = 1) out vec3 gNormal;
 layout (location = 2) out vec4 gAlbedoSpec;
 layout (location = 3) out vec3 gWorldPosition;
@@ -8,40 +8,39 @@ layout (location = 3) out vec3 gWorldPosition;
 in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
+flat in vec3 Color;
+flat in int Textured;
+flat in ivec3 MaterialLayers;   // diffuse, specular, normal. -1 if none
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_normal1;
-uniform sampler2D texture_specular1;
+uniform sampler2DArray materialTextures;
 
 uniform bool useDiffuse;
 uniform bool useNormal;
 uniform bool useSpecular;
 
-uniform vec3 color;
-
 void main()
 {    
     // Position
-    gPosition = FragPos;
+    gPosition = vec4(FragPos, 1.0);
 
     // Normal
-    if (useNormal) {
-            gNormal = texture(texture_normal1, TexCoords).rgb;
+    if (useNormal && Textured != 0 && MaterialLayers.z >= 0) {
+            gNormal = texture(materialTextures, vec3(TexCoords, MaterialLayers.z)).rgb;
     } else {
         gNormal = normalize(Normal);
 	}
 
     // Diffuse
-    if (useDiffuse) {
-		gAlbedoSpec.rgb = texture(texture_diffuse1, TexCoords).rgb;
+    if (useDiffuse && Textured != 0 && MaterialLayers.x >= 0) {
+		gAlbedoSpec.rgb = texture(materialTextures, vec3(TexCoords, MaterialLayers.x)).rgb;
 	} else {
-        gAlbedoSpec.rgb = color;
+        gAlbedoSpec.rgb = Color;
     }
 
     // Specualar
-    if (useSpecular) {
-		gAlbedoSpec.a = texture(texture_specular1, TexCoords).r;
+    if (useSpecular && Textured != 0 && MaterialLayers.y >= 0) {
+		gAlbedoSpec.a = texture(materialTextures, vec3(TexCoords, MaterialLayers.y)).r;
 	} else {
 		gAlbedoSpec.a = 1.0f;
 	}
-}
\ No newline at end of file
+}
\ No newline at end of file
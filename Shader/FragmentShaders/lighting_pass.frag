@@ -2,6 +2,7 @@
 
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BlurColor;
+layout (location = 2) out vec4 HistoryColor;   // lighting and distance from the camera, for the next frame
   
 in vec2 TexCoords;
 
@@ -9,14 +10,45 @@ uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
 
-uniform samplerCubeArray depthMapArray;
-
 const int MAX_NUM_LIGHTS = 300;
-uniform vec3 lightPositions[MAX_NUM_LIGHTS];    // light positions and depth cubemaps
+uniform vec3 lightPositions[MAX_NUM_LIGHTS];    // light positions
+uniform int shadowSlots[MAX_NUM_LIGHTS];        // each light's tier * 256 + depth cubemap, -1 for unshadowed lights
+// line lights, used instead of point lights when lineLights is set. lightPositions
+// holds their midpoints, which their shadows are taken from
+const int MAX_LINE_LIGHTS = 64;
+uniform bool lineLights;
+uniform vec3 lineStarts[MAX_LINE_LIGHTS];
+uniform vec3 lineEnds[MAX_LINE_LIGHTS];
+uniform float totalLineLength;
+// stochastic lights, used instead of the light arrays when stochasticLights is set.
+// lightSamples lights are picked per pixel from a light BVH, in proportion to their
+// estimated contribution. Must match LightBVHNode and LightBVHLight in LightBVH.h
+struct LightNode {
+    vec3 boundsMin;
+    int rightOrFirst;   // right child for inner nodes, first light for leaves
+    vec3 boundsMax;
+    int count;          // number of lights, 0 for inner nodes
+    float intensity;
+};
+struct TreeLight {
+    vec3 position;
+    int shadowMap;      // tier * 256 + layer, -1 for unshadowed lights
+};
+layout (std430, binding = 3) readonly buffer LightNodes { LightNode lightNodes[]; };
+layout (std430, binding = 4) readonly buffer TreeLights { TreeLight treeLights[]; };
+uniform bool stochasticLights;
+uniform int lightSamples;
+uniform int frameIndex;
+// the noise is resolved by blending with the last frames' lighting, reprojected
+uniform bool temporalAccumulation;
+uniform float historyWeight;    // weight of this frame
+uniform bool historyValid;      // false when the lights changed completely
+uniform sampler2D lightHistory;
+uniform mat4 prevViewProjection;
+uniform vec3 prevViewPos;
 uniform vec3 viewPos;
 uniform float far_plane;
 uniform int numLightsActive;
-uniform bool shadows;           // Toggle shadows
 uniform bool bloomEnabled;      // Toggle drawing to blur buffer
 
 // attenuation and color parameters are constatnt for all lights 
@@ -24,7 +56,11 @@ uniform float Linear;
 uniform float Quadratic;
 uniform vec3 lightColor;
 
-float ShadowCalculation(vec3 fragPos, vec3 lightPos, samplerCubeArray depthMap, int lightIndex);
+#include "../Common/shadows.glsl"
+#include "../Common/point_light.glsl"
+
+vec3 LineLighting(int i, vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, float specularColor);
+vec3 StochasticLighting(vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, float specularColor);
 
 void main()
 {             
@@ -39,35 +75,49 @@ void main()
     // then calculate lighting
     vec3 lighting = vec3(0);
     vec3 viewDir = normalize(viewPos - FragPos);
-    for(int i = 0; i < numLightsActive; ++i)
+    if (stochasticLights)
+    {
+        lighting = StochasticLighting(FragPos, Normal, viewDir, Diffuse, Specular);
+    }
+    else if (lineLights)
     {
-        // diffuse
-        vec3 lightDir = normalize(lightPositions[i] - FragPos);
-        vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lightColor;
-        
-        // specular
-        vec3 halfwayDir = normalize(lightDir + viewDir);
-        // TODO - control shininess
-        float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-        vec3 specular = Specular * spec * lightColor;
-
-        // attenuation
-        float distance = length(lightPositions[i] - FragPos);
-        float attenuation = 1.0 / (1.0 + Linear * distance + Quadratic * distance * distance);
-
-        // calculate shadow
-        float shadow = shadows ? ShadowCalculation(FragPos, lightPositions[i], depthMapArray, i) : 0.0;
-
-        diffuse *= attenuation;
-        specular *= attenuation;
-        //lighting += diffuse + specular;
-        lighting += (ambient + (1.0 - shadow) * (diffuse + specular));
+        for(int i = 0; i < numLightsActive; ++i)
+        {
+            float shadow = LightShadow(FragPos, lightPositions[i], shadowSlots[i]);
+            lighting += (ambient + (1.0 - shadow) * LineLighting(i, FragPos, Normal, viewDir, Diffuse, Specular));
+        }
+    }
+    else
+    {
+        for(int i = 0; i < numLightsActive; ++i)
+        {
+            float shadow = LightShadow(FragPos, lightPositions[i], shadowSlots[i]);
+            //lighting += diffuse + specular;
+            lighting += (ambient + (1.0 - shadow) * PointLighting(lightPositions[i], FragPos, Normal, viewDir, Diffuse, Specular));
+        }
     }
 
     // FragColor = vec4(FragPos, 1.0); // visualize positions
     // FragColor = vec4(Normal, 1.0); // visualize normals
     // FragColor = vec4(Diffuse, 1.0); // visualize diffuse
-    lighting = lighting / float(numLightsActive); // average the light colors
+    // average the light colors, line lights are already averaged over their length
+    if (!lineLights || stochasticLights)
+        lighting = lighting / float(max(numLightsActive, 1));
+
+    // blend with the last frame's lighting at the same point, unless it was
+    // hidden or off screen (its distance from the camera doesn't match)
+    float cameraDistance = length(FragPos - viewPos);
+    if (stochasticLights && temporalAccumulation && historyValid) {
+        vec4 prevClip = prevViewProjection * vec4(FragPos, 1.0);
+        vec2 prevCoords = prevClip.xy / prevClip.w * 0.5 + 0.5;
+        vec4 history = texture(lightHistory, prevCoords);
+        float prevDistance = length(FragPos - prevViewPos);
+        bool onScreen = prevClip.w > 0.0 && all(greaterThanEqual(prevCoords, vec2(0.0))) && all(lessThanEqual(prevCoords, vec2(1.0)));
+        if (onScreen && abs(history.a - prevDistance) < 0.05 * prevDistance) {
+            lighting = mix(history.rgb, lighting, historyWeight);
+        }
+    }
+    HistoryColor = vec4(lighting, cameraDistance);
     
     // Bloom
     // check whether lighting is higher than some threshhold. If so, draw to blur buffer (tcbo[1])
@@ -82,61 +132,154 @@ void main()
     FragColor = vec4(lighting, 1.0);
 }
 
-// array of offset direction for sampling
-vec3 gridSamplingDisk[20] = vec3[]
-(
-   vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1), 
-   vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
-   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
-   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
-   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
-);
-
-// shadow calculation for a single light, from an array of depth cubemaps
-float ShadowCalculation(vec3 fragPos, vec3 lightPos, samplerCubeArray depthMapArray, int lightIndex) {
-    // get the vector betweent the fragment position and the light positions
-    vec3 lightToFrag = fragPos-lightPos;
-        
-    // get the current linear depth from the length between light and 
-    // fragment positions
-    float currentDepth = length(lightToFrag);
-
-    // use the vector to sample from the depthMap
-    //float closestDepth = texture(depthMapArray, vec4(lightToFrag, lightIndex)).r;
-
-    // closestDepth is in linear range [0,1] so we need to convert it to 
-    // the original depth value[0, far_plane]
-    //closestDepth *= far_plane;
-
-    // test for shadow:
-    //float bias = 0.05; // bias is larger since depth is in [near_plane, far_plane] range
-    // if the currentDepth is larger (further from lightPos) than the closestDepth, then
-    // the fragment is in shadow.
-    //float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-
-    // PCF
-    // Using the gridSamplingDisk array, we can take samples in roughly seperable
-    // directions to get a smoother shadow without sampling uneccessarily close
-    // to the original vec3 lightToFrag.
-    float shadow = 0;
-    float bias = 0.15;
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    // scale diskRadius with viewDistance, making shadows softer when far away
-    // and sharper when close
-    float diskRadius = (1 + (viewDistance / far_plane)) / 25;
-    for (int i = 0; i < samples; i++) {
-        float closestDepth = texture(depthMapArray, 
-        vec4(lightToFrag + diskRadius * gridSamplingDisk[i], lightIndex)).r;
-        closestDepth *= far_plane;
-        if (currentDepth - bias > closestDepth) {
-            shadow += 1;
+// Line Lights
+// ------------
+// The integral of N.L / distance^2 along the line from start to end, in closed 
+// form. With L(t) = start + t * (end - start) - fragPos, t in [0, 1].
+float LineIrradiance(vec3 fragPos, vec3 normal, vec3 start, vec3 end)
+{
+    vec3 L0 = start - fragPos;
+    vec3 D = end - start;
+    float a = dot(D, D);
+    float b = 2.0 * dot(L0, D);
+    float c = dot(L0, L0);
+    // zero only when fragPos is on the line itself
+    float disc = max(4.0 * a * c - b * b, 1e-6);
+    float nL0 = dot(normal, L0);
+    float nD = dot(normal, D);
+    float F1 = (nL0 * (2.0 * a + b) - nD * (b + 2.0 * c)) / sqrt(a + b + c);
+    float F0 = (nL0 * b - nD * 2.0 * c) / sqrt(c);
+    // parts of the line below the surface subtract, it's clamped rather than clipped
+    return max(2.0 * (F1 - F0) / disc * sqrt(a), 0.0);
+}
+
+vec3 ClosestPointOnLine(vec3 p, vec3 start, vec3 end)
+{
+    vec3 D = end - start;
+    float t = clamp(dot(p - start, D) / max(dot(D, D), 1e-6), 0.0, 1.0);
+    return start + t * D;
+}
+
+// Lighting from line light i, matching the average of point lights spread evenly 
+// along all the lines. Far away a point light's attenuation is about 1 / (Quadratic * d^2),
+// so the diffuse is the line's irradiance scaled by the real attenuation at its closest 
+// point over that. The specular comes from the point on the line closest to the
+// reflected view ray.
+vec3 LineLighting(int i, vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, float specularColor)
+{
+    vec3 start = lineStarts[i];
+    vec3 end = lineEnds[i];
+    float lineLength = length(end - start);
+
+    // diffuse
+    float distance = length(ClosestPointOnLine(fragPos, start, end) - fragPos);
+    float attenuation = 1.0 / (1.0 + Linear * distance + Quadratic * distance * distance);
+    float irradiance = LineIrradiance(fragPos, normal, start, end) * distance * distance * attenuation;
+    vec3 diffuse = irradiance / totalLineLength * diffuseColor * lightColor;
+
+    // specular
+    vec3 R = reflect(-viewDir, normal);
+    vec3 L0 = start - fragPos;
+    vec3 D = end - start;
+    float RoD = dot(R, D);
+    float t = (dot(R, L0) * RoD - dot(L0, D)) / max(dot(D, D) - RoD * RoD, 1e-6);
+    vec3 toLight = L0 + clamp(t, 0.0, 1.0) * D;
+    float specDistance = length(toLight);
+    vec3 halfwayDir = normalize(toLight / max(specDistance, 1e-4) + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 16.0);
+    float specAttenuation = 1.0 / (1.0 + Linear * specDistance + Quadratic * specDistance * specDistance);
+    vec3 specular = specularColor * spec * lightColor * specAttenuation * lineLength / totalLineLength;
+
+    return diffuse + specular;
+}
+
+// Stochastic Lights
+// ------------
+// PCG hash, a different sequence per pixel and frame
+float Random(inout uint state)
+{
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return float((word >> 22u) ^ word) / 4294967296.0;
+}
+
+// Estimated contribution of lights within the bounds: their intensity attenuated
+// from the bounds' center, but no closer than the bounds' radius, and none if
+// they're all below the surface
+float BoundsImportance(vec3 boundsMin, vec3 boundsMax, float intensity, vec3 fragPos, vec3 normal)
+{
+    vec3 toCenter = 0.5 * (boundsMin + boundsMax) - fragPos;
+    float radius = 0.5 * length(boundsMax - boundsMin);
+    if (dot(normal, toCenter) < -radius)
+        return 0.0;
+    float distanceSq = max(dot(toCenter, toCenter), radius * radius);
+    float distance = sqrt(distanceSq);
+    return intensity / (1.0 + Linear * distance + Quadratic * distanceSq);
+}
+
+float NodeImportance(int node, vec3 fragPos, vec3 normal)
+{
+    return BoundsImportance(lightNodes[node].boundsMin, lightNodes[node].boundsMax, lightNodes[node].intensity, fragPos, normal);
+}
+
+// Walks down the light tree picking a child in proportion to its importance,
+// then a light in the leaf the same way. Returns -1 if no light can contribute.
+int SampleLight(vec3 fragPos, vec3 normal, inout uint state, out float pdf)
+{
+    pdf = 1.0;
+    int node = 0;
+    while (lightNodes[node].count == 0) {
+        int left = node + 1;
+        int right = lightNodes[node].rightOrFirst;
+        float leftImportance = NodeImportance(left, fragPos, normal);
+        float rightImportance = NodeImportance(right, fragPos, normal);
+        float total = leftImportance + rightImportance;
+        if (total <= 0.0)
+            return -1;
+        float pLeft = leftImportance / total;
+        if (Random(state) < pLeft) {
+            node = left;
+            pdf *= pLeft;
+        } else {
+            node = right;
+            pdf *= 1.0 - pLeft;
         }
     }
-    shadow /= float(samples);
 
-    // display closestDepth to visualize the depth cubemap
-    //FragColor = vec4(vec3(closestDepth/far_plane), 1.0);
+    int first = lightNodes[node].rightOrFirst;
+    int count = lightNodes[node].count;
+    float total = 0.0;
+    for (int i = first; i < first + count; i++)
+        total += BoundsImportance(treeLights[i].position, treeLights[i].position, 1.0, fragPos, normal);
+    if (total <= 0.0)
+        return -1;
+    float pick = Random(state) * total;
+    for (int i = first; i < first + count; i++) {
+        float importance = BoundsImportance(treeLights[i].position, treeLights[i].position, 1.0, fragPos, normal);
+        if (pick < importance || i == first + count - 1) {
+            pdf *= importance / total;
+            return i;
+        }
+        pick -= importance;
+    }
+    return -1;
+}
 
-    return shadow;
+// Unbiased estimate of the sum over all the lights from lightSamples of them
+vec3 StochasticLighting(vec3 fragPos, vec3 normal, vec3 viewDir, vec3 diffuseColor, float specularColor)
+{
+    if (numLightsActive == 0)
+        return vec3(0.0);
+    uint state = uint(gl_FragCoord.x) * 1973u + uint(gl_FragCoord.y) * 9277u + uint(frameIndex) * 26699u;
+    vec3 lighting = vec3(0.0);
+    for (int s = 0; s < lightSamples; s++) {
+        float pdf;
+        int light = SampleLight(fragPos, normal, state, pdf);
+        if (light < 0 || pdf <= 0.0)
+            continue;
+        vec3 lightPos = treeLights[light].position;
+        float shadow = LightShadow(fragPos, lightPos, treeLights[light].shadowMap);
+        lighting += (1.0 - shadow) * PointLighting(lightPos, fragPos, normal, viewDir, diffuseColor, specularColor) / pdf;
+    }
+    return lighting / float(lightSamples);
 }
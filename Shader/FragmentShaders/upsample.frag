@@ -0,0 +1,69 @@
+#version 460 core
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BlurColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D lowResLighting;   // lighting pass output at 1/2 or 1/4 resolution
+
+uniform vec3 viewPos;
+uniform bool bloomEnabled;          // Toggle drawing to blur buffer
+
+// Bilateral upsampling: each pixel blends the 4 low resolution texels around it,
+// weighted bilinearly and by how similar their depth and normal are to its own,
+// so lighting doesn't leak across edges. The lighting pass read the g-buffer at
+// each texel's center, so that's where their depth and normal are read from.
+void main()
+{
+    vec3 FragPos = texture(gPosition, TexCoords).rgb;
+    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    float depth = length(FragPos - viewPos);
+
+    vec2 lowResSize = vec2(textureSize(lowResLighting, 0));
+    vec2 texel = TexCoords * lowResSize - 0.5;
+    ivec2 base = ivec2(floor(texel));
+    vec2 f = texel - vec2(base);
+
+    vec3 lighting = vec3(0.0);
+    float totalWeight = 0.0;
+    // used if none of them are similar, e.g. on geometry thinner than a texel
+    vec3 closestLighting = vec3(0.0);
+    float closestDepth = 1e30;
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            ivec2 coord = clamp(base + ivec2(x, y), ivec2(0), ivec2(lowResSize) - 1);
+            vec2 coords = (vec2(coord) + 0.5) / lowResSize;
+            vec3 samplePos = texture(gPosition, coords).rgb;
+            vec3 sampleNormal = texture(gNormal, coords).rgb;
+            vec3 sampleLighting = texelFetch(lowResLighting, coord, 0).rgb;
+
+            float depthDifference = abs(length(samplePos - viewPos) - depth);
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float depthWeight = exp(-depthDifference / (0.01 * depth + 0.001));
+            float normalWeight = pow(max(dot(sampleNormal, Normal), 0.0), 8.0);
+            float weight = bilinear * depthWeight * normalWeight;
+
+            lighting += weight * sampleLighting;
+            totalWeight += weight;
+            if (depthDifference < closestDepth) {
+                closestDepth = depthDifference;
+                closestLighting = sampleLighting;
+            }
+        }
+    }
+    lighting = totalWeight > 1e-6 ? lighting / totalWeight : closestLighting;
+
+    // Bloom, as in the lighting pass
+    if (bloomEnabled) {
+        float brightness = dot(lighting, vec3(0.2126, 0.7152, 0.0722));
+        if (brightness > 1.0) {
+            BlurColor = vec4(lighting, 1.0);
+        } else {
+            BlurColor = vec4(0.0, 0.0, 0.0, 1.0);
+        }
+    }
+    FragColor = vec4(lighting, 1.0);
+}
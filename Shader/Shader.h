@@ -9,6 +9,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 class Shader
 {
@@ -22,38 +23,15 @@ public:
 		std::string fragmentCode;
 		std::string geometryCode;
 
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-		std::ifstream gShaderFile;
-
-		// ensure ifstream object can throw exceptions:
-		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
 		bool geometryPresent = (geometryPath != nullptr);
 
 		try {
-			// open files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			std::stringstream vShaderStream, fShaderStream;
-			// read file's buffer contents into streams
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// convert file handlers
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			// read the files, with their includes
+			vertexCode = ReadSource(vertexPath);
+			fragmentCode = ReadSource(fragmentPath);
 			// load geometry shader if present
 			if (geometryPresent) {
-				gShaderFile.open(geometryPath);
-				std::stringstream gShaderStream;
-				gShaderStream << gShaderFile.rdbuf();
-				gShaderFile.close();
-				geometryCode = gShaderStream.str();
+				geometryCode = ReadSource(geometryPath);
 			}
 		}
 		catch (std::ifstream::failure& e) {
@@ -99,6 +77,28 @@ public:
 
 	};
 
+	// compute shader constructor, the program only has the one stage
+	// ------------------------------------------------------------------------
+	explicit Shader(const char* computePath) {
+		std::string computeCode;
+		try {
+			computeCode = ReadSource(computePath);
+		}
+		catch (std::ifstream::failure& e) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+		}
+		const char* cShaderCode = computeCode.c_str();
+		unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(compute, 1, &cShaderCode, NULL);
+		glCompileShader(compute);
+		CheckCompileErrors(compute, "COMPUTE");
+		ID = glCreateProgram();
+		glAttachShader(ID, compute);
+		glLinkProgram(ID);
+		CheckCompileErrors(ID, "PROGRAM");
+		glDeleteShader(compute);
+	};
+
 	unsigned int GetID() {
 		return ID;
 	}
@@ -130,7 +130,67 @@ public:
 		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
 	}
 
+	void SetVec2(const std::string &name, const glm::vec2 &value) const {
+		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	}
+
+	void SetIVec2(const std::string &name, int x, int y) const {
+		glUniform2i(glGetUniformLocation(ID, name.c_str()), x, y);
+	}
+
 private:
+	// Reads a shader's source, replacing each #include "file" line with the file's
+	// source. Paths are relative to the including file, and each file is only
+	// included once. #line directives keep the compiler's line numbers right, with
+	// the file's number in the order it was included (the shader itself is 0).
+	// Throws std::ifstream::failure if a file can't be read.
+	static std::string ReadSource(const std::string& path) {
+		std::vector<std::string> included;
+		return ReadSource(path, &included);
+	}
+
+	static std::string ReadSource(const std::string& path, std::vector<std::string>* included) {
+		int fileNumber = included->size();
+		included->push_back(path);
+
+		std::ifstream file;
+		file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		file.open(path);
+		std::stringstream stream;
+		stream << file.rdbuf();
+		file.close();
+
+		std::string directory = path.substr(0, path.find_last_of("\\/") + 1);
+		std::stringstream source;
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(stream, line)) {
+			lineNumber++;
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+				source << line << "\n";
+				continue;
+			}
+			size_t open = line.find('"', start);
+			size_t close = line.find('"', open + 1);
+			if (open == std::string::npos || close == std::string::npos) {
+				std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << ":" << lineNumber << std::endl;
+				continue;
+			}
+			std::string includePath = directory + line.substr(open + 1, close - open - 1);
+			bool done = false;
+			for (const std::string& other : *included) {
+				done = done || other == includePath;
+			}
+			if (!done) {
+				source << "#line 1 " << included->size() << "\n";
+				source << ReadSource(includePath, included);
+				source << "#line " << lineNumber + 1 << " " << fileNumber << "\n";
+			}
+		}
+		return source.str();
+	}
+
 	// utility function for checking shader compilation / linking errors.
 	void CheckCompileErrors(GLuint shader, std::string type) {
 		GLint success;
@@ -5,6 +5,18 @@ layout (location = 0) in vec3 aPos;
 uniform mat4 projection;
 uniform mat4 view;
 
+// lines are always fully covered, see bolt_ribbon.vert
+noperspective out float Across;
+noperspective out float Along;
+noperspective out float HalfWidth;
+flat out float SegmentLength;
+noperspective out float Coverage;
+
 void main() {
+	Across = 0.0;
+	Along = 0.0;
+	HalfWidth = 1.0;
+	SegmentLength = 0.0;
+	Coverage = 1.0;
 	gl_Position = projection * view * vec4(aPos, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,84 @@
+#version 460 core
+
+// Camera facing ribbons pulled from the bolt mesh's segments: 6 vertices (two
+// triangles) per segment and no vertex attributes. Each segment's quad is
+// expanded in screen space, a pixel past its width and past its ends, so
+// bolt.frag can anti-alias its edges and round its ends to fill the joints.
+layout (std430, binding = 5) readonly buffer BoltSegments {
+    float segmentData[];    // two vec3s per segment
+};
+layout (std430, binding = 9) readonly buffer BranchDepths {
+    int branchDepths[];
+};
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec2 screenSize;
+uniform float width;        // world space width of the main channel
+uniform float taper;        // fraction of the width kept at each branching
+
+noperspective out float Across;
+noperspective out float Along;
+noperspective out float HalfWidth;
+flat out float SegmentLength;
+noperspective out float Coverage;
+
+const float NEAR_W = 0.01;
+// thinner ribbons are drawn this wide and faded instead
+const float MIN_HALF_WIDTH = 0.5;
+
+// end of the segment and side of the ribbon of each vertex
+const ivec2 corners[6] = ivec2[](ivec2(0, -1), ivec2(1, -1), ivec2(1, 1),
+                                 ivec2(0, -1), ivec2(1, 1), ivec2(0, 1));
+
+vec3 SegmentEnd(int segment, int end)
+{
+    int i = segment * 6 + end * 3;
+    return vec3(segmentData[i], segmentData[i + 1], segmentData[i + 2]);
+}
+
+void main()
+{
+    int segment = gl_VertexID / 6;
+    int end = corners[gl_VertexID % 6].x;
+    float side = float(corners[gl_VertexID % 6].y);
+
+    mat4 viewProjection = projection * view;
+    vec4 a = viewProjection * vec4(SegmentEnd(segment, 0), 1.0);
+    vec4 b = viewProjection * vec4(SegmentEnd(segment, 1), 1.0);
+
+    // clipped to the part in front of the camera, behind it is a degenerate triangle
+    if (a.w < NEAR_W && b.w < NEAR_W) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+    if (a.w < NEAR_W)
+        a = mix(a, b, (NEAR_W - a.w) / (b.w - a.w));
+    else if (b.w < NEAR_W)
+        b = mix(b, a, (NEAR_W - b.w) / (a.w - b.w));
+    vec2 s0 = (a.xy / a.w * 0.5 + 0.5) * screenSize;
+    vec2 s1 = (b.xy / b.w * 0.5 + 0.5) * screenSize;
+
+    vec2 direction = s1 - s0;
+    float segmentLength = length(direction);
+    direction = segmentLength > 1e-4 ? direction / segmentLength : vec2(1.0, 0.0);
+    vec2 normal = vec2(-direction.y, direction.x);
+
+    // tapered by branch depth, in pixels at this end
+    vec4 clip = end == 0 ? a : b;
+    float worldHalfWidth = 0.5 * width * pow(taper, float(branchDepths[segment]));
+    float halfWidth = worldHalfWidth * 0.5 * screenSize.y * projection[1][1] / clip.w;
+    Coverage = min(halfWidth / MIN_HALF_WIDTH, 1.0);
+    halfWidth = max(halfWidth, MIN_HALF_WIDTH);
+
+    // one more pixel for the anti-aliased edge
+    float extent = halfWidth + 1.0;
+    float along = end == 0 ? -extent : segmentLength + extent;
+    vec2 position = s0 + direction * along + normal * side * extent;
+
+    Across = side * extent;
+    Along = along;
+    HalfWidth = halfWidth;
+    SegmentLength = segmentLength;
+    gl_Position = vec4((position / screenSize * 2.0 - 1.0) * clip.w, clip.z, clip.w);
+}
@@ -2,8 +2,37 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+// per draw data from the scene's draw list
+struct DrawData {
+    mat4 model;
+    mat4 normalMatrix;
+    vec4 color;
+    ivec4 flags;
+};
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+// per draw command data, indexed by the command's base instance
+struct MeshDraw {
+    int drawIndex;
+    int diffuseLayer;
+    int specularLayer;
+    int normalLayer;
+};
+layout (std430, binding = 1) readonly buffer MeshDrawBuffer {
+    MeshDraw meshDraws[];
+};
+
+// cubemap face mask of each command in the light's command list
+layout (std430, binding = 2) readonly buffer DrawParamBuffer {
+    int faceMasks[];
+};
+uniform int firstDraw;  // offset of the light's commands
+
+flat out int FaceMask;
 
 void main() {
-	gl_Position = model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+	FaceMask = faceMasks[firstDraw + gl_DrawID];
+	gl_Position = draws[meshDraws[gl_BaseInstance].drawIndex].model * vec4(aPos, 1.0);
+}
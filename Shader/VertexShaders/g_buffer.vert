@@ -7,21 +7,49 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
+flat out vec3 Color;
+flat out int Textured;
+flat out ivec3 MaterialLayers;  // diffuse, specular, normal
+
+// per draw data from the scene's draw list
+struct DrawData {
+    mat4 model;
+    mat4 normalMatrix;
+    vec4 color;
+    ivec4 flags;    // x: textured, y: reverse normals
+};
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+// per draw command data, indexed by the command's base instance
+struct MeshDraw {
+    int drawIndex;
+    int diffuseLayer;
+    int specularLayer;
+    int normalLayer;
+};
+layout (std430, binding = 1) readonly buffer MeshDrawBuffer {
+    MeshDraw meshDraws[];
+};
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
-uniform bool reverse_normals;
-
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    MeshDraw meshDraw = meshDraws[gl_BaseInstance];
+    DrawData draw = draws[meshDraw.drawIndex];
+
+    vec4 worldPos = draw.model * vec4(aPos, 1.0);
     FragPos = worldPos.xyz; 
     TexCoords = aTexCoords;
+    Color = draw.color.rgb;
+    Textured = draw.flags.x;
+    MaterialLayers = ivec3(meshDraw.diffuseLayer, meshDraw.specularLayer, meshDraw.normalLayer);
     
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-    if (reverse_normals) // reverse normals. For if we're inside the mesh
+    mat3 normalMatrix = mat3(draw.normalMatrix);
+    if (draw.flags.y != 0) // reverse normals. For if we're inside the mesh
     {
 		Normal = normalMatrix * (-1 * aNormal);
 	} else {
@@ -29,4 +57,4 @@ void main()
 	}
 
     gl_Position = projection * view * worldPos;
-}
\ No newline at end of file
+}
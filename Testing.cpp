@@ -2,12 +2,22 @@
 
 void TestBoltGeneration();
 void TestLightingPass();
+void TestDBMSolver();
+void TestSceneBVH();
+void TestLightBVH();
+void TestBoltLOD();
 
 void RunNumSegs(int numSegs, int count);
 void RunDetail(int detail, int count);
 void RunLSystem(int count, vector<pair<vec3, vec3>>* patternPtr);
 void RunPSystem(int count, vector<pair<vec3, vec3>>* patternPtr);
 void RunRandom(int count, vector<pair<vec3, vec3>>* patternPtr);
+void RunDBMSolve(int gridSize, int count);
+void RunDBM(int gridSize, int count, vector<pair<vec3, vec3>>* patternPtr, bool sparse = false);
+float RunSparseAgreement(int gridSize);
+void RunBVHQueries(const TriangleBVH& bvh, int numQueries);
+void RunColonization(int numAttractors, int count, vector<pair<vec3, vec3>>* patternPtr);
+void RunBoltLOD(int method, float distance, int count, vector<pair<vec3, vec3>>* patternPtr);
 
 using std::chrono::high_resolution_clock;
 using std::chrono::duration_cast;
@@ -19,8 +29,9 @@ void BeginTesting() {
 
 void TestLightingPass() {
 	Shader shader = LoadShader("depth.vert", "depth.frag", "depth_multiple_cubemap.geom");
+	Shader paraboloidShader = LoadShader("depth.vert", "depth.frag", "depth_dual_paraboloid.geom");
 	LightManager lm;
-	lm.Init(&shader);
+	lm.Init(&shader, &paraboloidShader);
 
 	// generate a random pattern
 	vector<pair<vec3, vec3>> pattern;
@@ -33,7 +44,8 @@ void TestLightingPass() {
 	lm.SetLightPositions(lightsPtr);
 
 	// render depth maps
-	lm.RenderDepthMaps();
+	lm.ClearDepthMaps();
+	lm.RenderDirtyDepthMaps(mat4(1.0f), vec3(0.0f));
 }
 
 void TestBoltGeneration() {
@@ -53,6 +65,13 @@ void TestBoltGeneration() {
 	for (int i = 100; i < segs + 1; i += 100) {
 		RunNumSegs(i, count);
 	}
+
+	// 1000 - 64000 . Attractors
+	vector<pair<vec3, vec3>> pattern;
+	std::cout << "Space Colonization" << std::endl;
+	for (int attractors = 1000; attractors <= 64000; attractors *= 2) {
+		RunColonization(attractors, count / 100, &pattern);
+	}
 }
 
 void RunNumSegs(int numSegs, int count) {
@@ -133,4 +152,331 @@ void RunRandom(int count, vector<pair<vec3, vec3>>* patternPtr) {
 	}
 
 	std::cout << sum / double(count) << " ms" << std::endl;
-}
\ No newline at end of file
+}
+
+void TestDBMSolver() {
+	// number of times to run
+	int count = 10;
+
+	// 16 - 128 . Grid Size
+	std::cout << "DBM Solver" << std::endl;
+	for (int size = 16; size <= 128; size += 16) {
+		RunDBMSolve(size, count);
+	}
+
+	vector<pair<vec3, vec3>> pattern;
+	std::cout << "DBM Pattern" << std::endl;
+	for (int size = 16; size <= 64; size += 16) {
+		RunDBM(size, count, &pattern);
+	}
+
+	// 64 - 256 . Grid Size, narrow band only
+	std::cout << "DBM Pattern (Sparse Grid)" << std::endl;
+	for (int size = 64; size <= 256; size += 64) {
+		RunDBM(size, count, &pattern, true);
+	}
+
+	// 16 - 64 . Grid Size, the sparse grid must match the dense solver
+	std::cout << "Sparse Grid vs Dense Solver" << std::endl;
+	for (int size = 16; size <= 64; size += 16) {
+		float difference = RunSparseAgreement(size);
+		std::cout << std::endl << size << std::endl;
+		std::cout << "Max Difference: " << difference << (difference <= 1e-6f ? " (ok)" : " (ERROR: over 1e-6)") << std::endl;
+	}
+}
+
+// Solves the same channel with the dense solver and the sparse grid, with a
+// band covering the whole grid so every block is solved, for the same number
+// of iterations. Returns the largest difference in any cell's potential.
+float RunSparseAgreement(int gridSize) {
+	int numThreads = std::thread::hardware_concurrency();
+	LaplaceSolver dense;
+	SparseGrid sparse;
+	dense.Init(gridSize, numThreads);
+	sparse.Init(gridSize, numThreads);
+	int n = dense.Size();
+	sparse.SetBandRadius(n / GRID_BLOCK_SIZE);
+
+	// a channel down from the top, and a branch off it
+	for (int y = n; y > n / 2; y--) {
+		dense.SetFixed(ivec3(n / 2, y, n / 2), 0.0f);
+		sparse.SetFixed(ivec3(n / 2, y, n / 2), 0.0f);
+	}
+	for (int x = n / 2; x > n / 4; x--) {
+		dense.SetFixed(ivec3(x, n / 2, n / 2), 0.0f);
+		sparse.SetFixed(ivec3(x, n / 2, n / 2), 0.0f);
+	}
+	dense.Solve(4 * n, 0.0f);
+	sparse.Solve(4 * n, 0.0f);
+
+	float maxDifference = 0.0f;
+	for (int z = 1; z <= n; z++) {
+		for (int y = 1; y <= n; y++) {
+			for (int x = 1; x <= n; x++) {
+				ivec3 cell(x, y, z);
+				maxDifference = glm::max(maxDifference, glm::abs(dense.Potential(cell) - sparse.Potential(cell)));
+			}
+		}
+	}
+	return maxDifference;
+}
+
+// Times a full solve from the background field, and an incremental solve
+// after one more channel cell is fixed.
+void RunDBMSolve(int gridSize, int count) {
+	double fullSum = 0.0;
+	double stepSum = 0.0;
+	int iterations = 0;
+
+	for (int i = 0; i < count; i++) {
+		LaplaceSolver solver;
+		solver.Init(gridSize, std::thread::hardware_concurrency());
+		int n = solver.Size();
+		solver.SetFixed(ivec3(n / 2, n, n / 2), 0.0f);
+
+		auto t1 = high_resolution_clock::now();
+		iterations = solver.Solve(4 * n, 1e-4f);
+		auto t2 = high_resolution_clock::now();
+		solver.SetFixed(ivec3(n / 2, n - 1, n / 2), 0.0f);
+		solver.Solve(6, 1e-4f);
+		auto t3 = high_resolution_clock::now();
+
+		fullSum += duration<double, std::milli>(t2 - t1).count();
+		stepSum += duration<double, std::milli>(t3 - t2).count();
+	}
+
+	std::cout << std::endl << gridSize << std::endl;
+	std::cout << "Full: " << fullSum / double(count) << " ms (" << iterations << " iterations)" << std::endl;
+	std::cout << "Step: " << stepSum / double(count) << " ms" << std::endl;
+}
+
+void RunDBM(int gridSize, int count, vector<pair<vec3, vec3>>* patternPtr, bool sparse) {
+	double sum = 0.0;
+
+	SetStartPos(vec3(20.0f, 60.0f, 0.0f));
+	SetEndPos(vec3(10.0f, 0.0f, 0.0f));
+	SetDBMOptions(gridSize, 3.0f, sparse);
+	for (int i = 0; i < count; i++) {
+
+		auto t1 = high_resolution_clock::now();
+		GenerateDBMPattern(patternPtr);
+		auto t2 = high_resolution_clock::now();
+
+		duration<double, std::milli> ms_double = t2 - t1;
+
+		sum += ms_double.count();
+	}
+
+	std::cout << std::endl << gridSize << std::endl;
+	std::cout << sum / double(count) << " ms" << std::endl;
+}
+
+void RunColonization(int numAttractors, int count, vector<pair<vec3, vec3>>* patternPtr) {
+	double sum = 0.0;
+	unsigned int segments = 0;
+
+	SetStartPos(vec3(20.0f, 60.0f, 0.0f));
+	SetEndPos(vec3(10.0f, 0.0f, 0.0f));
+	SetColonizationOptions(numAttractors, 12.0f);
+	for (int i = 0; i < count; i++) {
+
+		auto t1 = high_resolution_clock::now();
+		GenerateColonizationPattern(patternPtr);
+		auto t2 = high_resolution_clock::now();
+
+		duration<double, std::milli> ms_double = t2 - t1;
+
+		sum += ms_double.count();
+		segments += patternPtr->size();
+	}
+
+	std::cout << std::endl << numAttractors << std::endl;
+	std::cout << sum / double(count) << " ms (" << segments / count << " segments)" << std::endl;
+}
+
+// Build time and query throughput of the BVH over the water tower
+void TestSceneBVH() {
+	Model tower(ProjectBasePath() + "\\Models\\waterTower\\Water Tower Scanline.obj");
+	vector<vec3> triangles;
+	for (const Mesh& mesh : tower.meshes) {
+		for (unsigned int index : mesh.indices) {
+			triangles.push_back(mesh.vertices[index].Position);
+		}
+	}
+
+	int count = 10;
+	double sum = 0.0;
+	TriangleBVH bvh;
+	for (int i = 0; i < count; i++) {
+		bvh.Build(triangles);
+		sum += bvh.BuildTime();
+	}
+	std::cout << "Scene BVH" << std::endl;
+	std::cout << bvh.NumTriangles() << " triangles, " << bvh.NumNodes() << " nodes" << std::endl;
+	std::cout << "Build: " << sum / double(count) << " ms" << std::endl;
+
+	// 10k - 1M . Queries
+	for (int queries = 10000; queries <= 1000000; queries *= 10) {
+		RunBVHQueries(bvh, queries);
+	}
+}
+
+// Times each batched query over random segments and spheres around the tower
+void RunBVHQueries(const TriangleBVH& bvh, int numQueries) {
+	vec3 center = (bvh.BoundsMin() + bvh.BoundsMax()) * 0.5f;
+	vec3 extent = bvh.BoundsMax() - bvh.BoundsMin();
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::mt19937 rng(numQueries);
+
+	vector<pair<vec3, vec3>> segments(numQueries);
+	vector<pair<vec3, vec3>> shadowRays(numQueries);
+	vector<vec3> centers(numQueries);
+	for (int i = 0; i < numQueries; i++) {
+		vec3 p = center + vec3(unit(rng), unit(rng), unit(rng)) * extent;
+		// short bolt sized segments, and rays towards the tower
+		segments[i] = { p, p + vec3(unit(rng), unit(rng), unit(rng)) };
+		shadowRays[i] = { p, center + vec3(unit(rng), unit(rng), unit(rng)) * extent * 0.25f };
+		centers[i] = p;
+	}
+
+	vector<float> hitFractions;
+	vector<bool> occluded;
+	vector<unsigned long long> masks;
+	auto t1 = high_resolution_clock::now();
+	bvh.IntersectSegments(segments, &hitFractions);
+	auto t2 = high_resolution_clock::now();
+	bvh.OccludedSegments(shadowRays, &occluded);
+	auto t3 = high_resolution_clock::now();
+	bvh.SphereObjectMasks(centers, glm::length(extent) * 0.25f, &masks);
+	auto t4 = high_resolution_clock::now();
+
+	// millions of queries per second
+	auto Rate = [numQueries](double ms) { return numQueries / (ms * 1000.0); };
+	std::cout << std::endl << numQueries << std::endl;
+	std::cout << "Segments: " << Rate(duration<double, std::milli>(t2 - t1).count()) << " M/s" << std::endl;
+	std::cout << "Occlusion: " << Rate(duration<double, std::milli>(t3 - t2).count()) << " M/s" << std::endl;
+	std::cout << "Spheres: " << Rate(duration<double, std::milli>(t4 - t3).count()) << " M/s" << std::endl;
+}
+
+// Build time of the light tree over bolt sized clouds of lights, and 
+// lights affecting random boxes the size of a scene object
+void TestLightBVH() {
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::mt19937 rng(0);
+	std::cout << "Light BVH" << std::endl;
+
+	// 1k - 64k . Lights
+	for (int numLights = 1000; numLights <= 64000; numLights *= 4) {
+		// a bolt's lights, spread along y
+		vector<vec3> lights(numLights);
+		for (vec3& light : lights) {
+			light = vec3(unit(rng) * 20.0f, 30.0f + unit(rng) * 30.0f, unit(rng) * 20.0f);
+		}
+
+		int count = 10;
+		double sum = 0.0;
+		LightBVH tree;
+		for (int i = 0; i < count; i++) {
+			tree.Build(lights, numLights);
+			sum += tree.BuildTime();
+		}
+
+		bool valid = tree.Validate();
+
+		int numQueries = 10000;
+		int found = 0;
+		vector<int> affecting;
+		vector<vec3> boxes(numQueries);
+		for (vec3& boxMin : boxes) {
+			boxMin = vec3(unit(rng) * 20.0f, 30.0f + unit(rng) * 30.0f, unit(rng) * 20.0f);
+		}
+		auto t1 = high_resolution_clock::now();
+		for (vec3 boxMin : boxes) {
+			tree.QueryAABB(boxMin, boxMin + vec3(2.0f), 7.0f, &affecting);
+			found += affecting.size();
+		}
+		duration<double, std::milli> ms = high_resolution_clock::now() - t1;
+
+		// the first thousand queries again, against every light
+		int mismatches = 0;
+		vector<int> expected;
+		for (int i = 0; i < 1000; i++) {
+			vec3 boxMin = boxes[i];
+			vec3 boxMax = boxMin + vec3(2.0f);
+			expected.clear();
+			for (int light = 0; light < numLights; light++) {
+				vec3 d = lights[light] - glm::clamp(lights[light], boxMin, boxMax);
+				if (glm::dot(d, d) <= 7.0f * 7.0f) {
+					expected.push_back(light);
+				}
+			}
+			tree.QueryAABB(boxMin, boxMax, 7.0f, &affecting);
+			std::sort(affecting.begin(), affecting.end());
+			if (affecting != expected) {
+				mismatches++;
+			}
+		}
+
+		std::cout << std::endl << numLights << std::endl;
+		std::cout << "Build: " << sum / double(count) << " ms (" << tree.NumNodes() << " nodes)" << std::endl;
+		std::cout << "Box Queries: " << ms.count() * 1000.0 / numQueries << " us (" << found / numQueries << " lights)" << std::endl;
+		std::cout << "Valid: " << (valid ? "yes" : "no") << ", " << mismatches << " / 1000 queries differ from brute force" << std::endl;
+	}
+}
+
+// Segments, lights and ms per strike (generation and light placement) with
+// the camera further and further from the bolt, 0 is without LOD
+void TestBoltLOD() {
+	int count = 20;
+	vector<pair<vec3, vec3>> pattern;
+	std::cout << "Bolt LOD" << std::endl;
+
+	std::cout << "LSystem" << std::endl;
+	SetLSystemOptions(vec3(0.0f, 0.0f, 0.0f), 12, 12.0f);
+	for (float distance : { 0.0f, 10.0f, 25.0f, 50.0f, 100.0f, 200.0f, 400.0f }) {
+		RunBoltLOD(2, distance, count, &pattern);
+	}
+
+	std::cout << std::endl << "Space Colonization" << std::endl;
+	SetColonizationOptions(4000, 12.0f);
+	for (float distance : { 0.0f, 10.0f, 25.0f, 50.0f, 100.0f, 200.0f, 400.0f }) {
+		RunBoltLOD(4, distance, count, &pattern);
+	}
+	SetBoltLODOptions(false, 2.0f);
+}
+
+// method: 2 - L-System, 4 - Space Colonization
+void RunBoltLOD(int method, float distance, int count, vector<pair<vec3, vec3>>* patternPtr) {
+	double sum = 0.0;
+	unsigned int segments = 0;
+	unsigned int lights = 0;
+	vector<vec3> lightPositions;
+
+	// 720p with a 45 degree fov, looking at the middle of the bolt
+	SetBoltLODOptions(distance > 0.0f, 2.0f);
+	SetBoltLODView(vec3(0.0f, 45.0f, distance), 0.5f * 720.0f / glm::tan(glm::radians(45.0f) * 0.5f));
+	SetStartPos(vec3(0.0f, 90.0f, 0.0f));
+	SetEndPos(vec3(0.0f, 0.0f, 0.0f));
+	for (int i = 0; i < count; i++) {
+
+		auto t1 = high_resolution_clock::now();
+		if (method == 2) {
+			GenerateLSystemPattern(patternPtr, true);
+		}
+		else {
+			GenerateColonizationPattern(patternPtr);
+		}
+		PositionBoltPointLights(&lightPositions, patternPtr);
+		auto t2 = high_resolution_clock::now();
+
+		duration<double, std::milli> ms_double = t2 - t1;
+
+		sum += ms_double.count();
+		segments += patternPtr->size();
+		lights += lightPositions.size();
+	}
+
+	std::cout << std::endl << distance << std::endl;
+	std::cout << sum / double(count) << " ms (" << segments / count << " segments, "
+		<< lights / count << " lights)" << std::endl;
+}
@@ -0,0 +1,64 @@
+#include "Threading.h"
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+void WorkerPool::Run(int numTasks, const std::function<void(int)>& task) {
+	if (numTasks <= 0) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// pool thread i - 1 runs task i
+		while (int(threads.size()) < numTasks - 1) {
+			threads.emplace_back(&WorkerPool::WorkerLoop, this, int(threads.size()) + 1);
+		}
+		job = &task;
+		jobTasks = numTasks;
+		remaining = numTasks - 1;
+		generation++;
+	}
+	workReady.notify_all();
+
+	task(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	workDone.wait(lock, [&] { return remaining == 0; });
+	job = nullptr;
+}
+
+int WorkerPool::NumThreads() const {
+	return threads.size() + 1;
+}
+
+// PRIVATE
+void WorkerPool::WorkerLoop(int task) {
+	std::unique_lock<std::mutex> lock(mutex);
+	// threads added during a Run start with it
+	int seenGeneration = generation - 1;
+	while (true) {
+		workReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+		if (stopping) {
+			return;
+		}
+		seenGeneration = generation;
+		if (task >= jobTasks) {
+			continue;
+		}
+		const std::function<void(int)>* current = job;
+		lock.unlock();
+		(*current)(task);
+		lock.lock();
+		if (--remaining == 0) {
+			workDone.notify_one();
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <vector>
+
+// Reusable barrier for a fixed group of threads, all threads wait until the
+// last one arrives.
+class ThreadBarrier {
+public:
+	ThreadBarrier(int count) : count(count) {}
+
+	void Wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		int arrivalGeneration = generation;
+		if (++waiting == count) {
+			waiting = 0;
+			generation++;
+			condition.notify_all();
+		}
+		else {
+			condition.wait(lock, [&] { return generation != arrivalGeneration; });
+		}
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	int count;
+	int waiting = 0;
+	int generation = 0;
+};
+
+// Threads that are started once and then wait for work, so solvers that run
+// every frame don't pay for creating and joining threads on each call.
+// Run(numTasks, task) calls task(i) for each i in [0, numTasks), every task
+// on its own thread at the same time (task 0 on the calling thread), so tasks
+// can wait on each other with a ThreadBarrier. It returns once all are done.
+// Threads are added as larger runs need them and joined by the destructor.
+class WorkerPool {
+public:
+	WorkerPool() {}
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	void Run(int numTasks, const std::function<void(int)>& task);
+	int NumThreads() const;
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	const std::function<void(int)>* job = nullptr;
+	int jobTasks = 0;
+	int generation = 0;		// incremented for each Run
+	int remaining = 0;		// tasks of the current Run still running on the pool
+	bool stopping = false;
+
+	void WorkerLoop(int task);
+};
@@ -76,4 +76,46 @@ void Timer::SetChronoFrameTarget(int val) {
 
 void Timer::SetOutputResults(bool set) {
 	outputResults = set;
-}
\ No newline at end of file
+}
+
+// GpuTimer
+// ---------------
+void GpuTimer::Begin() {
+	if (pending || running) {
+		return;
+	}
+	if (query == 0) {
+		glGenQueries(1, &query);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	running = true;
+}
+
+void GpuTimer::End() {
+	if (!running) {
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	running = false;
+	pending = true;
+}
+
+bool GpuTimer::Poll(double* ms) {
+	if (!pending) {
+		return false;
+	}
+	int available = 0;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return false;
+	}
+	GLuint64 ns = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+	pending = false;
+	*ms = ns / 1e6;
+	return true;
+}
+
+bool GpuTimer::Pending() {
+	return pending || running;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <imgui/imgui.h>
 #include <iostream>
@@ -44,4 +45,21 @@ public:
 	void SetOutputResults(bool set);
 
 	void Info();
-};
\ No newline at end of file
+};
+
+// Measures GPU time between Begin and End with a timer query. The result is
+// read a frame or more later so the CPU never waits on the GPU, a Begin while
+// the last measurement is still pending is skipped.
+class GpuTimer {
+private:
+	unsigned int query = 0;
+	bool running = false;
+	bool pending = false;
+
+public:
+	void Begin();
+	void End();
+	// true when a new measurement has finished, ms gets its time
+	bool Poll(double* ms);
+	bool Pending();
+};